@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    clock_sync.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Synchronization of the sensor clock to the display clock with an
+  * 		 NTP style exchange over the link: offset and drift are fitted to
+  * 		 the exchanges with the shortest round trip, samples are stamped
+  * 		 with the display time. Shared by both projects, builds on the
+  * 		 host without HAL or RTOS, time is passed in µs by the caller.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_CLOCK_SYNC_H_
+#define INC_CLOCK_SYNC_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "link_codec.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define CLOCK_SYNC_FILTER 8 //last exchanges, the one with the shortest round trip is used
+#define CLOCK_SYNC_POINTS 8 //filtered offsets offset and drift are fitted to
+#define CLOCK_SYNC_MIN_POINTS 3 //synchronized from here on
+
+#define CLOCK_SYNC_INTERVAL_FAST 250000 //µs between requests until synchronized
+#define CLOCK_SYNC_INTERVAL 1000000 //µs between requests afterwards
+#define CLOCK_SYNC_MAX_DELAY 500000 //µs, longer round trips (queued behind other frames) are ignored
+#define CLOCK_SYNC_MAX_AGE 600000000 //µs, older points are dropped, the error is unknown after this
+#define CLOCK_SYNC_STEP 20000 //µs off the fit: outlier, twice in a row the peer clock jumped (restart)
+#define CLOCK_SYNC_MAX_DRIFT 1000000 //ppb, two crystals never differ more (LSE ±20 ppm each)
+#define CLOCK_SYNC_HOLDOVER 1 //µs per s the error grows after the last point (drift the fit misses)
+
+#define CLOCK_SYNC_PAYLOAD 12 //request and reply have the same length, so both directions take equally long
+#define CLOCK_SYNC_UNKNOWN UINT32_MAX //clock_syncError: not synchronized
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct ClockSyncSample
+{
+	uint32_t time;		//µs, local time the reply arrived
+	uint32_t offset;	//µs, remote - local (modulo 2^32)
+	uint32_t delay;		//µs, round trip without the time the peer held the request
+}CLOCK_SYNC_SAMPLE_t;
+
+typedef struct ClockSyncStats
+{
+	uint32_t requests;
+	uint32_t replies;
+	uint32_t rejected;	//late, unmatched or round trip above CLOCK_SYNC_MAX_DELAY
+	uint32_t points;	//exchanges the filter picked for the fit
+	uint32_t outliers;	//points further than CLOCK_SYNC_STEP off the fit
+	uint32_t restarts;	//peer clock jumped, the fit started over
+}CLOCK_SYNC_STATS_t;
+
+typedef struct ClockSync
+{
+	CLOCK_SYNC_SAMPLE_t filter[CLOCK_SYNC_FILTER];
+	CLOCK_SYNC_SAMPLE_t points[CLOCK_SYNC_POINTS];
+	uint8_t filterCount;
+	uint8_t filterNext;
+	uint8_t pointCount;
+	uint8_t pointNext;
+	uint8_t outliers;		//in a row
+	uint8_t id;				//correlation id of the last request
+	_Bool pending;			//request sent, no reply yet
+	uint32_t requestTime;	//µs, local time the request was sent
+	uint32_t nextRequest;	//µs
+	uint32_t picked;		//µs, time of the last exchange the filter passed on
+	//remote = local + offset + drift * (local - reference)
+	uint32_t reference;		//µs, local time of the newest point
+	uint32_t offset;		//µs, fitted offset at reference
+	int32_t drift;			//ppb, remote clock runs faster if positive
+	uint32_t jitter;		//µs, standard error of the points around the fit
+	uint32_t delay;			//µs, round trip of the newest point
+	CLOCK_SYNC_STATS_t stats;
+}CLOCK_SYNC_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void clock_syncInit(CLOCK_SYNC_t* sync, uint32_t now);
+_Bool clock_syncPoll(CLOCK_SYNC_t* sync, uint32_t now, LINK_MESSAGE_t* request);
+uint32_t clock_syncNextTimeout(const CLOCK_SYNC_t* sync, uint32_t now);
+_Bool clock_syncReceive(CLOCK_SYNC_t* sync, const LINK_MESSAGE_t* reply, uint32_t received);
+_Bool clock_syncReply(const LINK_MESSAGE_t* request, uint32_t received, uint32_t now, LINK_MESSAGE_t* reply);
+_Bool clock_syncIsSynchronized(const CLOCK_SYNC_t* sync);
+uint32_t clock_syncRemote(const CLOCK_SYNC_t* sync, uint32_t local);
+uint32_t clock_syncError(const CLOCK_SYNC_t* sync, uint32_t now);
+uint32_t clock_micros(void);
+
+#endif /* INC_CLOCK_SYNC_H_ */
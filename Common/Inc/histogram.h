@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    histogram.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Log bucketed histogram in static memory (as HdrHistogram):
+  * 		 exact below 2^HISTOGRAM_SUB_BITS, above every power of two is
+  * 		 split into HISTOGRAM_HALF buckets, so the error of a value or
+  * 		 percentile stays below 1/HISTOGRAM_HALF. Builds on the host.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_HISTOGRAM_H_
+#define INC_HISTOGRAM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define HISTOGRAM_SUB_BITS 3 //0..7 exact, then 4 buckets per power of two (25 %)
+#define HISTOGRAM_MAX_BITS 13 //up to 8191, larger values count in the last bucket
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_HALF) //48
+#define HISTOGRAM_MAX ((1UL << HISTOGRAM_MAX_BITS) - 1)
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct Histogram
+{
+	uint32_t counts[HISTOGRAM_BUCKETS];
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+}HISTOGRAM_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void histogram_reset(HISTOGRAM_t* histogram);
+void histogram_record(HISTOGRAM_t* histogram, uint32_t value);
+uint8_t histogram_index(uint32_t value);
+uint32_t histogram_low(uint8_t index);
+uint32_t histogram_high(uint8_t index);
+uint32_t histogram_percentile(const HISTOGRAM_t* histogram, uint8_t percent);
+uint32_t histogram_mean(const HISTOGRAM_t* histogram);
+
+#endif /* INC_HISTOGRAM_H_ */
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    link_arq.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Reliable delivery of link frames over the telemetry radio:
+  * 		 sequence numbers, cumulative acks, a sliding window (Go-Back-N)
+  * 		 and a retransmission timeout adapted to the measured round trip
+  * 		 time. Shared by both projects, builds on the host without HAL or
+  * 		 RTOS, time is passed in ms by the caller.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LINK_ARQ_H_
+#define INC_LINK_ARQ_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "link_codec.h"
+#include "histogram.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define LINK_ARQ_MAX_WINDOW 8 //frames in flight, power of two below 128 (8 bit sequence)
+#define LINK_ARQ_WINDOW LINK_REQUEST_WINDOW //default of both boards
+
+#define LINK_ARQ_RTO_INITIAL 500 //ms, until the first round trip was measured
+#define LINK_ARQ_RTO_MIN 100 //ms, above the round trip of the radio pair (~50 ms) and its jitter
+#define LINK_ARQ_RTO_MAX 2000 //ms, backoff stops here
+#define LINK_ARQ_MAX_RETRIES 10 //timeouts in a row (~15 s) before the frames in flight are given up
+
+#define LINK_ARQ_NEVER UINT32_MAX //link_arqNextTimeout: nothing in flight
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	LINK_ARQ_OK = 0,
+	LINK_ARQ_FULL = 1		//window full, send again after an ack
+}LINK_ARQ_STATUS_t;
+
+//sends one frame (data, retransmission or ack), called from the link_arq functions
+typedef void (*LINK_ARQ_OUTPUT_t)(void* context, const LINK_MESSAGE_t* message);
+
+typedef struct LinkArqStats
+{
+	uint32_t sent;			//new data frames
+	uint32_t retransmitted;
+	uint32_t acked;			//data frames the peer confirmed
+	uint32_t lost;			//given up after LINK_ARQ_MAX_RETRIES timeouts
+	uint32_t timeouts;
+	uint32_t resyncs;		//peer restarted, frames in flight sent again in a new session
+	uint32_t delivered;		//received in order
+	uint32_t duplicates;	//received again or out of order, dropped and acked again
+	uint32_t acks;			//acks sent
+	uint32_t srtt;			//ms, smoothed round trip time, 0 until measured
+	uint32_t rttvar;		//ms
+	uint32_t rto;			//ms, current retransmission timeout
+}LINK_ARQ_STATS_t;
+
+typedef struct LinkArq
+{
+	//sender
+	LINK_MESSAGE_t frames[LINK_ARQ_MAX_WINDOW];	//in flight, index sequence % LINK_ARQ_MAX_WINDOW
+	uint32_t sentTime[LINK_ARQ_MAX_WINDOW];		//ms of the first transmission
+	_Bool retransmitted[LINK_ARQ_MAX_WINDOW];	//no round trip sample from these (Karn)
+	uint8_t window;
+	uint8_t session;		//own session, 0 until the first frame is sent
+	uint8_t base;			//oldest sequence not acked
+	uint8_t next;			//sequence of the next new frame
+	uint8_t retries;		//timeouts in a row
+	_Bool fastResent;		//frames in flight sent again at a duplicate ack, once until the next ack
+	uint32_t timerStart;	//ms, retransmission timer of the oldest frame
+	uint32_t srtt8;			//8 * smoothed round trip time in ms
+	uint32_t rttvar4;		//4 * round trip time variation in ms
+	uint32_t rto;
+	_Bool measured;
+	HISTOGRAM_t rtt;		//ms, every round trip sample
+	//receiver
+	uint8_t peerSession;	//0 until the first frame of the peer
+	uint8_t expected;		//next sequence of the peer
+	LINK_ARQ_OUTPUT_t output;
+	void* context;
+	LINK_ARQ_STATS_t stats;
+}LINK_ARQ_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void link_arqInit(LINK_ARQ_t* arq, uint8_t window, LINK_ARQ_OUTPUT_t output, void* context);
+LINK_ARQ_STATUS_t link_arqSend(LINK_ARQ_t* arq, const LINK_MESSAGE_t* message, uint32_t now);
+_Bool link_arqReceive(LINK_ARQ_t* arq, const LINK_MESSAGE_t* message, uint32_t now);
+void link_arqPoll(LINK_ARQ_t* arq, uint32_t now);
+uint32_t link_arqNextTimeout(const LINK_ARQ_t* arq, uint32_t now);
+uint8_t link_arqInFlight(const LINK_ARQ_t* arq);
+void link_arqGetStats(const LINK_ARQ_t* arq, LINK_ARQ_STATS_t* copy);
+void link_arqGetRtt(const LINK_ARQ_t* arq, HISTOGRAM_t* copy);
+void link_arqResetStats(LINK_ARQ_t* arq);
+
+#endif /* INC_LINK_ARQ_H_ */
@@ -0,0 +1,103 @@
+/**
+  ******************************************************************************
+  * @file    link_codec.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Binary framing of the link between both boards: typed messages
+  * 		 with CRC-16, COBS encoded and delimited by 0x00. Shared by both
+  * 		 projects, builds on the host without HAL for testing.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LINK_CODEC_H_
+#define INC_LINK_CODEC_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define LINK_DELIMITER 0x00
+#define LINK_MAX_PAYLOAD 24 //log records: id, level, time and four arguments
+#define LINK_HEADER_SIZE 6 //type, address, id, session, sequence, length
+#define LINK_MAX_FRAME (LINK_MAX_PAYLOAD + LINK_HEADER_SIZE + 5) //header, CRC, COBS code, two delimiters
+
+#define LINK_ADDRESS_BROADCAST 0 //frame for every sensor node (log records, ASCII side)
+#define LINK_ID_NONE 0 //no reply expected, or request of an ASCII command
+#define LINK_REQUEST_WINDOW 4 //requests a sender may have in flight
+
+#define LINK_SAMPLE_CHANNELS 5 //red, green, blue, infrared, clear (order of MEA:)
+#define LINK_SAMPLE_BITS 19 //per channel, covers the HDR range (~393000)
+#define LINK_SAMPLE_MAX ((1UL << LINK_SAMPLE_BITS) - 1)
+#define LINK_SAMPLE_BYTES ((LINK_SAMPLE_CHANNELS * LINK_SAMPLE_BITS + 7) / 8) //12
+#define LINK_SAMPLE_LENGTH (LINK_SAMPLE_BYTES + 6) //channels, time (µs) and its error (µs)
+#define LINK_SAMPLE_UNSYNCED 0xFFFF //error of a sample taken before the clocks were synchronized
+
+#define LINK_RX_SIZE 40 //longest ASCII command or encoded frame without delimiters
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	LINK_OK = 0,
+	LINK_ERR_LENGTH = 1,	//empty, too short or length byte does not match
+	LINK_ERR_COBS = 2,		//code byte points behind the frame or 0x00 inside
+	LINK_ERR_CRC = 3
+}LINK_STATUS_t;
+
+typedef enum {
+	LINK_MSG_COLOR = 0x01,				//r,g,b                display -> sensor, as COL:
+	LINK_MSG_MEASURE = 0x02,			//-                    display -> sensor, as MEA:
+	LINK_MSG_MEASURE_RAW = 0x03,		//-                    display -> sensor, as RAW:
+	LINK_MSG_REFLECTANCE = 0x04,		//r,g,b illumination   display -> sensor, as REF:
+	LINK_MSG_SYNC = 0x05,				//t1, padding          sensor -> display, unsequenced (clock_sync.h)
+	LINK_MSG_POLL = 0x06,				//-                    display -> sensor, unsequenced, turn of the node starts (link_schedule.h)
+	LINK_MSG_ACK = 0x10,				//-                    both, cumulative ack (link_arq.h), id = acked sequence
+	LINK_MSG_REPLY = 0x80,				//reply type = request type | LINK_MSG_REPLY
+	LINK_MSG_SAMPLE = 0x82,				//packed sample        sensor -> display
+	LINK_MSG_SAMPLE_RAW = 0x83,
+	LINK_MSG_SAMPLE_REFLECTANCE = 0x84,
+	LINK_MSG_SYNC_REPLY = 0x85,			//t1,t2,t3             display -> sensor, unsequenced
+	LINK_MSG_POLL_REPLY = 0x86,			//packed sample or -   sensor -> display, unsequenced, ends the turn
+	LINK_MSG_LOG = 0x40					//log record, only on USART2 (log.h)
+}LINK_MSG_t;
+
+typedef struct LinkMessage
+{
+	uint8_t type;
+	uint8_t address;	//sensor node the frame is for or comes from, LINK_ADDRESS_BROADCAST
+	uint8_t id;			//correlation id, the reply carries the id of its request
+	uint8_t session;	//link_arq: session of the sender, 0 = not sequenced
+	uint8_t sequence;	//link_arq: sequence number, next expected one in an ack
+	uint8_t length;
+	uint8_t payload[LINK_MAX_PAYLOAD];
+}LINK_MESSAGE_t;
+
+typedef enum {
+	LINK_RX_NONE = 0,		//message not complete yet
+	LINK_RX_FRAME = 1,		//data holds an encoded frame for link_decode
+	LINK_RX_TEXT = 2,		//data holds an ASCII command, terminated
+	LINK_RX_OVERFLOW = 3	//message longer than LINK_RX_SIZE, dropped
+}LINK_RX_RESULT_t;
+
+typedef struct LinkReceiver
+{
+	char data[LINK_RX_SIZE + 1];
+	uint16_t length;
+	_Bool binary;		//inside a frame (after a delimiter)
+	_Bool overflow;
+	_Bool complete;		//data was handed out, start over with the next byte
+	_Bool paused;		//the line went idle inside this frame
+}LINK_RECEIVER_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void link_Init(void);
+uint16_t link_crc16(const uint8_t* data, uint16_t length);
+uint16_t link_encode(const LINK_MESSAGE_t* message, uint8_t* frame, uint16_t size);
+LINK_STATUS_t link_decode(const uint8_t* frame, uint16_t length, LINK_MESSAGE_t* message);
+void link_packSample(const uint32_t* channels, uint32_t time, uint32_t error, LINK_MESSAGE_t* message, uint8_t type);
+_Bool link_unpackSample(const LINK_MESSAGE_t* message, uint32_t* channels, uint32_t* time, uint16_t* error);
+void link_resetReceiver(LINK_RECEIVER_t* receiver);
+LINK_RX_RESULT_t link_receive(LINK_RECEIVER_t* receiver, uint8_t byte);
+LINK_RX_RESULT_t link_receiveIdle(LINK_RECEIVER_t* receiver);
+
+#endif /* INC_LINK_CODEC_H_ */
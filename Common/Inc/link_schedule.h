@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    link_schedule.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Several sensor nodes on one radio channel: the display polls the
+  * 		 nodes round robin, a node only transmits in its own turn, so two
+  * 		 nodes never send at the same time. Shared by both projects,
+  * 		 builds on the host without HAL or RTOS, time is passed in ms.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LINK_SCHEDULE_H_
+#define INC_LINK_SCHEDULE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "link_codec.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define LINK_MAX_NODES 4 //sensor nodes, addresses 1..LINK_MAX_NODES
+#define LINK_NODE_DEFAULT 1 //address of a single sensor board, target of the menu requests
+
+#define LINK_ANSWER_TIMEOUT 100 //ms from the poll to the first frame of the node: round trip of the radio (~50 ms)
+#define LINK_TURN_TIMEOUT 250 //ms from the poll to the end of the turn: answer plus a full TX ring (~90 ms)
+#define LINK_ABSENT_MISSES 3 //turns missed in a row, the node counts as absent
+#define LINK_PROBE_CYCLES 8 //absent nodes are polled every 8th cycle only
+#define LINK_POLL_LOST 2000 //ms without any poll on the channel (or after reset), a node transmits freely
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct LinkNodeStats
+{
+	uint32_t polls;
+	uint32_t turns;			//polls the node answered
+	uint32_t misses;		//polls without answer: poll or answer lost, node absent
+	uint32_t samples;		//answers with a new sample
+	uint32_t lastSample;	//ms
+	uint32_t interval;		//ms between samples, smoothed
+	_Bool present;
+}LINK_NODE_STATS_t;
+
+typedef struct LinkScheduler
+{
+	uint8_t count;			//nodes polled, addresses 1..count
+	uint8_t current;		//node polled last, 0 before the first poll
+	uint8_t turn;			//id of the last poll, its reply carries it
+	_Bool waiting;			//turn of the current node runs
+	_Bool answered;			//a frame of the current node arrived in this turn
+	_Bool ending;			//its poll reply arrived, the turn ends at the idle line
+	uint8_t misses[LINK_MAX_NODES]; //in a row
+	uint32_t turnStart;		//ms, the poll left
+	uint32_t cycleStart;	//ms
+	uint32_t cycle;			//ms, duration of the last cycle over all nodes
+	uint32_t cycles;
+	LINK_NODE_STATS_t nodes[LINK_MAX_NODES];
+}LINK_SCHEDULER_t;
+
+typedef struct LinkNode
+{
+	uint8_t address;
+	_Bool polled;			//a display polls, transmit in the own turn only
+	_Bool pending;			//poll for this node arrived, the turn starts at the idle line
+	uint8_t turn;			//id of that poll
+	uint32_t lastPoll;		//ms, poll for any node
+	uint32_t turns;
+	uint32_t late;			//polls dropped, paused or more frames followed them
+}LINK_NODE_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void link_schedulerInit(LINK_SCHEDULER_t* scheduler, uint8_t count, uint32_t now);
+_Bool link_schedulerPoll(LINK_SCHEDULER_t* scheduler, uint32_t now, uint32_t delay, LINK_MESSAGE_t* poll);
+void link_schedulerReceive(LINK_SCHEDULER_t* scheduler, const LINK_MESSAGE_t* message, uint32_t now);
+_Bool link_schedulerIdle(LINK_SCHEDULER_t* scheduler);
+uint32_t link_schedulerNextTimeout(const LINK_SCHEDULER_t* scheduler, uint32_t now);
+uint8_t link_schedulerPresent(const LINK_SCHEDULER_t* scheduler);
+_Bool link_schedulerGetStats(const LINK_SCHEDULER_t* scheduler, uint8_t address, LINK_NODE_STATS_t* copy);
+void link_nodeInit(LINK_NODE_t* node, uint8_t address, uint32_t now);
+_Bool link_nodeReceive(LINK_NODE_t* node, const LINK_MESSAGE_t* message, _Bool paused, uint32_t now);
+_Bool link_nodeIdle(LINK_NODE_t* node, LINK_MESSAGE_t* reply);
+_Bool link_nodeIsPolled(LINK_NODE_t* node, uint32_t now);
+
+#endif /* INC_LINK_SCHEDULE_H_ */
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    log.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Deferred binary logging on USART2 (ST-Link virtual COM port).
+  * 		 A call only stores message index, level, time and arguments in
+  * 		 a RAM ring, a low priority task sends them as link frames.
+  *
+  * 		 LOG_WARN(RX_DROPPED, lost, total);
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LOG_H_
+#define INC_LOG_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "log_messages.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+//calls below this level are removed by the preprocessor, set per build configuration with -DLOG_LEVEL=...
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 4
+#define LOG_RING_SIZE 32 //records
+#define LOG_FLUSH_MS 20 //the task sends at least this often
+
+/*Type Definitions -----------------------------------------------------------*/
+#define LOG_ID(name, format) LOG_ID_##name,
+typedef enum {
+	LOG_MESSAGES(LOG_ID)
+	LOG_ID_COUNT
+}LOG_ID_t;
+#undef LOG_ID
+
+typedef struct LogRecord
+{
+	uint16_t id;
+	uint8_t level;
+	uint8_t count;
+	uint32_t time;		//ms since startup
+	uint32_t args[LOG_MAX_ARGS];
+}LOG_RECORD_t;
+
+/* Macros --------------------------------------------------------------------*/
+#define LOG_COUNT_(_0, _1, _2, _3, _4, N, ...) N
+#define LOG_COUNT(...) LOG_COUNT_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_AT(level, name, ...) log_write(level, LOG_ID_##name, LOG_COUNT(__VA_ARGS__), ##__VA_ARGS__)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(name, ...) LOG_AT(LOG_LEVEL_DEBUG, name, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(name, ...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(name, ...) LOG_AT(LOG_LEVEL_INFO, name, ##__VA_ARGS__)
+#else
+#define LOG_INFO(name, ...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(name, ...) LOG_AT(LOG_LEVEL_WARN, name, ##__VA_ARGS__)
+#else
+#define LOG_WARN(name, ...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(name, ...) LOG_AT(LOG_LEVEL_ERROR, name, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(name, ...) ((void)0)
+#endif
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool log_Init(void);
+void log_write(uint8_t level, uint16_t id, uint8_t count, ...);
+_Bool log_read(LOG_RECORD_t* record);
+uint32_t log_getDropped(void);
+
+#endif /* INC_LOG_H_ */
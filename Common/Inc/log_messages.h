@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file    log_messages.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   All log messages of both boards: name and format. Only the index
+  * 		 and the raw arguments are sent, Tools/log_decode.py reads this
+  * 		 table to format them on the PC. Append new messages at the end,
+  * 		 the index of existing ones must not change.
+  *
+  * 		 Arguments are 32 bit values, formats use %lu, %ld, %lx or %c.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LOG_MESSAGES_H_
+#define INC_LOG_MESSAGES_H_
+
+/* Defines -------------------------------------------------------------------*/
+//	X(name,				format)
+#define LOG_MESSAGES(X) \
+	X(BOOT,				"startup, board %lu (0 sensor, 1 display)") \
+	X(UART_ERROR,		"uart error 0x%lx") \
+	X(RX_DROPPED,		"receive ring dropped %lu bytes, %lu in total") \
+	X(FRAME_REJECTED,	"rejected frame or message, %lu in total") \
+	X(TX_DROPPED,		"transmit ring full, dropped %lu bytes") \
+	X(LOG_DROPPED,		"log ring full, %lu records lost") \
+	X(SAMPLE,			"sample r %lu g %lu b %lu clear %lu") \
+	X(CALIBRATION,		"calibration %c status %lu patches %lu") \
+	X(LUT,				"color lut %c status %lu") \
+	X(SAMPLE_RECEIVED,	"received r %lu g %lu b %lu clear %lu") \
+	X(COMMAND_REJECTED,	"command 0x%lx rejected, status %lu") \
+	X(REQUEST_DROPPED,	"request 0x%lx id %lu dropped, too many in flight") \
+	X(REPLY_UNMATCHED,	"reply 0x%lx id %lu without pending request (late or duplicate)") \
+	X(REQUEST_TIMEOUT,	"request 0x%lx id %lu timed out") \
+	X(LINK_DROPPED,		"link window full, frame 0x%lx dropped") \
+	X(LINK_LOST,		"link down, %lu frames given up, %lu in total") \
+	X(CLOCK_SYNCED,		"clock synchronized, error %lu us, drift %ld ppb, round trip %lu us") \
+	X(NODE_JOINED,		"sensor node %lu answers polls, %lu nodes present") \
+	X(NODE_ABSENT,		"sensor node %lu absent after %lu missed polls") \
+	X(NODE_SAMPLE,		"node %lu sample r %lu g %lu b %lu")
+
+#endif /* INC_LOG_MESSAGES_H_ */
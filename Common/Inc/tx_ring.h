@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    tx_ring.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Transmit ring of printf.c: whole messages are queued, the DMA
+  * 		 takes contiguous parts of it, a full ring drops or overwrites the
+  * 		 oldest messages. No locking and no hardware, printf.c calls every
+  * 		 function with interrupts off and starts the transfers. Builds on
+  * 		 the host, Tools/link_test.c checks it with a simulated DMA.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_TX_RING_H_
+#define INC_TX_RING_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define TX_RING_SIZE 512 //~90 ms at 57600 Baud
+#define TX_MESSAGES 32 //lengths kept for OVERWRITE, more messages are merged into the newest one
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	TX_OVERFLOW_DROP = 0,		//message is discarded when it does not fit
+	TX_OVERFLOW_BLOCK = 1,		//task waits for space (drops in interrupts and before the scheduler runs)
+	TX_OVERFLOW_OVERWRITE = 2	//oldest messages not sent yet are discarded
+}TX_OVERFLOW_t;
+
+typedef struct TxRing
+{
+	uint8_t data[TX_RING_SIZE];
+	volatile uint32_t head; //next byte to write (free running)
+	volatile uint32_t tail; //next byte to hand to the DMA
+	volatile uint16_t sending; //bytes in the running transfer, right before tail
+	volatile uint32_t dropped; //messages
+	//messages not completely handed to the DMA, oldest first, they cover start...head
+	uint16_t lengths[TX_MESSAGES];
+	uint8_t first;
+	uint8_t count;
+	uint32_t start; //start of the oldest message (free running like head)
+	volatile _Bool gated;
+	volatile uint32_t limit; //gated: bytes up to here may be sent (free running like head)
+	TX_OVERFLOW_t policy;
+}TX_RING_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void tx_ringInit(TX_RING_t* ring, TX_OVERFLOW_t policy);
+_Bool tx_ringReserve(TX_RING_t* ring, uint16_t length);
+void tx_ringPut(TX_RING_t* ring, const uint8_t* data, uint16_t length, _Bool release);
+uint16_t tx_ringNext(const TX_RING_t* ring, const uint8_t** data);
+void tx_ringStarted(TX_RING_t* ring, uint16_t length);
+void tx_ringSent(TX_RING_t* ring);
+void tx_ringRelease(TX_RING_t* ring);
+void tx_ringSetGated(TX_RING_t* ring, _Bool gated);
+
+#endif /* INC_TX_RING_H_ */
@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+  * @file    clock_sync.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Clock synchronization over the link (as NTP).
+  *
+  * 		 The sensor sends its time t1, the display stamps arrival t2 and
+  * 		 departure t3 of the reply, the sensor stamps its arrival t4:
+  *
+  * 		 delay  = (t4 - t1) - (t3 - t2)
+  * 		 offset = ((t2 - t1) + (t3 - t4)) / 2 = (t3 - t4) + delay / 2
+  *
+  * 		 The offset is exact if both directions take equally long. Frames
+  * 		 that waited in a queue or behind other frames have a longer round
+  * 		 trip, so of the last CLOCK_SYNC_FILTER exchanges only the one with
+  * 		 the shortest round trip is used (NTP clock filter). A least squares
+  * 		 line through the last CLOCK_SYNC_POINTS of them gives offset and
+  * 		 drift, the scatter around the line is the reported accuracy.
+  *
+  * 		 Request and reply are unsequenced (session 0): a retransmitted
+  * 		 timestamp would be stale, a lost exchange is simply replaced by
+  * 		 the next one. Times are 32 bit µs and wrap after 71 minutes, only
+  * 		 differences are used.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#ifndef USE_HAL_DRIVER
+#define _POSIX_C_SOURCE 199309L //clock_gettime on the host with -std=c11, before any system header
+#endif
+#include "clock_sync.h"
+#include <math.h>
+#include <string.h>
+#ifdef USE_HAL_DRIVER
+#include "stm32l4xx_hal.h"
+#else
+#include <time.h>
+#endif
+
+/* Defines -------------------------------------------------------------------*/
+#define CLOCK_TIMER_PERIOD 1000 //TIM6 counts µs, its update increments uwTick (stm32l4xx_hal_timebase_tim.c)
+
+/* Private Functions ---------------------------------------------------------*/
+static void put32(uint8_t* data, uint32_t value)
+{
+	for(uint8_t i = 0; i < 4; i++)
+		data[i] = (uint8_t)(value >> (8 * i));
+}
+static uint32_t get32(const uint8_t* data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+static const CLOCK_SYNC_SAMPLE_t* newest_point(const CLOCK_SYNC_t* sync)
+{
+	return &sync->points[(sync->pointNext + CLOCK_SYNC_POINTS - 1) % CLOCK_SYNC_POINTS];
+}
+/*
+ * Offset of the fitted line at a local time
+ */
+static uint32_t model_offset(const CLOCK_SYNC_t* sync, uint32_t local)
+{
+	int64_t elapsed = (int32_t)(local - sync->reference);
+	return sync->offset + (int32_t)(elapsed * sync->drift / 1000000000);
+}
+/*
+ * Least squares line through the points, relative to the newest one. Float
+ * is enough once the values are centered (FPU of the Cortex-M4).
+ */
+static void fit(CLOCK_SYNC_t* sync)
+{
+	const CLOCK_SYNC_SAMPLE_t* newest = newest_point(sync);
+	uint8_t count = sync->pointCount;
+	int32_t x[CLOCK_SYNC_POINTS];
+	int32_t y[CLOCK_SYNC_POINTS];
+	int64_t sumX = 0;
+	int64_t sumY = 0;
+	float sxx = 0;
+	float sxy = 0;
+	float squares = 0;
+
+	for(uint8_t i = 0; i < count; i++)
+	{
+		x[i] = (int32_t)(sync->points[i].time - newest->time);
+		y[i] = (int32_t)(sync->points[i].offset - newest->offset);
+		sumX += x[i];
+		sumY += y[i];
+	}
+	float meanX = (float)sumX / count;
+	float meanY = (float)sumY / count;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		sxx += (x[i] - meanX) * (x[i] - meanX);
+		sxy += (x[i] - meanX) * (y[i] - meanY);
+	}
+	float slope = (count >= 2 && sxx > 0) ? sxy / sxx : 0;
+	if(slope > CLOCK_SYNC_MAX_DRIFT * 1e-9f)
+		slope = CLOCK_SYNC_MAX_DRIFT * 1e-9f;
+	if(slope < -CLOCK_SYNC_MAX_DRIFT * 1e-9f)
+		slope = -CLOCK_SYNC_MAX_DRIFT * 1e-9f;
+	float atNewest = meanY - slope * meanX;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		float residual = y[i] - (atNewest + slope * x[i]);
+		squares += residual * residual;
+	}
+
+	sync->reference = newest->time;
+	sync->offset = newest->offset + (int32_t)lroundf(atNewest);
+	sync->drift = (int32_t)lroundf(slope * 1e9f);
+	//a line through two points has no scatter, two degrees of freedom are used up
+	sync->jitter = (uint32_t)lroundf(sqrtf(squares / ((count > 2) ? count - 2 : 1)));
+	sync->delay = newest->delay;
+}
+/*
+ * Adds an exchange the filter passed on and fits the line again, false if it
+ * was an outlier
+ */
+static _Bool add_point(CLOCK_SYNC_t* sync, const CLOCK_SYNC_SAMPLE_t* sample)
+{
+	if(sync->pointCount > 0 && sample->time - newest_point(sync)->time > CLOCK_SYNC_MAX_AGE)
+		sync->pointCount = 0;
+	if(clock_syncIsSynchronized(sync))
+	{
+		int32_t residual = (int32_t)(sample->offset - model_offset(sync, sample->time));
+		if(residual > CLOCK_SYNC_STEP || residual < -CLOCK_SYNC_STEP)
+		{
+			sync->stats.outliers++;
+			if(++sync->outliers < 2)
+				return false;
+			//the peer clock jumped (restart), start over with this exchange
+			sync->stats.restarts++;
+			sync->pointCount = 0;
+			sync->filter[0] = *sample;
+			sync->filterCount = 1;
+			sync->filterNext = 1;
+		}
+	}
+	sync->outliers = 0;
+	//the ring is filled in order, pointNext is the oldest once it is full
+	if(sync->pointCount == 0)
+		sync->pointNext = 0;
+	sync->points[sync->pointNext] = *sample;
+	sync->pointNext = (sync->pointNext + 1) % CLOCK_SYNC_POINTS;
+	if(sync->pointCount < CLOCK_SYNC_POINTS)
+		sync->pointCount++;
+	sync->stats.points++;
+	fit(sync);
+	return true;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Starts unsynchronized, the first request is due right away
+  * @param CLOCK_SYNC_t* sync
+  * @param uint32_t now µs
+  * @return None
+  */
+void clock_syncInit(CLOCK_SYNC_t* sync, uint32_t now)
+{
+	memset(sync, 0, sizeof(*sync));
+	sync->nextRequest = now;
+	sync->picked = now; //every reply arrives later
+}
+/**
+  * @brief Builds the next request when it is due. A request without reply
+  * 	   is given up, the new one replaces it.
+  * @param CLOCK_SYNC_t* sync
+  * @param uint32_t now µs, send the request right away
+  * @param LINK_MESSAGE_t* request
+  * @return _Bool true if the request has to be sent
+  */
+_Bool clock_syncPoll(CLOCK_SYNC_t* sync, uint32_t now, LINK_MESSAGE_t* request)
+{
+	if((int32_t)(now - sync->nextRequest) < 0)
+		return false;
+	sync->id = (sync->id == 0xFF) ? 1 : sync->id + 1; //never LINK_ID_NONE
+	sync->pending = true;
+	sync->requestTime = now;
+	sync->nextRequest = now + (clock_syncIsSynchronized(sync) ? CLOCK_SYNC_INTERVAL : CLOCK_SYNC_INTERVAL_FAST);
+	sync->stats.requests++;
+
+	memset(request, 0, sizeof(*request));
+	request->type = LINK_MSG_SYNC;
+	request->id = sync->id;
+	request->length = CLOCK_SYNC_PAYLOAD;
+	put32(request->payload, now);
+	return true;
+}
+/**
+  * @brief Time until the next request is due
+  * @param const CLOCK_SYNC_t* sync
+  * @param uint32_t now µs
+  * @return uint32_t µs, 0 if it is due
+  */
+uint32_t clock_syncNextTimeout(const CLOCK_SYNC_t* sync, uint32_t now)
+{
+	int32_t remaining = (int32_t)(sync->nextRequest - now);
+	return (remaining > 0) ? (uint32_t)remaining : 0;
+}
+/**
+  * @brief Takes the reply (LINK_MSG_SYNC_REPLY) to the pending request
+  * @param CLOCK_SYNC_t* sync
+  * @param const LINK_MESSAGE_t* reply
+  * @param uint32_t received µs, local time the reply arrived
+  * @return _Bool true if offset and drift were updated
+  */
+_Bool clock_syncReceive(CLOCK_SYNC_t* sync, const LINK_MESSAGE_t* reply, uint32_t received)
+{
+	CLOCK_SYNC_SAMPLE_t sample;
+	const CLOCK_SYNC_SAMPLE_t* best;
+
+	if(reply->type != LINK_MSG_SYNC_REPLY || reply->length != CLOCK_SYNC_PAYLOAD || !sync->pending
+			|| reply->id != sync->id || get32(reply->payload) != sync->requestTime)
+	{
+		sync->stats.rejected++;
+		return false;
+	}
+	sync->pending = false;
+	sync->stats.replies++;
+
+	uint32_t roundTrip = received - sync->requestTime;
+	uint32_t held = get32(&reply->payload[8]) - get32(&reply->payload[4]);
+	if(roundTrip > CLOCK_SYNC_MAX_DELAY || held > roundTrip)
+	{
+		sync->stats.rejected++;
+		return false;
+	}
+	sample.time = received;
+	sample.delay = roundTrip - held;
+	sample.offset = get32(&reply->payload[8]) - received + sample.delay / 2;
+
+	//after a long break the old exchanges say nothing any more
+	if(received - sync->picked > CLOCK_SYNC_MAX_AGE)
+	{
+		sync->filterCount = 0;
+		sync->picked = received - 1;
+	}
+	sync->filter[sync->filterNext] = sample;
+	sync->filterNext = (sync->filterNext + 1) % CLOCK_SYNC_FILTER;
+	if(sync->filterCount < CLOCK_SYNC_FILTER)
+		sync->filterCount++;
+
+	//shortest round trip, only passed on once and never an older one than before
+	best = &sync->filter[0];
+	for(uint8_t i = 1; i < sync->filterCount; i++)
+		if(sync->filter[i].delay < best->delay)
+			best = &sync->filter[i];
+	if((int32_t)(best->time - sync->picked) <= 0)
+		return false;
+	sync->picked = best->time;
+	sample = *best;
+	return add_point(sync, &sample);
+}
+/**
+  * @brief Answers a request (display side), the reply has the same length
+  * @param const LINK_MESSAGE_t* request
+  * @param uint32_t received µs, local time the request arrived
+  * @param uint32_t now µs, send the reply right away
+  * @param LINK_MESSAGE_t* reply
+  * @return _Bool false if the request has the wrong length
+  */
+_Bool clock_syncReply(const LINK_MESSAGE_t* request, uint32_t received, uint32_t now, LINK_MESSAGE_t* reply)
+{
+	if(request->length != CLOCK_SYNC_PAYLOAD)
+		return false;
+	memset(reply, 0, sizeof(*reply));
+	reply->type = LINK_MSG_SYNC_REPLY;
+	reply->id = request->id;
+	reply->length = CLOCK_SYNC_PAYLOAD;
+	memcpy(reply->payload, request->payload, 4);
+	put32(&reply->payload[4], received);
+	put32(&reply->payload[8], now);
+	return true;
+}
+/**
+  * @brief Offset and drift are known (CLOCK_SYNC_MIN_POINTS fitted)
+  * @param const CLOCK_SYNC_t* sync
+  * @return _Bool
+  */
+_Bool clock_syncIsSynchronized(const CLOCK_SYNC_t* sync)
+{
+	return sync->pointCount >= CLOCK_SYNC_MIN_POINTS;
+}
+/**
+  * @brief Converts a local time into the time of the peer, the local time
+  * 	   itself until the first exchange
+  * @param const CLOCK_SYNC_t* sync
+  * @param uint32_t local µs
+  * @return uint32_t µs
+  */
+uint32_t clock_syncRemote(const CLOCK_SYNC_t* sync, uint32_t local)
+{
+	if(sync->pointCount == 0)
+		return local;
+	return local + model_offset(sync, local);
+}
+/**
+  * @brief Estimated error of clock_syncRemote: scatter of the exchanges
+  * 	   around the fit, growing with the time since the last one. An
+  * 	   asymmetric radio path adds up to half the round trip unseen.
+  * @param const CLOCK_SYNC_t* sync
+  * @param uint32_t now µs
+  * @return uint32_t µs, CLOCK_SYNC_UNKNOWN if not synchronized
+  */
+uint32_t clock_syncError(const CLOCK_SYNC_t* sync, uint32_t now)
+{
+	uint32_t age = now - sync->reference;
+	if(!clock_syncIsSynchronized(sync) || age > CLOCK_SYNC_MAX_AGE)
+		return CLOCK_SYNC_UNKNOWN;
+	return sync->jitter + (age / 1000000) * CLOCK_SYNC_HOLDOVER;
+}
+/**
+  * @brief Local time in µs: HAL tick (ms) and the µs counter of its timer.
+  * 	   The system clock (MSI) runs in PLL mode on the LSE crystal, so this
+  * 	   clock has the accuracy of the crystal. Can be called from interrupts.
+  * @param None
+  * @return uint32_t µs, wraps after 71 minutes
+  */
+uint32_t clock_micros(void)
+{
+#ifdef USE_HAL_DRIVER
+	uint32_t tick;
+	uint32_t count;
+	_Bool pending;
+
+	do
+	{
+		tick = uwTick;
+		count = TIM6->CNT;
+		pending = (TIM6->SR & TIM_SR_UIF) != 0;
+	}
+	while(tick != uwTick);
+	//the counter wrapped, but the interrupt incrementing uwTick did not run yet
+	if(pending && count < CLOCK_TIMER_PERIOD / 2)
+		tick++;
+	return tick * CLOCK_TIMER_PERIOD + count;
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint32_t)(time.tv_sec * 1000000 + time.tv_nsec / 1000);
+#endif
+}
@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    histogram.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Log bucketed histogram (as HdrHistogram with 2 significant bits).
+  *
+  * 		 value 0..7       bucket = value
+  * 		 value >= 8       e = msb(value) - 2, bucket = 4 * e + (value >> e)
+  *
+  * 		 Recording is a count leading zeros and a shift, no division.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "histogram.h"
+#include <string.h>
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Clears all buckets
+  * @param HISTOGRAM_t* histogram
+  * @return None
+  */
+void histogram_reset(HISTOGRAM_t* histogram)
+{
+	memset(histogram, 0, sizeof(*histogram));
+}
+/**
+  * @brief Counts one value
+  * @param HISTOGRAM_t* histogram
+  * @param uint32_t value, above HISTOGRAM_MAX it counts in the last bucket
+  * @return None
+  */
+void histogram_record(HISTOGRAM_t* histogram, uint32_t value)
+{
+	histogram->counts[histogram_index(value)]++;
+	if(histogram->count == 0 || value < histogram->min)
+		histogram->min = value;
+	if(value > histogram->max)
+		histogram->max = value;
+	histogram->count++;
+	histogram->sum += value;
+}
+/**
+  * @brief Bucket of a value
+  * @param uint32_t value
+  * @return uint8_t index < HISTOGRAM_BUCKETS
+  */
+uint8_t histogram_index(uint32_t value)
+{
+	if(value > HISTOGRAM_MAX)
+		value = HISTOGRAM_MAX;
+	if(value < (1UL << HISTOGRAM_SUB_BITS))
+		return (uint8_t)value;
+	uint8_t shift = (uint8_t)(31 - __builtin_clz(value) - HISTOGRAM_SUB_BITS + 1);
+	return (uint8_t)(shift * HISTOGRAM_HALF + (value >> shift));
+}
+/**
+  * @brief Lowest value of a bucket
+  * @param uint8_t index < HISTOGRAM_BUCKETS
+  * @return uint32_t
+  */
+uint32_t histogram_low(uint8_t index)
+{
+	if(index < (1 << HISTOGRAM_SUB_BITS))
+		return index;
+	uint8_t shift = index / HISTOGRAM_HALF - 1;
+	return (uint32_t)(index - shift * HISTOGRAM_HALF) << shift;
+}
+/**
+  * @brief Highest value of a bucket
+  * @param uint8_t index < HISTOGRAM_BUCKETS
+  * @return uint32_t
+  */
+uint32_t histogram_high(uint8_t index)
+{
+	if(index + 1 >= HISTOGRAM_BUCKETS)
+		return HISTOGRAM_MAX;
+	return histogram_low(index + 1) - 1;
+}
+/**
+  * @brief Value below which the given share of the recorded values lies, the
+  * 	   upper end of its bucket (never above the largest value)
+  * @param const HISTOGRAM_t* histogram
+  * @param uint8_t percent 0..100
+  * @return uint32_t 0 if empty
+  */
+uint32_t histogram_percentile(const HISTOGRAM_t* histogram, uint8_t percent)
+{
+	uint32_t rank;
+	uint32_t seen = 0;
+
+	if(histogram->count == 0)
+		return 0;
+	rank = (uint32_t)(((uint64_t)histogram->count * percent + 99) / 100);
+	if(rank == 0)
+		return histogram->min;
+	for(uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += histogram->counts[i];
+		if(seen >= rank)
+			return (histogram_high(i) < histogram->max) ? histogram_high(i) : histogram->max;
+	}
+	return histogram->max;
+}
+/**
+  * @brief Mean of the recorded values
+  * @param const HISTOGRAM_t* histogram
+  * @return uint32_t 0 if empty
+  */
+uint32_t histogram_mean(const HISTOGRAM_t* histogram)
+{
+	return histogram->count ? (uint32_t)(histogram->sum / histogram->count) : 0;
+}
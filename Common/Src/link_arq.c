@@ -0,0 +1,363 @@
+/**
+  ******************************************************************************
+  * @file    link_arq.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Reliable delivery of link frames (Go-Back-N).
+  *
+  * 		 Data frames carry the session of the sender and a sequence number,
+  * 		 the receiver delivers them in order only and answers every one
+  * 		 with an ack (LINK_MSG_ACK, session, next expected sequence, id =
+  * 		 sequence of the frame that caused the ack). The
+  * 		 sender keeps up to window frames in flight and sends all of them
+  * 		 again when the oldest is not acked within the retransmission
+  * 		 timeout, or right away when an ack shows that a later frame arrived
+  * 		 but the oldest did not.
+  *
+  * 		 The timeout follows RFC 6298: smoothed round trip time plus four
+  * 		 times its variation, no samples from retransmitted frames (Karn),
+  * 		 doubled after every timeout until the next ack of new frames.
+  *
+  * 		 A session starts at sequence 0 and never wraps to it again (a new
+  * 		 session follows sequence 254). A receiver starts over at the first
+  * 		 frame of a new session (the peer restarted or gave up), any other
+  * 		 frame of a foreign session (stale, or the receiver restarted) is
+  * 		 acked with sequence 0. A sender that gets an ack far outside its
+  * 		 window, or one behind its window for a frame in flight, knows the
+  * 		 peer restarted and sends its frames again in a new session.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "link_arq.h"
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define SLOT(sequence) ((sequence) & (LINK_ARQ_MAX_WINDOW - 1))
+#define LINK_ARQ_LAST_SEQUENCE 0xFF //not sent, a new session starts instead (0 only starts a session)
+
+/* Private Functions ---------------------------------------------------------*/
+static uint8_t in_flight(const LINK_ARQ_t* arq)
+{
+	return (uint8_t)(arq->next - arq->base);
+}
+/*
+ * Next session number, never 0 (unsequenced frames)
+ */
+static uint8_t next_session(uint8_t session, uint32_t now)
+{
+	if(session == 0)
+		session = (uint8_t)(now ^ (now >> 8) ^ (now >> 16) ^ (now >> 24));
+	else
+		session++;
+	return (session == 0) ? 1 : session;
+}
+/*
+ * Cumulative ack up to expected, the id tells which frame caused it
+ */
+static void send_ack(LINK_ARQ_t* arq, const LINK_MESSAGE_t* message, uint8_t expected)
+{
+	LINK_MESSAGE_t ack;
+	ack.type = LINK_MSG_ACK;
+	ack.address = message->address; //same node as the acked frame, for it or from it
+	ack.id = message->sequence;
+	ack.session = message->session;
+	ack.sequence = expected;
+	ack.length = 0;
+	arq->stats.acks++;
+	arq->output(arq->context, &ack);
+}
+/*
+ * Sends every frame in flight again, the oldest first
+ */
+static void resend(LINK_ARQ_t* arq, uint32_t now)
+{
+	for(uint8_t sequence = arq->base; sequence != arq->next; sequence++)
+	{
+		arq->retransmitted[SLOT(sequence)] = true;
+		arq->stats.retransmitted++;
+		arq->output(arq->context, &arq->frames[SLOT(sequence)]);
+	}
+	arq->timerStart = now;
+}
+/*
+ * RFC 6298 with the scaling of Jacobson: srtt8 = 8 * SRTT, rttvar4 = 4 * RTTVAR
+ */
+static void update_rtt(LINK_ARQ_t* arq, uint32_t sample)
+{
+	histogram_record(&arq->rtt, sample);
+	if(!arq->measured)
+	{
+		arq->srtt8 = sample << 3;
+		arq->rttvar4 = sample << 1;
+		arq->measured = true;
+	}
+	else
+	{
+		int32_t delta = (int32_t)sample - (int32_t)(arq->srtt8 >> 3);
+		arq->srtt8 += delta;
+		if(delta < 0)
+			delta = -delta;
+		arq->rttvar4 += delta - (int32_t)(arq->rttvar4 >> 2);
+	}
+}
+/*
+ * SRTT + 4 * RTTVAR without backoff, the initial value until the first sample
+ */
+static uint32_t base_rto(const LINK_ARQ_t* arq)
+{
+	uint32_t rto;
+	if(!arq->measured)
+		return LINK_ARQ_RTO_INITIAL;
+	rto = (arq->srtt8 >> 3) + ((arq->rttvar4 > 0) ? arq->rttvar4 : 1);
+	if(rto < LINK_ARQ_RTO_MIN)
+		return LINK_ARQ_RTO_MIN;
+	return (rto > LINK_ARQ_RTO_MAX) ? LINK_ARQ_RTO_MAX : rto;
+}
+/*
+ * The peer does not know the session (it restarted): the frames in flight are
+ * numbered from 0 in a new session and sent again
+ */
+static void resync(LINK_ARQ_t* arq, uint32_t now)
+{
+	uint8_t count = in_flight(arq);
+	LINK_MESSAGE_t frames[LINK_ARQ_MAX_WINDOW];
+
+	for(uint8_t i = 0; i < count; i++)
+		frames[i] = arq->frames[SLOT(arq->base + i)];
+	arq->session = next_session(arq->session, now);
+	arq->base = 0;
+	arq->next = count;
+	arq->retries = 0;
+	arq->fastResent = false;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		frames[i].session = arq->session;
+		frames[i].sequence = i;
+		arq->frames[SLOT(i)] = frames[i];
+		arq->sentTime[SLOT(i)] = now;
+		arq->retransmitted[SLOT(i)] = true;
+		arq->stats.retransmitted++;
+		arq->output(arq->context, &arq->frames[SLOT(i)]);
+	}
+	arq->timerStart = now;
+	arq->stats.resyncs++;
+}
+static void handle_ack(LINK_ARQ_t* arq, const LINK_MESSAGE_t* ack, uint32_t now)
+{
+	uint8_t acked = (uint8_t)(ack->sequence - arq->base);
+	uint8_t behind = (uint8_t)(arq->base - ack->sequence);
+	uint8_t cause = (uint8_t)(ack->id - arq->base); //frame that caused the ack, relative to base
+
+	if(arq->session == 0 || ack->session != arq->session)
+		return; //ack of an older session
+	if(acked == 0 && cause > 0 && cause < in_flight(arq) && !arq->fastResent)
+	{
+		//the peer got a later frame but not the oldest: lost, no need to wait for the timeout.
+		//Acks of duplicates (id before base) say nothing about a loss.
+		arq->fastResent = true;
+		resend(arq, now);
+		return;
+	}
+	if(acked == 0)
+		return; //duplicate ack
+	if(acked > in_flight(arq))
+	{
+		//just behind the window it is a delayed ack, unless a frame in flight caused it:
+		//then the peer restarted and expects 0 again, as it does far outside the window
+		if(behind > LINK_ARQ_MAX_WINDOW || cause < in_flight(arq))
+			resync(arq, now);
+		return;
+	}
+
+	//the newest acked frame gives the sample, it has the shortest queueing delay
+	uint8_t newest = SLOT(ack->sequence - 1);
+	if(!arq->retransmitted[newest])
+		update_rtt(arq, now - arq->sentTime[newest]);
+	//the peer answers again: the backoff ends, as in most TCP stacks
+	arq->rto = base_rto(arq);
+	arq->base = ack->sequence;
+	arq->retries = 0;
+	arq->fastResent = false;
+	arq->stats.acked += acked;
+	arq->timerStart = now;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Resets sender and receiver
+  * @param LINK_ARQ_t* arq
+  * @param uint8_t window frames in flight, 1 (stop and wait) to LINK_ARQ_MAX_WINDOW
+  * @param LINK_ARQ_OUTPUT_t output sends a frame, context is passed along
+  * @return None
+  */
+void link_arqInit(LINK_ARQ_t* arq, uint8_t window, LINK_ARQ_OUTPUT_t output, void* context)
+{
+	memset(arq, 0, sizeof(*arq));
+	arq->window = (window < 1) ? 1 : (window > LINK_ARQ_MAX_WINDOW) ? LINK_ARQ_MAX_WINDOW : window;
+	arq->rto = LINK_ARQ_RTO_INITIAL;
+	arq->output = output;
+	arq->context = context;
+}
+/**
+  * @brief Numbers the frame, keeps a copy for retransmission and sends it
+  * @param LINK_ARQ_t* arq
+  * @param const LINK_MESSAGE_t* message, session and sequence are filled in
+  * @param uint32_t now in ms
+  * @return LINK_ARQ_STATUS_t LINK_ARQ_FULL if window frames are in flight (or
+  * 		 any at the end of a session), nothing sent
+  */
+LINK_ARQ_STATUS_t link_arqSend(LINK_ARQ_t* arq, const LINK_MESSAGE_t* message, uint32_t now)
+{
+	if(in_flight(arq) >= arq->window)
+		return LINK_ARQ_FULL;
+	if(arq->next == LINK_ARQ_LAST_SEQUENCE)
+	{
+		//a receiver that restarted would take a wrapped 0 for the start of the session
+		if(in_flight(arq) > 0)
+			return LINK_ARQ_FULL;
+		arq->session = next_session(arq->session, now);
+		arq->base = arq->next = 0;
+	}
+	if(arq->session == 0)
+		arq->session = next_session(0, now);
+	if(in_flight(arq) == 0)
+		arq->timerStart = now;
+
+	uint8_t slot = SLOT(arq->next);
+	arq->frames[slot] = *message;
+	arq->frames[slot].session = arq->session;
+	arq->frames[slot].sequence = arq->next;
+	arq->sentTime[slot] = now;
+	arq->retransmitted[slot] = false;
+	arq->next++;
+	arq->stats.sent++;
+	arq->output(arq->context, &arq->frames[slot]);
+	return LINK_ARQ_OK;
+}
+/**
+  * @brief Handles a decoded frame: acks are consumed, data frames are acked
+  * 	   and passed on in order only, unsequenced frames (session 0) pass
+  * @param LINK_ARQ_t* arq
+  * @param const LINK_MESSAGE_t* message
+  * @param uint32_t now in ms
+  * @return _Bool true if the caller has to handle the message
+  */
+_Bool link_arqReceive(LINK_ARQ_t* arq, const LINK_MESSAGE_t* message, uint32_t now)
+{
+	if(message->type == LINK_MSG_ACK)
+	{
+		handle_ack(arq, message, now);
+		return false;
+	}
+	if(message->session == 0)
+		return true;
+	if(message->session != arq->peerSession)
+	{
+		if(message->sequence != 0)
+		{
+			//stale frame of an old session, it must not move expected, or this receiver
+			//restarted and missed the start: 0 makes the sender start a new session
+			arq->stats.duplicates++;
+			send_ack(arq, message, 0);
+			return false;
+		}
+		arq->peerSession = message->session;
+		arq->expected = 0;
+	}
+	if(message->sequence != arq->expected)
+	{
+		//lost frame before this one, or ack lost: the ack tells the sender where to go on
+		arq->stats.duplicates++;
+		send_ack(arq, message, arq->expected);
+		return false;
+	}
+	arq->expected++;
+	arq->stats.delivered++;
+	send_ack(arq, message, arq->expected);
+	return true;
+}
+/**
+  * @brief Sends the frames in flight again when the oldest one timed out,
+  * 	   gives them up after LINK_ARQ_MAX_RETRIES timeouts in a row
+  * @param LINK_ARQ_t* arq
+  * @param uint32_t now in ms
+  * @return None
+  */
+void link_arqPoll(LINK_ARQ_t* arq, uint32_t now)
+{
+	if(in_flight(arq) == 0 || (now - arq->timerStart) < arq->rto)
+		return;
+
+	arq->stats.timeouts++;
+	if(++arq->retries > LINK_ARQ_MAX_RETRIES)
+	{
+		//link is down, the callers must not wait for ever: a new session starts empty
+		arq->stats.lost += in_flight(arq);
+		arq->session = next_session(arq->session, now);
+		arq->base = arq->next = 0;
+		arq->retries = 0;
+		arq->fastResent = false;
+		arq->measured = false;
+		arq->rto = base_rto(arq);
+		return;
+	}
+	arq->rto = (arq->rto * 2 > LINK_ARQ_RTO_MAX) ? LINK_ARQ_RTO_MAX : arq->rto * 2;
+	resend(arq, now);
+}
+/**
+  * @brief Time until link_arqPoll has to run
+  * @param const LINK_ARQ_t* arq
+  * @param uint32_t now in ms
+  * @return uint32_t ms, 0 if overdue, LINK_ARQ_NEVER if nothing is in flight
+  */
+uint32_t link_arqNextTimeout(const LINK_ARQ_t* arq, uint32_t now)
+{
+	uint32_t elapsed = now - arq->timerStart;
+
+	if(in_flight(arq) == 0)
+		return LINK_ARQ_NEVER;
+	return (elapsed >= arq->rto) ? 0 : arq->rto - elapsed;
+}
+/**
+  * @brief Frames sent and not acked yet
+  * @param const LINK_ARQ_t* arq
+  * @return uint8_t
+  */
+uint8_t link_arqInFlight(const LINK_ARQ_t* arq)
+{
+	return in_flight(arq);
+}
+/**
+  * @brief Copy of the counters with the current round trip estimate
+  * @param const LINK_ARQ_t* arq
+  * @param LINK_ARQ_STATS_t* copy
+  * @return None
+  */
+void link_arqGetStats(const LINK_ARQ_t* arq, LINK_ARQ_STATS_t* copy)
+{
+	*copy = arq->stats;
+	copy->srtt = arq->measured ? arq->srtt8 >> 3 : 0;
+	copy->rttvar = arq->measured ? arq->rttvar4 >> 2 : 0;
+	copy->rto = arq->rto;
+}
+/**
+  * @brief Copy of the round trip time histogram (ms)
+  * @param const LINK_ARQ_t* arq
+  * @param HISTOGRAM_t* copy
+  * @return None
+  */
+void link_arqGetRtt(const LINK_ARQ_t* arq, HISTOGRAM_t* copy)
+{
+	*copy = arq->rtt;
+}
+/**
+  * @brief Clears counters and histogram, the round trip estimate stays
+  * @param LINK_ARQ_t* arq
+  * @return None
+  */
+void link_arqResetStats(LINK_ARQ_t* arq)
+{
+	memset(&arq->stats, 0, sizeof(arq->stats));
+	histogram_reset(&arq->rtt);
+}
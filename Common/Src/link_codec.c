@@ -0,0 +1,351 @@
+/**
+  ******************************************************************************
+  * @file    link_codec.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Binary framing of the link between both boards.
+  *
+  * 		 Frame: 0x00 | COBS(type | address | id | session | sequence | length | payload | CRC-16 high | low) | 0x00
+  *
+  * 		 The id correlates a reply with its request, so several requests
+  * 		 can be in flight and a late reply is never taken for a newer one.
+  * 		 Session and sequence belong to the retransmission layer (link_arq.c).
+  *
+  * 		 The length byte catches frames cut at a lost or corrupted
+  * 		 delimiter, which the CRC alone misses when the cut drops a zero.
+  *
+  * 		 The CRC is CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)
+  * 		 over header and payload. On the target it runs on the CRC unit,
+  * 		 on the host a bitwise version is used.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "link_codec.h"
+#include <string.h>
+#ifdef USE_HAL_DRIVER
+#include "stm32l4xx_hal.h"
+#endif
+
+/* Defines -------------------------------------------------------------------*/
+#define CRC_POLYNOMIAL 0x1021
+#define CRC_INIT 0xFFFF
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * COBS: every 0x00 is replaced by the distance to the next one, so the
+ * delimiter never appears inside the frame
+ */
+static uint16_t cobs_encode(const uint8_t* data, uint16_t length, uint8_t* out)
+{
+	uint16_t code = 0;
+	uint16_t write = 1;
+	uint8_t distance = 1;
+
+	for(uint16_t i = 0; i < length; i++)
+	{
+		if(data[i] != 0)
+		{
+			out[write++] = data[i];
+			distance++;
+		}
+		if(data[i] == 0 || distance == 0xFF)
+		{
+			out[code] = distance;
+			code = write++;
+			distance = 1;
+		}
+	}
+	out[code] = distance;
+	return write;
+}
+/*
+ * Returns the decoded length or -1 for a malformed frame
+ */
+static int32_t cobs_decode(const uint8_t* data, uint16_t length, uint8_t* out, uint16_t size)
+{
+	uint16_t read = 0;
+	uint16_t write = 0;
+
+	while(read < length)
+	{
+		uint8_t code = data[read++];
+		if(code == 0 || read + code - 1 > length)
+			return -1;
+		for(uint8_t i = 1; i < code; i++)
+		{
+			if(data[read] == 0 || write >= size)
+				return -1;
+			out[write++] = data[read++];
+		}
+		if(code != 0xFF && read < length)
+		{
+			if(write >= size)
+				return -1;
+			out[write++] = 0;
+		}
+	}
+	return write;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Enables and configures the CRC unit for CRC-16/CCITT-FALSE
+  * @param None
+  * @retval None
+  */
+void link_Init(void)
+{
+#ifdef USE_HAL_DRIVER
+	__HAL_RCC_CRC_CLK_ENABLE();
+	CRC->POL = CRC_POLYNOMIAL;
+	CRC->INIT = CRC_INIT;
+	CRC->CR = CRC_CR_POLYSIZE_0; //16 bit, no reversal
+#endif
+}
+
+/**
+  * @brief CRC-16/CCITT-FALSE ("123456789" -> 0x29B1)
+  * @param const uint8_t* data
+  * @param uint16_t length
+  * @return uint16_t crc
+  */
+uint16_t link_crc16(const uint8_t* data, uint16_t length)
+{
+#ifdef USE_HAL_DRIVER
+	//both tasks and the uart callback encode, the unit holds a single state
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CRC->CR |= CRC_CR_RESET;
+	for(uint16_t i = 0; i < length; i++)
+		*(__IO uint8_t*)&CRC->DR = data[i];
+	uint16_t crc = (uint16_t)CRC->DR;
+	__set_PRIMASK(primask);
+	return crc;
+#else
+	uint16_t crc = CRC_INIT;
+	for(uint16_t i = 0; i < length; i++)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+		for(uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC_POLYNOMIAL) : (uint16_t)(crc << 1);
+	}
+	return crc;
+#endif
+}
+
+/**
+  * @brief Builds the complete frame including both delimiters
+  * @param const LINK_MESSAGE_t* message
+  * @param uint8_t* frame
+  * @param uint16_t size of frame, LINK_MAX_FRAME is always enough
+  * @return uint16_t frame length, 0 if the message does not fit
+  */
+uint16_t link_encode(const LINK_MESSAGE_t* message, uint8_t* frame, uint16_t size)
+{
+	uint8_t plain[LINK_MAX_PAYLOAD + LINK_HEADER_SIZE + 2];
+	uint16_t used = message->length + LINK_HEADER_SIZE;
+
+	if(message->length > LINK_MAX_PAYLOAD || size < used + 5)
+		return 0;
+
+	plain[0] = message->type;
+	plain[1] = message->address;
+	plain[2] = message->id;
+	plain[3] = message->session;
+	plain[4] = message->sequence;
+	plain[5] = message->length;
+	memcpy(&plain[LINK_HEADER_SIZE], message->payload, message->length);
+	uint16_t crc = link_crc16(plain, used);
+	plain[used] = crc >> 8;
+	plain[used + 1] = crc & 0xFF;
+
+	frame[0] = LINK_DELIMITER;
+	uint16_t length = cobs_encode(plain, used + 2, &frame[1]);
+	frame[length + 1] = LINK_DELIMITER;
+	return length + 2;
+}
+
+/**
+  * @brief Decodes one frame, with or without the delimiters around it
+  * @param const uint8_t* frame
+  * @param uint16_t length
+  * @param LINK_MESSAGE_t* message
+  * @return LINK_STATUS_t
+  */
+LINK_STATUS_t link_decode(const uint8_t* frame, uint16_t length, LINK_MESSAGE_t* message)
+{
+	uint8_t plain[LINK_MAX_PAYLOAD + LINK_HEADER_SIZE + 2];
+
+	if(length > 0 && frame[0] == LINK_DELIMITER)
+	{
+		frame++;
+		length--;
+	}
+	if(length > 0 && frame[length - 1] == LINK_DELIMITER)
+		length--;
+	if(length == 0)
+		return LINK_ERR_LENGTH;
+
+	int32_t decoded = cobs_decode(frame, length, plain, sizeof(plain));
+	if(decoded < 0)
+		return LINK_ERR_COBS;
+	if(decoded < LINK_HEADER_SIZE + 2 || plain[5] != decoded - LINK_HEADER_SIZE - 2)
+		return LINK_ERR_LENGTH;
+
+	uint16_t crc = ((uint16_t)plain[decoded - 2] << 8) | plain[decoded - 1];
+	if(link_crc16(plain, decoded - 2) != crc)
+		return LINK_ERR_CRC;
+
+	message->type = plain[0];
+	message->address = plain[1];
+	message->id = plain[2];
+	message->session = plain[3];
+	message->sequence = plain[4];
+	message->length = plain[5];
+	memcpy(message->payload, &plain[LINK_HEADER_SIZE], message->length);
+	return LINK_OK;
+}
+
+/**
+  * @brief Packs red, green, blue, infrared and clear with 19 bit each (LSB
+  * 	   first), larger values saturate, followed by the time of the sample
+  * 	   and its error (LSB first)
+  * @param const uint32_t* channels (LINK_SAMPLE_CHANNELS)
+  * @param uint32_t time µs, clock of the display (clock_sync.h)
+  * @param uint32_t error µs, saturates, LINK_SAMPLE_UNSYNCED if not synchronized
+  * @param LINK_MESSAGE_t* message
+  * @param uint8_t type
+  * @retval None
+  */
+void link_packSample(const uint32_t* channels, uint32_t time, uint32_t error, LINK_MESSAGE_t* message, uint8_t type)
+{
+	uint16_t bit = 0;
+
+	message->type = type;
+	message->length = LINK_SAMPLE_LENGTH;
+	memset(message->payload, 0, LINK_SAMPLE_BYTES);
+	for(uint8_t channel = 0; channel < LINK_SAMPLE_CHANNELS; channel++)
+	{
+		uint32_t value = (channels[channel] > LINK_SAMPLE_MAX) ? LINK_SAMPLE_MAX : channels[channel];
+		for(uint8_t i = 0; i < LINK_SAMPLE_BITS; i++, bit++)
+			if(value & (1UL << i))
+				message->payload[bit / 8] |= 1 << (bit % 8);
+	}
+	if(error > LINK_SAMPLE_UNSYNCED)
+		error = LINK_SAMPLE_UNSYNCED;
+	for(uint8_t i = 0; i < 4; i++)
+		message->payload[LINK_SAMPLE_BYTES + i] = (uint8_t)(time >> (8 * i));
+	message->payload[LINK_SAMPLE_BYTES + 4] = (uint8_t)error;
+	message->payload[LINK_SAMPLE_BYTES + 5] = (uint8_t)(error >> 8);
+}
+
+/**
+  * @brief Unpacks a sample built by link_packSample
+  * @param const LINK_MESSAGE_t* message
+  * @param uint32_t* channels (LINK_SAMPLE_CHANNELS)
+  * @param uint32_t* time µs, clock of the display
+  * @param uint16_t* error µs, LINK_SAMPLE_UNSYNCED if not synchronized
+  * @return _Bool false if the payload has the wrong length
+  */
+_Bool link_unpackSample(const LINK_MESSAGE_t* message, uint32_t* channels, uint32_t* time, uint16_t* error)
+{
+	uint16_t bit = 0;
+	const uint8_t* stamp = &message->payload[LINK_SAMPLE_BYTES];
+
+	if(message->length != LINK_SAMPLE_LENGTH)
+		return false;
+	for(uint8_t channel = 0; channel < LINK_SAMPLE_CHANNELS; channel++)
+	{
+		channels[channel] = 0;
+		for(uint8_t i = 0; i < LINK_SAMPLE_BITS; i++, bit++)
+			if(message->payload[bit / 8] & (1 << (bit % 8)))
+				channels[channel] |= 1UL << i;
+	}
+	*time = (uint32_t)stamp[0] | ((uint32_t)stamp[1] << 8) | ((uint32_t)stamp[2] << 16) | ((uint32_t)stamp[3] << 24);
+	*error = (uint16_t)(stamp[4] | (stamp[5] << 8));
+	return true;
+}
+
+/**
+  * @brief Starts over, e.g. after received bytes were lost
+  * @param LINK_RECEIVER_t* receiver
+  * @retval None
+  */
+void link_resetReceiver(LINK_RECEIVER_t* receiver)
+{
+	receiver->length = 0;
+	receiver->binary = false;
+	receiver->overflow = false;
+	receiver->complete = false;
+	receiver->paused = false;
+}
+
+/**
+  * @brief Splits the received byte stream into frames (between delimiters)
+  * 	   and ASCII commands (ended by CR/LF), one byte at a time
+  * @param LINK_RECEIVER_t* receiver
+  * @param uint8_t byte
+  * @return LINK_RX_RESULT_t, receiver->data is valid until the next call
+  */
+LINK_RX_RESULT_t link_receive(LINK_RECEIVER_t* receiver, uint8_t byte)
+{
+	LINK_RX_RESULT_t result = LINK_RX_NONE;
+
+	if(receiver->complete)
+	{
+		receiver->length = 0;
+		receiver->overflow = false;
+		receiver->complete = false;
+		receiver->paused = false;
+	}
+
+	if(byte == LINK_DELIMITER)
+	{
+		//closes a frame, opens one, or ends an unterminated command
+		if(receiver->length > 0)
+			result = receiver->overflow ? LINK_RX_OVERFLOW : (receiver->binary ? LINK_RX_FRAME : LINK_RX_TEXT);
+		receiver->binary = !(receiver->binary && receiver->length > 0);
+	}
+	else if(!receiver->binary && (byte == '\r' || byte == '\n'))
+	{
+		if(receiver->length > 0)
+			result = receiver->overflow ? LINK_RX_OVERFLOW : LINK_RX_TEXT;
+	}
+	else
+	{
+		if(receiver->length < LINK_RX_SIZE)
+			receiver->data[receiver->length++] = byte;
+		else
+			receiver->overflow = true;
+	}
+
+	if(result != LINK_RX_NONE)
+	{
+		receiver->data[receiver->length] = '\0';
+		receiver->complete = true;
+	}
+	return result;
+}
+
+/**
+  * @brief Idle line: ends a command sent without CR/LF, a frame has to wait
+  * 	   for its delimiter (the radio may pause inside a frame) and is marked
+  * 	   paused, it may also have lost its delimiter and only end with the
+  * 	   next burst
+  * @param LINK_RECEIVER_t* receiver
+  * @return LINK_RX_RESULT_t
+  */
+LINK_RX_RESULT_t link_receiveIdle(LINK_RECEIVER_t* receiver)
+{
+	if(receiver->complete || receiver->length == 0)
+		return LINK_RX_NONE;
+	if(receiver->binary)
+	{
+		receiver->paused = true;
+		return LINK_RX_NONE;
+	}
+	receiver->data[receiver->length] = '\0';
+	receiver->complete = true;
+	return receiver->overflow ? LINK_RX_OVERFLOW : LINK_RX_TEXT;
+}
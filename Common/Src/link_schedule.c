@@ -0,0 +1,284 @@
+/**
+  ******************************************************************************
+  * @file    link_schedule.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Polling of several sensor nodes on one radio channel.
+  *
+  * 		 The display sends LINK_MSG_POLL with the address of one node, the
+  * 		 node sends everything it queued since its last turn and ends the
+  * 		 turn with LINK_MSG_POLL_REPLY (its newest sample, or empty). Then
+  * 		 the display polls the next node. A turn also ends when nothing of
+  * 		 the node arrived within LINK_ANSWER_TIMEOUT or the reply is
+  * 		 missing after LINK_TURN_TIMEOUT (poll or reply lost).
+  *
+  * 		 Poll and poll reply are the last frames of a burst, they only
+  * 		 count when the line goes idle after them. One that lost its
+  * 		 closing delimiter is only completed by the next burst, a turn
+  * 		 taken or ended then would overlap the next one. A poll the idle
+  * 		 line interrupted or more frames followed is dropped, the reply
+  * 		 carries the id of its poll, one of an earlier turn never ends the
+  * 		 current one.
+  *
+  * 		 The cycle is as long as the turns of the nodes that answer, so the
+  * 		 sample rate per node drops with their number instead of frames
+  * 		 colliding. Nodes that missed LINK_ABSENT_MISSES turns in a row are
+  * 		 only polled every LINK_PROBE_CYCLES cycles, an absent node costs
+  * 		 the others little (LINK_ANSWER_TIMEOUT / LINK_PROBE_CYCLES per
+  * 		 cycle). A node that hears no poll for LINK_POLL_LOST (display
+  * 		 off, single board setup) transmits freely, after a reset it
+  * 		 listens that long first.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "link_schedule.h"
+#include <string.h>
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t turn_limit(const LINK_SCHEDULER_t* scheduler)
+{
+	return scheduler->answered ? LINK_TURN_TIMEOUT : LINK_ANSWER_TIMEOUT;
+}
+/*
+ * An absent node is polled every LINK_PROBE_CYCLES cycles, each one in
+ * another cycle so the probes do not add up to one long gap. Every node is
+ * polled while none is present.
+ */
+static _Bool is_due(const LINK_SCHEDULER_t* scheduler, uint8_t address)
+{
+	return scheduler->nodes[address - 1].present || (scheduler->cycles + address) % LINK_PROBE_CYCLES == 0
+			|| link_schedulerPresent(scheduler) == 0;
+}
+static void count_miss(LINK_SCHEDULER_t* scheduler, uint8_t address)
+{
+	scheduler->nodes[address - 1].misses++;
+	if(scheduler->misses[address - 1] < UINT8_MAX)
+		scheduler->misses[address - 1]++;
+	if(scheduler->misses[address - 1] >= LINK_ABSENT_MISSES)
+		scheduler->nodes[address - 1].present = false;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Resets the scheduler, all nodes start absent and are polled in the
+  * 	   first cycle
+  * @param LINK_SCHEDULER_t* scheduler
+  * @param uint8_t count nodes with addresses 1..count, at most LINK_MAX_NODES
+  * @param uint32_t now in ms
+  * @return None
+  */
+void link_schedulerInit(LINK_SCHEDULER_t* scheduler, uint8_t count, uint32_t now)
+{
+	memset(scheduler, 0, sizeof(*scheduler));
+	scheduler->count = (count > LINK_MAX_NODES) ? LINK_MAX_NODES : count;
+	scheduler->cycleStart = now;
+}
+/**
+  * @brief Ends the running turn when it timed out and picks the next node
+  * @param LINK_SCHEDULER_t* scheduler
+  * @param uint32_t now in ms
+  * @param uint32_t delay ms until the poll leaves (bytes queued before it),
+  * 	   the turn timeouts start from there
+  * @param LINK_MESSAGE_t* poll for the next node, unsequenced
+  * @return _Bool true if the poll has to be sent now, false while a turn runs
+  */
+_Bool link_schedulerPoll(LINK_SCHEDULER_t* scheduler, uint32_t now, uint32_t delay, LINK_MESSAGE_t* poll)
+{
+	if(scheduler->waiting)
+	{
+		if((int32_t)(now - scheduler->turnStart) < (int32_t)turn_limit(scheduler))
+			return false;
+		count_miss(scheduler, scheduler->current);
+		scheduler->waiting = false;
+	}
+	//the rest of this cycle and at most the next one, which is a probe cycle if nobody is present
+	for(uint8_t i = 0; i < 2 * scheduler->count; i++)
+	{
+		uint8_t address = scheduler->current % scheduler->count + 1;
+		if(address <= scheduler->current)
+		{
+			scheduler->cycle = now - scheduler->cycleStart;
+			scheduler->cycleStart = now;
+			scheduler->cycles++;
+		}
+		scheduler->current = address;
+		if(!is_due(scheduler, address))
+			continue;
+		scheduler->waiting = true;
+		scheduler->answered = false;
+		scheduler->ending = false;
+		scheduler->turnStart = now + delay;
+		scheduler->turn++;
+		scheduler->nodes[address - 1].polls++;
+		memset(poll, 0, sizeof(*poll));
+		poll->type = LINK_MSG_POLL;
+		poll->address = address;
+		poll->id = scheduler->turn;
+		return true;
+	}
+	return false;
+}
+/**
+  * @brief Frame from a node: any frame of the polled node extends its turn
+  * 	   to LINK_TURN_TIMEOUT, after LINK_MSG_POLL_REPLY the turn ends at
+  * 	   the idle line (link_schedulerIdle)
+  * @param LINK_SCHEDULER_t* scheduler
+  * @param const LINK_MESSAGE_t* message
+  * @param uint32_t now in ms
+  * @return None
+  */
+void link_schedulerReceive(LINK_SCHEDULER_t* scheduler, const LINK_MESSAGE_t* message, uint32_t now)
+{
+	//a reply followed by more frames came late, its turn is over
+	scheduler->ending = false;
+	if(!scheduler->waiting || message->address != scheduler->current)
+		return;
+	scheduler->answered = true;
+	if(message->type != LINK_MSG_POLL_REPLY || message->id != scheduler->turn)
+		return;
+
+	LINK_NODE_STATS_t* node = &scheduler->nodes[message->address - 1];
+	if(message->length == LINK_SAMPLE_LENGTH)
+	{
+		if(node->samples > 0)
+			node->interval = node->interval ? (node->interval * 7 + (now - node->lastSample)) / 8 : now - node->lastSample;
+		node->samples++;
+		node->lastSample = now;
+	}
+	scheduler->ending = true;
+}
+/**
+  * @brief The receive line went idle, ends the turn if the poll reply was the
+  * 	   last frame
+  * @param LINK_SCHEDULER_t* scheduler
+  * @return _Bool true if the turn ended, the next node can be polled
+  */
+_Bool link_schedulerIdle(LINK_SCHEDULER_t* scheduler)
+{
+	if(!scheduler->waiting || !scheduler->ending)
+		return false;
+	scheduler->nodes[scheduler->current - 1].turns++;
+	scheduler->nodes[scheduler->current - 1].present = true;
+	scheduler->misses[scheduler->current - 1] = 0;
+	scheduler->waiting = false;
+	scheduler->ending = false;
+	return true;
+}
+/**
+  * @brief Time until link_schedulerPoll has to be called again
+  * @param const LINK_SCHEDULER_t* scheduler
+  * @param uint32_t now in ms
+  * @return uint32_t ms, 0 if no turn runs
+  */
+uint32_t link_schedulerNextTimeout(const LINK_SCHEDULER_t* scheduler, uint32_t now)
+{
+	if(!scheduler->waiting)
+		return 0;
+	int32_t left = (int32_t)(scheduler->turnStart + turn_limit(scheduler) - now);
+	return (left > 0) ? (uint32_t)left : 0;
+}
+/**
+  * @brief Nodes that answered their last polls
+  * @param const LINK_SCHEDULER_t* scheduler
+  * @return uint8_t bit (address - 1) set for every present node
+  */
+uint8_t link_schedulerPresent(const LINK_SCHEDULER_t* scheduler)
+{
+	uint8_t present = 0;
+	for(uint8_t i = 0; i < scheduler->count; i++)
+		if(scheduler->nodes[i].present)
+			present |= 1 << i;
+	return present;
+}
+/**
+  * @brief Copy of the counters of one node
+  * @param const LINK_SCHEDULER_t* scheduler
+  * @param uint8_t address 1..count
+  * @param LINK_NODE_STATS_t* copy
+  * @return _Bool false if the address is not polled
+  */
+_Bool link_schedulerGetStats(const LINK_SCHEDULER_t* scheduler, uint8_t address, LINK_NODE_STATS_t* copy)
+{
+	if(address < 1 || address > scheduler->count)
+		return false;
+	*copy = scheduler->nodes[address - 1];
+	return true;
+}
+/**
+  * @brief Resets a node. It listens for polls LINK_POLL_LOST long before it
+  * 	   transmits freely, a node joining a polled channel waits for its turn.
+  * @param LINK_NODE_t* node
+  * @param uint8_t address 1..LINK_MAX_NODES
+  * @param uint32_t now in ms
+  * @return None
+  */
+void link_nodeInit(LINK_NODE_t* node, uint8_t address, uint32_t now)
+{
+	memset(node, 0, sizeof(*node));
+	node->address = address;
+	node->polled = true;
+	node->lastPoll = now;
+}
+/**
+  * @brief Filters a decoded frame by address, a poll for any node shows that
+  * 	   a display schedules the channel. The turn of this node starts at the
+  * 	   idle line after its poll (link_nodeIdle).
+  * @param LINK_NODE_t* node
+  * @param const LINK_MESSAGE_t* message
+  * @param _Bool paused the line went idle inside the frame (LINK_RECEIVER_t)
+  * @param uint32_t now in ms
+  * @return _Bool true if the frame is for this node (or all), handle it
+  */
+_Bool link_nodeReceive(LINK_NODE_t* node, const LINK_MESSAGE_t* message, _Bool paused, uint32_t now)
+{
+	//a poll followed by more frames came late, the turn belongs to another node by now
+	if(node->pending)
+	{
+		node->pending = false;
+		node->late++;
+	}
+	if(message->type == LINK_MSG_POLL)
+	{
+		node->polled = true;
+		node->lastPoll = now;
+		node->pending = (message->address == node->address && !paused);
+		node->turn = message->id;
+		if(message->address == node->address && paused)
+			node->late++;
+		return false;
+	}
+	return message->address == node->address || message->address == LINK_ADDRESS_BROADCAST;
+}
+/**
+  * @brief The receive line went idle, the turn starts if the poll for this
+  * 	   node was the last frame
+  * @param LINK_NODE_t* node
+  * @param LINK_MESSAGE_t* reply that ends the turn, empty: the caller may
+  * 	   pack a sample into it (link_packSample keeps address and id)
+  * @return _Bool true if the node has to send now, the reply last
+  */
+_Bool link_nodeIdle(LINK_NODE_t* node, LINK_MESSAGE_t* reply)
+{
+	if(!node->pending)
+		return false;
+	node->pending = false;
+	node->turns++;
+	memset(reply, 0, sizeof(*reply));
+	reply->type = LINK_MSG_POLL_REPLY;
+	reply->address = node->address;
+	reply->id = node->turn;
+	return true;
+}
+/**
+  * @brief True while the node may only transmit in its own turn
+  * @param LINK_NODE_t* node
+  * @param uint32_t now in ms
+  * @return _Bool false before the first poll and LINK_POLL_LOST after the last one
+  */
+_Bool link_nodeIsPolled(LINK_NODE_t* node, uint32_t now)
+{
+	if(node->polled && now - node->lastPoll > LINK_POLL_LOST)
+		node->polled = false;
+	return node->polled;
+}
@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    log.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Deferred binary logging on USART2.
+  *
+  * 		 Every record goes out as link frame (link_codec.h) of type
+  * 		 LINK_MSG_LOG: id (16 bit), level, time (32 bit), arguments
+  * 		 (32 bit each), little endian. Tools/log_decode.py formats them.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "log.h"
+#include "link_codec.h"
+#include <stdarg.h>
+#ifdef USE_HAL_DRIVER
+#include "main.h"
+#include "cmsis_os.h"
+#endif
+
+/* Globals -------------------------------------------------------------------*/
+static LOG_RECORD_t ring[LOG_RING_SIZE];
+static volatile uint32_t head = 0; //next record to write (free running)
+static volatile uint32_t tail = 0; //next record to send
+static volatile uint32_t dropped = 0;
+
+#ifdef USE_HAL_DRIVER
+extern UART_HandleTypeDef huart2;
+
+static osThreadId_t logTaskHandle;
+
+static const osThreadAttr_t logTask_attributes = {
+  .name = "logTask",
+  .stack_size = 128 * 4,
+  .priority = (osPriority_t) osPriorityLow,
+};
+#endif
+
+/* Private Functions ---------------------------------------------------------*/
+#ifdef USE_HAL_DRIVER
+static void put32(uint8_t* data, uint32_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+static void send_record(const LOG_RECORD_t* record)
+{
+	LINK_MESSAGE_t message;
+	uint8_t frame[LINK_MAX_FRAME];
+
+	message.type = LINK_MSG_LOG;
+	message.address = LINK_ADDRESS_BROADCAST;
+	message.id = LINK_ID_NONE;
+	message.session = 0;
+	message.sequence = 0;
+	message.payload[0] = record->id;
+	message.payload[1] = record->id >> 8;
+	message.payload[2] = record->level;
+	put32(&message.payload[3], record->time);
+	for(uint8_t i = 0; i < record->count; i++)
+		put32(&message.payload[7 + 4 * i], record->args[i]);
+	message.length = 7 + 4 * record->count;
+
+	uint16_t length = link_encode(&message, frame, sizeof(frame));
+	if(length > 0)
+		HAL_UART_Transmit(&huart2, frame, length, HAL_MAX_DELAY);
+}
+/*
+ * Sends everything in the ring, USART2 is only used here so blocking does
+ * not hold up anything else
+ */
+static void StartLogTask(void *argument)
+{
+	LOG_RECORD_t record;
+	uint32_t reported = 0;
+
+	for(;;)
+	{
+		osDelay(LOG_FLUSH_MS);
+		while(log_read(&record))
+			send_record(&record);
+		if(dropped != reported)
+		{
+			record = (LOG_RECORD_t){ .id = LOG_ID_LOG_DROPPED, .level = LOG_LEVEL_WARN, .count = 1,
+									 .time = HAL_GetTick(), .args = { dropped - reported } };
+			reported = dropped;
+			send_record(&record);
+		}
+	}
+}
+#endif
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Starts the log task, records written before are kept
+  * @param None
+  * @return _Bool false if the task could not be created
+  */
+_Bool log_Init(void)
+{
+#ifdef USE_HAL_DRIVER
+	logTaskHandle = osThreadNew(StartLogTask, NULL, &logTask_attributes);
+	return logTaskHandle != NULL;
+#else
+	return true;
+#endif
+}
+
+/**
+  * @brief Stores one record, safe in interrupts, drops it when the ring is
+  * 	   full. Use the LOG_... macros instead of calling it directly.
+  * @param uint8_t level
+  * @param uint16_t id (LOG_ID_...)
+  * @param uint8_t count of the following uint32_t arguments
+  * @retval None
+  */
+void log_write(uint8_t level, uint16_t id, uint8_t count, ...)
+{
+	va_list args;
+	LOG_RECORD_t* record;
+
+	if(count > LOG_MAX_ARGS)
+		count = LOG_MAX_ARGS;
+
+#ifdef USE_HAL_DRIVER
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+#endif
+	if(head - tail >= LOG_RING_SIZE)
+	{
+		dropped++;
+#ifdef USE_HAL_DRIVER
+		__set_PRIMASK(primask);
+#endif
+		return;
+	}
+	record = &ring[head % LOG_RING_SIZE];
+	record->id = id;
+	record->level = level;
+	record->count = count;
+	va_start(args, count);
+	for(uint8_t i = 0; i < count; i++)
+		record->args[i] = va_arg(args, uint32_t);
+	va_end(args);
+#ifdef USE_HAL_DRIVER
+	record->time = HAL_GetTick();
+#else
+	record->time = 0;
+#endif
+	head++;
+#ifdef USE_HAL_DRIVER
+	__set_PRIMASK(primask);
+#endif
+}
+
+/**
+  * @brief Takes the oldest record out of the ring
+  * @param LOG_RECORD_t* record
+  * @return _Bool false if the ring is empty
+  */
+_Bool log_read(LOG_RECORD_t* record)
+{
+	if(head == tail)
+		return false;
+	*record = ring[tail % LOG_RING_SIZE];
+	tail++;
+	return true;
+}
+
+/**
+  * @brief Records lost because the ring was full
+  * @param None
+  * @return uint32_t
+  */
+uint32_t log_getDropped(void)
+{
+	return dropped;
+}
@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    tx_ring.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Transmit ring of printf.c: whole messages are queued, the DMA
+  * 		 takes contiguous parts of it, a full ring drops or overwrites the
+  * 		 oldest messages.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "tx_ring.h"
+#include <string.h>
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t free_space(const TX_RING_t* ring)
+{
+	return TX_RING_SIZE - (ring->head - ring->tail) - ring->sending;
+}
+/*
+ * Message bookkeeping for OVERWRITE. A full queue merges the new message into
+ * the newest one, both are then discarded together: a message is never cut,
+ * only the count is coarser.
+ */
+static void forget_sent(TX_RING_t* ring)
+{
+	while(ring->count > 0 && ring->tail - ring->start >= ring->lengths[ring->first])
+	{
+		ring->start += ring->lengths[ring->first];
+		ring->first = (ring->first + 1) % TX_MESSAGES;
+		ring->count--;
+	}
+}
+static void record_message(TX_RING_t* ring, uint16_t length)
+{
+	forget_sent(ring);
+	if(ring->count == 0)
+		ring->start = ring->head;
+	if(ring->count == TX_MESSAGES)
+	{
+		ring->lengths[(ring->first + ring->count - 1) % TX_MESSAGES] += length;
+		return;
+	}
+	ring->lengths[(ring->first + ring->count) % TX_MESSAGES] = length;
+	ring->count++;
+}
+/*
+ * Rest of the oldest message the DMA already started (transfer split at the
+ * end of the ring), it has to stay
+ */
+static uint32_t started_rest(TX_RING_t* ring)
+{
+	forget_sent(ring);
+	if(ring->count == 0 || ring->tail == ring->start)
+		return 0;
+	return ring->start + ring->lengths[ring->first] - ring->tail;
+}
+/*
+ * Discards the oldest messages not started until length bytes fit. The newer
+ * ones are moved down over them: the running transfer is right before
+ * tail, space only becomes free at the head (at most one ring copied).
+ */
+static void discard_oldest(TX_RING_t* ring, uint16_t length)
+{
+	uint32_t from = ring->tail + started_rest(ring); //first byte of the oldest message not started
+	uint8_t kept = (from != ring->tail) ? 1 : 0; //the started one
+	uint8_t discard = 0;
+	uint32_t bytes = 0;
+
+	while(free_space(ring) + bytes < length)
+		bytes += ring->lengths[(ring->first + kept + discard++) % TX_MESSAGES];
+	for(uint32_t i = from; i + bytes != ring->head; i++)
+		ring->data[i % TX_RING_SIZE] = ring->data[(i + bytes) % TX_RING_SIZE];
+	for(uint8_t i = kept; i + discard < ring->count; i++)
+		ring->lengths[(ring->first + i) % TX_MESSAGES] = ring->lengths[(ring->first + i + discard) % TX_MESSAGES];
+	if((int32_t)(ring->limit - from) > 0)
+		ring->limit = (ring->limit - from > bytes) ? ring->limit - bytes : from; //released ones were discarded
+	ring->head -= bytes;
+	ring->count -= discard;
+	ring->dropped += discard;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Empties the ring
+  * @param TX_RING_t* ring
+  * @param TX_OVERFLOW_t policy, what happens when the ring is full
+  * @return None
+  */
+void tx_ringInit(TX_RING_t* ring, TX_OVERFLOW_t policy)
+{
+	memset(ring, 0, sizeof(*ring));
+	ring->policy = policy;
+}
+/**
+  * @brief Makes room for a message, with OVERWRITE by discarding the oldest
+  * 	   whole messages the DMA has not started
+  * @param TX_RING_t* ring
+  * @param uint16_t length
+  * @return _Bool, false if the message does not fit (nothing changed, BLOCK may wait for the DMA)
+  */
+_Bool tx_ringReserve(TX_RING_t* ring, uint16_t length)
+{
+	if(length > TX_RING_SIZE)
+		return false;
+	if(free_space(ring) >= length)
+		return true;
+	if(ring->policy == TX_OVERFLOW_OVERWRITE && free_space(ring) + (ring->head - ring->tail) - started_rest(ring) >= length)
+	{
+		discard_oldest(ring, length);
+		return true;
+	}
+	return false;
+}
+/**
+  * @brief Copies a message into the ring, call after tx_ringReserve succeeded
+  * @param TX_RING_t* ring
+  * @param const uint8_t* data
+  * @param uint16_t length
+  * @param _Bool release, moves the gate behind the message
+  * @return None
+  */
+void tx_ringPut(TX_RING_t* ring, const uint8_t* data, uint16_t length, _Bool release)
+{
+	for(uint16_t i = 0; i < length; i++)
+		ring->data[(ring->head + i) % TX_RING_SIZE] = data[i];
+	record_message(ring, length);
+	ring->head += length;
+	if(release)
+		ring->limit = ring->head;
+}
+/**
+  * @brief Next part for the DMA: released data up to the end of the ring, the
+  * 	   rest follows with the next transfer
+  * @param const TX_RING_t* ring
+  * @param const uint8_t** data, start of the part
+  * @return uint16_t length, 0 while a transfer runs or nothing is to send
+  */
+uint16_t tx_ringNext(const TX_RING_t* ring, const uint8_t** data)
+{
+	uint32_t tail = ring->tail % TX_RING_SIZE;
+	uint32_t room = TX_RING_SIZE - tail;
+	int32_t length = (int32_t)((ring->gated ? ring->limit : ring->head) - ring->tail);
+
+	if(ring->sending > 0 || length <= 0)
+		return 0;
+	*data = &ring->data[tail];
+	return ((uint32_t)length > room) ? room : (uint16_t)length;
+}
+/**
+  * @brief The DMA took the part of tx_ringNext, it stays untouched until tx_ringSent
+  * @param TX_RING_t* ring
+  * @param uint16_t length
+  * @return None
+  */
+void tx_ringStarted(TX_RING_t* ring, uint16_t length)
+{
+	ring->sending = length;
+	ring->tail += length;
+}
+/**
+  * @brief The running transfer is complete, its space is free
+  * @param TX_RING_t* ring
+  * @return None
+  */
+void tx_ringSent(TX_RING_t* ring)
+{
+	ring->sending = 0;
+}
+/**
+  * @brief Releases everything queued so far (gated)
+  * @param TX_RING_t* ring
+  * @return None
+  */
+void tx_ringRelease(TX_RING_t* ring)
+{
+	ring->limit = ring->head;
+}
+/**
+  * @brief Gated only released data is sent. Gating starts with everything
+  * 	   queued so far released.
+  * @param TX_RING_t* ring
+  * @param _Bool gated
+  * @return None
+  */
+void tx_ringSetGated(TX_RING_t* ring, _Bool gated)
+{
+	if(gated && !ring->gated)
+		ring->limit = ring->head;
+	ring->gated = gated;
+}
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    animation.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Non blocking LED animations with keyframes and easing, driven by
+  * 		 an RTOS software timer.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_ANIMATION_H_
+#define INC_ANIMATION_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "cmsis_os.h"
+#include "pwm_driver.h"
+#include "gamma.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	EASE_LINEAR = 0,
+	EASE_IN = 1,		//slow start
+	EASE_OUT = 2,		//slow end
+	EASE_IN_OUT = 3		//slow start and end (smoothstep)
+}ANIM_EASING_t;
+
+typedef struct AnimationKeyframe
+{
+	RGB_t color;			//reached at the end of the keyframe, perceptual (gamma is applied on output)
+	uint16_t duration;		//ms from the previous color
+	ANIM_EASING_t easing;
+}ANIM_KEYFRAME_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define ANIM_FRAME_MS 2 //500 frames per second, needed for temporal dithering
+#define ANIM_TRANSITION_MS 150 //default fade of a new color
+#define ANIM_SETTLE_TIMEOUT_MS 10 //animation_SetColorSettled gives up after
+
+/* Globals -------------------------------------------------------------------*/
+extern const ANIM_KEYFRAME_t animation_StartUp[];
+extern const uint8_t animation_StartUpLength;
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool animation_Init(void);
+void animation_Play(const ANIM_KEYFRAME_t* keyframes, uint8_t count, _Bool loop);
+void animation_SetColor(RGB_t color);
+void animation_SetColor16(RGB16_t color);
+void animation_SetTransitionTime(uint16_t duration);
+void animation_Stop(void);
+_Bool animation_IsRunning(void);
+uint32_t animation_GetShownCycle(void);
+_Bool animation_SetColorSettled(RGB16_t color, uint32_t* latchCycle);
+
+#endif /* INC_ANIMATION_H_ */
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    calibration.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Dark offset / infrared compensation and color correction matrix
+  * 		 for the VEML3328, stored in the last flash page.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_CALIBRATION_H_
+#define INC_CALIBRATION_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	CALIB_OK = 0,
+	CALIB_ERROR = 1,
+	CALIB_NOT_ENOUGH_PATCHES = 2,
+	CALIB_FLASH_ERROR = 3
+}CALIB_STATUS_t;
+
+typedef enum {
+	CALIB_OP_PATCH = 'P',	//CAL:P,r,g,b -> measure patch with 8 bit reference color
+	CALIB_OP_FIT = 'F',		//CAL:F,ir    -> fit matrix (ir = 1 uses infrared column) and save
+	CALIB_OP_RESET = 'R',	//CAL:R       -> back to identity matrix without offsets, patches cleared
+	CALIB_OP_DARK = 'D',	//CAL:D       -> average dark measurement as offset and save
+	CALIB_OP_INFRARED = 'I'	//CAL:I,r,g,b -> infrared leakage into R,G,B in 1/1000 and save
+}CALIB_OPERATION_t;
+
+typedef struct CalibrationCommand
+{
+	char operation;
+	uint16_t args[3];
+}CALIB_CMD_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define CALIB_FRACTION_BITS 12 //Q12 coefficients, 1.0 = 4096
+#define CALIB_MAX_PATCHES 24
+#define CALIB_DARK_SAMPLES 4
+#define CALIB_MAX_INFRARED 7999 //CAL:I in 1/1000, the Q12 coefficient is int16_t (< 8.0)
+
+/* Function Prototypes -------------------------------------------------------*/
+void calib_Init(void);
+void calib_compensate(const struct MEASUREMENT_S* raw, struct MEASUREMENT_S* compensated);
+void calib_apply(struct MEASUREMENT_S* values);
+CALIB_STATUS_t calib_addPatch(const struct MEASUREMENT_S* raw, uint8_t red, uint8_t green, uint8_t blue);
+CALIB_STATUS_t calib_fit(_Bool useInfrared);
+CALIB_STATUS_t calib_save(void);
+void calib_reset(void);
+void calib_setDark(const struct MEASUREMENT_S* dark);
+CALIB_STATUS_t calib_setInfrared(uint16_t red, uint16_t green, uint16_t blue);
+void calib_setSensitivity(uint16_t sensitivity);
+uint8_t calib_getPatchCount(void);
+
+#endif /* INC_CALIBRATION_H_ */
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    closedloop.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Closed loop color matching: the LED is adjusted until the on-board
+  * 		 sensor measures the requested color and intensity.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_CLOSEDLOOP_H_
+#define INC_CLOSEDLOOP_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include "gamma.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	CLM_CONVERGED = 0,
+	CLM_NOT_CONVERGED = 1,	//CLM_MAX_ITERATIONS used up
+	CLM_OUT_OF_RANGE = 2,	//LED is not bright enough for the target
+	CLM_LED_TIMEOUT = 3		//a color did not reach the LED, aborted
+}CLM_STATUS_t;
+
+typedef struct ClosedLoopTarget
+{
+	uint8_t red;		//chromaticity as on the display: value * 255 / clear
+	uint8_t green;
+	uint8_t blue;
+	uint32_t intensity;	//clear count
+}CLM_TARGET_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define CLM_MAX_ITERATIONS 8
+#define CLM_TOLERANCE 20 //per mille of the target intensity
+#define CLM_MIN_TOLERANCE 8 //counts, for dim targets
+#define CLM_MAX_DUTY (255 << 8) //Q8.8, full LED
+#define CLM_START_DUTY (16 << 8) //Q8.8, first guess for every channel that is needed
+#define CLM_MIN_SIGNAL 16 //counts above ambient to estimate the gain of a channel
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool clm_measure(const uint32_t* duty, int64_t* values);
+CLM_STATUS_t clm_run(const CLM_TARGET_t* target, uint8_t* iterations, RGB_t* drive);
+
+#endif /* INC_CLOSEDLOOP_H_ */
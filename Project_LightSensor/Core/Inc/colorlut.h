@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    colorlut.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Characterization of the LED with the on-board sensor and inverse
+  * 		 3D lookup table (sensor color -> LED drive), stored in flash.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_COLORLUT_H_
+#define INC_COLORLUT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include "gamma.h"
+#include "lut_grid.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	LUT_OK = 0,
+	LUT_ERROR = 1,
+	LUT_NOT_CHARACTERIZED = 2,
+	LUT_FLASH_ERROR = 3,
+	LUT_OUT_OF_GAMUT = 4	//nearest reachable drive is returned
+}LUT_STATUS_t;
+
+typedef enum {
+	LUT_OP_CHARACTERIZE = 'C',	//LUT:C       -> sweep the LED, build the table and save
+	LUT_OP_SHOW = 'S'			//LUT:S,r,g,b -> show sensor color r,g,b (0...255 of the white LED)
+}LUT_OPERATION_t;
+
+typedef struct LutCommand
+{
+	char operation;
+	uint8_t args[3];
+}LUT_CMD_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void lut_Init(void);
+_Bool lut_isValid(void);
+LUT_STATUS_t lut_characterize(void);
+LUT_STATUS_t lut_lookup(const int64_t* target, uint32_t* duty);
+LUT_STATUS_t lut_show(uint8_t red, uint8_t green, uint8_t blue, RGB_t* drive);
+
+#endif /* INC_COLORLUT_H_ */
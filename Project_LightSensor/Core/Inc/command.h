@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    command.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Table driven dispatcher for ASCII commands and binary link frames.
+  * 		 Modules register their commands at init, the protocol task looks
+  * 		 them up by opcode and runs them with an execution time counter.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_COMMAND_H_
+#define INC_COMMAND_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "link_codec.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define COMMAND_MAX 20 //registered commands
+#define COMMAND_HASH_BITS 5 //32 slots for the ASCII names, more than COMMAND_MAX
+#define COMMAND_OPCODES LINK_MSG_REPLY //frame types below the reply bit are requests
+#define COMMAND_MAX_ARGS 4
+#define COMMAND_NAME_LENGTH 3 //"COL" of "COL:..."
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	COMMAND_OK = 0,
+	COMMAND_UNKNOWN = 1,	//no handler for the name or frame type
+	COMMAND_INVALID = 2,	//arguments or payload do not match the schema
+	COMMAND_FULL = 3		//register only: table full or name/opcode already taken
+}COMMAND_STATUS_t;
+
+typedef enum {
+	COMMAND_ARGS_NUMBERS = 0,	//COL:r,g,b         -> up to maxArgs numbers
+	COMMAND_ARGS_OPERATION = 1,	//CAL:P,r,g,b       -> operation letter, then numbers
+	COMMAND_ARGS_TEXT = 2		//PRF:name          -> handler reads text itself
+}COMMAND_ARGS_t;
+
+typedef struct CommandSchema
+{
+	COMMAND_ARGS_t args;	//layout of the ASCII arguments
+	uint8_t maxArgs;		//more ASCII numbers are rejected, missing ones stay 0
+	uint8_t minLength;		//payload bytes of a binary frame, one argument each
+	uint8_t maxLength;
+}COMMAND_SCHEMA_t;
+
+typedef struct Command
+{
+	_Bool binary;					//received as frame, reply as frame
+	uint8_t id;						//correlation id of the frame, copy it into the reply
+	char operation;					//COMMAND_ARGS_OPERATION, '\0' if missing
+	uint8_t argCount;				//numbers given, bytes of the payload
+	int32_t args[COMMAND_MAX_ARGS];
+	const char* text;				//ASCII arguments after "XXX:", "" for frames
+	const uint8_t* payload;			//whole payload of a frame, NULL for ASCII
+}COMMAND_t;
+
+typedef void (*COMMAND_HANDLER_t)(const COMMAND_t* command);
+
+typedef struct CommandEntry
+{
+	char name[COMMAND_NAME_LENGTH + 1];	//ASCII name, "" if binary only
+	uint8_t opcode;						//LINK_MSG_..., 0 if ASCII only
+	COMMAND_SCHEMA_t schema;
+	COMMAND_HANDLER_t handler;			//runs in the protocol task
+}COMMAND_ENTRY_t;
+
+typedef struct CommandStats
+{
+	const COMMAND_ENTRY_t* entry;
+	uint32_t calls;
+	uint32_t rejected;		//schema did not match
+	uint32_t cycles;		//DWT cycles of the last call
+	uint32_t maxCycles;
+	uint64_t totalCycles;
+}COMMAND_STATS_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+COMMAND_STATUS_t command_register(const COMMAND_ENTRY_t* entry);
+COMMAND_STATUS_t command_dispatchText(const char* text);
+COMMAND_STATUS_t command_dispatchMessage(const LINK_MESSAGE_t* message);
+uint8_t command_getCount(void);
+_Bool command_getStats(uint8_t index, COMMAND_STATS_t* copy);
+
+#endif /* INC_COMMAND_H_ */
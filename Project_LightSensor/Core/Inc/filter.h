@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    filter.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Streaming filter between acquisition and output: moving average,
+  * 		 median and exponential moving average per channel.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_FILTER_H_
+#define INC_FILTER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include "filter_window.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool filter_Init(void);
+void filter_configure(FILTER_MODE_t mode, uint8_t window);
+_Bool filter_applyConfig(void);
+void filter_reset(void);
+void filter_process(struct MEASUREMENT_S* values);
+FILTER_MODE_t filter_getMode(void);
+uint8_t filter_getWindow(void);
+uint32_t filter_getCycles(void);
+uint32_t filter_getMaxCycles(void);
+
+#endif /* INC_FILTER_H_ */
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    filter_window.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Sample windows of the streaming filter (filter.c): moving
+  * 		 average, median and exponential moving average of every channel.
+  * 		 Without HAL, so Tools/filter_bench.c checks and times the same
+  * 		 code on the host.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_FILTER_WINDOW_H_
+#define INC_FILTER_WINDOW_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	FILTER_NONE = 'N',		//FLT:N       -> every sample as measured
+	FILTER_AVERAGE = 'A',	//FLT:A,n     -> box moving average over n samples (running sum)
+	FILTER_MEDIAN = 'M',	//FLT:M,n     -> median of n samples (sorted window)
+	FILTER_EMA = 'E'		//FLT:E,n     -> exponential moving average, alpha = 2/(n+1)
+}FILTER_MODE_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define FILTER_MAX_WINDOW 16
+#define FILTER_EMA_BITS 8 //Q8 state and alpha
+#define FILTER_CHANNELS 5 //R,G,B,C,IR
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct FilterChannel
+{
+	uint32_t ring[FILTER_MAX_WINDOW];	//in order of arrival
+	uint32_t sorted[FILTER_MAX_WINDOW];	//same samples, ascending (median only)
+	uint64_t sum;						//running sum (average only)
+	int64_t ema;						//Q8 (ema only)
+}FILTER_CHANNEL_t;
+
+typedef struct FilterWindow
+{
+	FILTER_CHANNEL_t channels[FILTER_CHANNELS];
+	FILTER_MODE_t mode;
+	uint8_t window;		//1...FILTER_MAX_WINDOW
+	uint8_t head;		//ring position of the next sample
+	uint8_t count;		//samples in the window
+	int32_t emaAlpha;	//Q8
+}FILTER_WINDOW_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+void filter_windowInit(FILTER_WINDOW_t* filter, FILTER_MODE_t mode, uint8_t window);
+void filter_windowReset(FILTER_WINDOW_t* filter);
+void filter_windowAdd(FILTER_WINDOW_t* filter, uint32_t values[FILTER_CHANNELS]);
+
+#endif /* INC_FILTER_WINDOW_H_ */
@@ -0,0 +1,38 @@
+/**
+  ******************************************************************************
+  * @file    gamma.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Gamma correct LED output stage: 16 bit channel values are mapped
+  * 		 to 8 bit frames with temporal dithering of the remaining fraction.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_GAMMA_H_
+#define INC_GAMMA_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "pwm_driver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct RGB16_Color
+{
+	uint16_t red;
+	uint16_t green;
+	uint16_t blue;
+}RGB16_t; //perceptual (before gamma), 8 bit value v is v * 257
+
+/* Defines -------------------------------------------------------------------*/
+#define GAMMA_DITHER_BITS 4 //sub-LSB steps, a pattern repeats after at most 16 frames
+
+/* Function Prototypes -------------------------------------------------------*/
+uint16_t gamma_Correct(uint16_t value);
+uint16_t gamma_Inverse(uint16_t duty);
+_Bool gamma_Dither(const RGB16_t* color, RGB_t* frame);
+RGB16_t gamma_Expand(RGB_t color);
+
+#endif /* INC_GAMMA_H_ */
@@ -58,10 +58,15 @@ extern const uint16_t I2C_CFG_GAIN2_X4;
 void i2c_Init(I2C_HandleTypeDef* hi2c);
 _Bool i2c_verifyDeviceID(void);
 _Bool i2c_startUp(void);
+_Bool i2c_setConfig(uint16_t config);
+uint16_t i2c_getDefaultConfig(void);
+uint16_t i2c_getConfig(void);
 uint16_t i2c_getClear(void);
 uint16_t i2c_getRed(void);
 uint16_t i2c_getGreen(void);
 uint16_t i2c_getBlue(void);
 uint16_t i2c_getIR(void);
+uint16_t i2c_getIntegrationTime(void);
+uint16_t i2c_getSensitivity(uint16_t config);
 
 #endif /* INC_I2C_DRIVER_H_ */
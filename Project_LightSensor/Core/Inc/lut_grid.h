@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file    lut_grid.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Inverse 3D lookup table of the LED (colorlut.c): inverted from
+  * 		 the measured sweep, looked up by tetrahedral interpolation.
+  * 		 Without HAL, so Tools/lut_bench.c checks and times the same code
+  * 		 on the host.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_LUT_GRID_H_
+#define INC_LUT_GRID_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define LUT_SWEEP_LEVELS 5 //drive values per channel, 125 measurements
+#define LUT_SWEEP_POINTS (LUT_SWEEP_LEVELS * LUT_SWEEP_LEVELS * LUT_SWEEP_LEVELS)
+#define LUT_GRID_SIZE 6 //sensor values per channel, 216 entries
+#define LUT_GRID_ENTRIES (LUT_GRID_SIZE * LUT_GRID_SIZE * LUT_GRID_SIZE)
+#define LUT_MAX_DUTY (255 << 8) //Q8.8, full LED (CLM_MAX_DUTY)
+#define LUT_SWEEP_STEP (LUT_MAX_DUTY / (LUT_SWEEP_LEVELS - 1))
+#define LUT_DRIVE_SHIFT 2 //entries in Q8.6, signed and +-512 to keep drives extrapolated outside of the gamut
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct LutGrid
+{
+	uint32_t white[3]; //R,G,B of the full LED above ambient
+	int16_t drive[LUT_GRID_ENTRIES][3]; //linear duty in Q8.6, entry (r*N + g)*N + b
+}LUT_GRID_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool lut_gridBuild(LUT_GRID_t* grid, const int32_t sweep[LUT_SWEEP_POINTS][3]);
+_Bool lut_gridLookup(const LUT_GRID_t* grid, const int64_t* target, uint32_t* duty);
+
+#endif /* INC_LUT_GRID_H_ */
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    measurement.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Continuous acquisition of the VEML3328 with named profiles, including
+  * 		 the HDR mode that fuses a high and a low sensitivity integration into one sample.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_MEASUREMENT_H_
+#define INC_MEASUREMENT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	MEAS_MODE_SINGLE = 0,	//one configuration, sensor runs in auto mode
+	MEAS_MODE_HDR = 1		//high/low sensitivity on consecutive triggered integrations
+}MEAS_MODE_t;
+
+typedef struct MeasurementProfile
+{
+	const char* name;
+	uint16_t integrationTime;	//ms, 50, 100, 200 or 400
+	_Bool allChannels;			//false: only green, clear and infrared are measured
+	MEAS_MODE_t mode;
+	uint32_t expectedRate;		//samples per 1000s (mHz)
+	uint16_t latency;			//ms from start of integration until the sample is available
+}MEAS_PROFILE_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define MEAS_HDR_KNEE 0xC000		//high sensitivity count where blending towards low starts
+#define MEAS_HDR_SATURATION 0xF000	//high sensitivity count treated as saturated
+#define MEAS_HDR_NOISE_FLOOR 16		//low sensitivity counts below are too noisy to blend
+#define MEAS_HDR_RATIO_BITS 8		//sensitivity ratio high/low in Q8
+
+#define MEAS_PROFILE_COUNT 4
+#define MEAS_PROFILE_DEFAULT 0
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool measurement_Init(void);
+void measurement_setProfile(uint8_t index);
+int measurement_findProfile(const char* name);
+uint8_t measurement_getProfileIndex(void);
+const MEAS_PROFILE_t* measurement_getProfile(uint8_t index);
+uint32_t measurement_getAchievedRate(uint8_t index);
+uint32_t measurement_getSkipped(uint8_t index);
+_Bool measurement_applyProfile(void);
+uint32_t measurement_getTimeout(void);
+_Bool measurement_acquire(void);
+_Bool measurement_getLatest(struct SAMPLE_S* sample);
+void measurement_waitNext(struct SAMPLE_S* sample);
+uint32_t measurement_getSampleCycle(void);
+void measurement_trigger(struct MEASUREMENT_S* raw);
+
+#endif /* INC_MEASUREMENT_H_ */
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    mirror.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Mirror mode: every new sample is shown on the LED without a round
+  * 		 trip over the link.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_MIRROR_H_
+#define INC_MIRROR_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Function Prototypes -------------------------------------------------------*/
+void mirror_setEnabled(_Bool enable);
+_Bool mirror_apply(void);
+_Bool mirror_isEnabled(void);
+void mirror_update(const struct SAMPLE_S* sample);
+uint32_t mirror_getLatency(void);
+uint32_t mirror_getMaxLatency(void);
+uint32_t mirror_getCount(void);
+
+#endif /* INC_MIRROR_H_ */
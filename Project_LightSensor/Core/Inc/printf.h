@@ -11,10 +11,28 @@
 #ifndef INC_PRINTF_H_
 #define INC_PRINTF_H_
 
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tx_ring.h"
+#include <stdbool.h>
+#include <stdint.h>
+
 /*Type Definitions -----------------------------------------------------------*/
 #define PUTCHAR_PROTOTYPE int __io_putchar(int ch)
 
+/* Defines -------------------------------------------------------------------*/
+#define TX_OVERFLOW_POLICY TX_OVERFLOW_BLOCK
+
 /* Globals -------------------------------------------------------------------*/
 extern UART_HandleTypeDef huart1;
 
+/* Function Prototypes -------------------------------------------------------*/
+void printf_Init(void);
+int printf_write(const uint8_t* data, uint16_t length);
+int printf_writeLast(const uint8_t* data, uint16_t length);
+void printf_setGated(_Bool gated);
+uint32_t printf_getPending(void);
+void printf_setOverflowPolicy(TX_OVERFLOW_t policy);
+uint32_t printf_getDropped(void);
+
 #endif /* INC_PRINTF_H_ */
@@ -3,7 +3,7 @@
   * @file    pwm_driver.h
   * @author  Mathias Bohle
   * @date 	 05.12.2023
-  * @brief   Controls PWM generation for controlling WS2812 RGB LED
+  * @brief   Controls PWM generation for controlling a chain of WS2812 RGB LEDs
   *
   ******************************************************************************
   */
@@ -28,11 +28,21 @@ typedef struct RGB_Color
 	uint8_t blue;
 }RGB_t;
 
+/* Defines -------------------------------------------------------------------*/
+#ifndef PWM_LED_COUNT
+#define PWM_LED_COUNT 1 //WS2812 in the chain (Color 10 Click has one)
+#endif
+#define PWM_LEDS_PER_HALF 4 //LEDs encoded per DMA interrupt (120us)
+#define PWM_RESET_US 300 //WS2812B latches after more than 280us low
+
 /* Globals -------------------------------------------------------------------*/
 
 /* Function Prototypes -------------------------------------------------------*/
 void pwm_Init(TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma);
+void pwm_SetPixel(uint16_t index, RGB_t color);
+PWM_STATE_t pwm_Show(void);
+_Bool pwm_IsBusy(void);
+uint32_t pwm_GetLatchCycle(void);
 PWM_STATE_t pwm_SendValues(RGB_t colors);
-PWM_STATE_t pwm_StartUpAnimation(void);
 
 #endif /* INC_PWM_DRIVER_H_ */
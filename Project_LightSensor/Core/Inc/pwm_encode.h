@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    pwm_encode.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   WS2812 bit encoding: timer compare values of every color byte,
+  * 		 built by the preprocessor. Without HAL, so Tools/pwm_bench.c
+  * 		 checks the same table on the host.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_PWM_ENCODE_H_
+#define INC_PWM_ENCODE_H_
+
+/* Defines -------------------------------------------------------------------*/
+#define PWM_ONE 29 //0,9 us (29/40) "1"
+#define PWM_ZERO 11 //0,35 us (11/40) "0"
+
+//Compare values of one color byte, MSB first
+#define PWM_BIT(byte, bit) (((byte) & (1 << (bit))) ? PWM_ONE : PWM_ZERO)
+#define PWM_BYTE(b) { PWM_BIT(b,7), PWM_BIT(b,6), PWM_BIT(b,5), PWM_BIT(b,4), PWM_BIT(b,3), PWM_BIT(b,2), PWM_BIT(b,1), PWM_BIT(b,0) }
+#define PWM_BYTES_4(b) PWM_BYTE(b), PWM_BYTE((b)+1), PWM_BYTE((b)+2), PWM_BYTE((b)+3)
+#define PWM_BYTES_16(b) PWM_BYTES_4(b), PWM_BYTES_4((b)+4), PWM_BYTES_4((b)+8), PWM_BYTES_4((b)+12)
+#define PWM_BYTES_64(b) PWM_BYTES_16(b), PWM_BYTES_16((b)+16), PWM_BYTES_16((b)+32), PWM_BYTES_16((b)+48)
+//initializer of uint8_t table[256][8], one row of compare values per color byte
+#define PWM_ENCODE_TABLE { PWM_BYTES_64(0), PWM_BYTES_64(64), PWM_BYTES_64(128), PWM_BYTES_64(192) }
+
+#endif /* INC_PWM_ENCODE_H_ */
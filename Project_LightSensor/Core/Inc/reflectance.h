@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    reflectance.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Two-shot reflective measurement: one integration with the LED off
+  * 		 and one with the LED on, the difference is free of ambient light.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_REFLECTANCE_H_
+#define INC_REFLECTANCE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "tasks.h"
+#include "pwm_driver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct ReflectanceRequest
+{
+	RGB_t illumination;
+	uint8_t id;		//correlation id, copied into the reply
+	_Bool binary;	//reply as frame, else as ASCII line
+}REF_REQUEST_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+_Bool reflectance_measure(RGB_t illumination, struct MEASUREMENT_S* values);
+
+#endif /* INC_REFLECTANCE_H_ */
@@ -26,15 +26,36 @@ typedef enum {
 	MEASUREMENT_NEEDED = 1,
 	MEASUREMENT_DONE = 2,
 	NEW_COLOR = 4,
-	DONE_OR_NEW_COLOR = 6
+	DONE_OR_NEW_COLOR = 6,
+	CALIBRATION_NEEDED = 8,
+	PROFILE_REPORT = 32,
+	FILTER_REPORT = 64,
+	CLOSED_LOOP_NEEDED = 128,
+	LUT_NEEDED = 256,
+	MIRROR_REPORT = 512,
+	REFLECTANCE_NEEDED = 1024,
+	SETTLED_NEEDED = 2048
 }MEASUREMENT_FLAG_t;
 
 struct MEASUREMENT_S{
-	uint16_t red;
-	uint16_t green;
-	uint16_t blue;
-	uint16_t clear;
-	uint16_t infrared;
+	uint32_t red;		//up to 16 bit, more in HDR mode
+	uint32_t green;
+	uint32_t blue;
+	uint32_t clear;
+	uint32_t infrared;
+};
+
+typedef struct SampleRequest
+{
+	uint8_t type;	//LINK_MSG_MEASURE or LINK_MSG_MEASURE_RAW
+	uint8_t id;		//correlation id, copied into the reply
+	_Bool binary;	//reply as frame, else as ASCII line
+}SAMPLE_REQUEST_t;
+
+struct SAMPLE_S{
+	struct MEASUREMENT_S raw;			//as read from VEML3328 (fused in HDR mode)
+	struct MEASUREMENT_S compensated;	//dark offset, infrared and color correction applied
+	uint32_t time;						//µs (clock_micros) in the middle of the integration window
 };
 
 /* Globals -------------------------------------------------------------------*/
@@ -50,6 +71,30 @@ extern const osMessageQueueAttr_t colorUpdateQueue_attributes;
 
 extern const osMessageQueueAttr_t MeasurementQueue_attributes;
 
+extern osMessageQueueId_t calibrationQueueHandle;
+
+extern const osMessageQueueAttr_t calibrationQueue_attributes;
+
+extern osMessageQueueId_t closedLoopQueueHandle;
+
+extern const osMessageQueueAttr_t closedLoopQueue_attributes;
+
+extern osMessageQueueId_t lutQueueHandle;
+
+extern const osMessageQueueAttr_t lutQueue_attributes;
+
+extern osMessageQueueId_t requestQueueHandle;
+
+extern const osMessageQueueAttr_t requestQueue_attributes;
+
+extern osMessageQueueId_t reflectanceQueueHandle;
+
+extern const osMessageQueueAttr_t reflectanceQueue_attributes;
+
+extern osMessageQueueId_t settledQueueHandle;
+
+extern const osMessageQueueAttr_t settledQueue_attributes;
+
 extern osEventFlagsId_t colorUpdateEventHandle;
 
 extern const osEventFlagsAttr_t colorUpdateEvent_attributes;
@@ -59,6 +104,8 @@ extern const osEventFlagsAttr_t colorUpdateEvent_attributes;
 
 #define TASK_STACK_SIZE 128 * 4 //512 Byte
 
+#define MEASUREMENT_STACK_SIZE 256 * 4 //1024 Byte, calibration fit and printf
+
 /* Function Prototypes -------------------------------------------------------*/
 
 TASK_CREATION_t init_Tasks(void);
@@ -15,8 +15,15 @@
 #include "math.h"
 #include "stdio.h"
 #include "cmsis_os.h"
+#include "tasks.h"
+#include "link_codec.h"
+#include "link_arq.h"
+#include "clock_sync.h"
+#include "link_schedule.h"
 /* Globals -------------------------------------------------------------------*/
+extern osThreadId_t protocolTaskHandle;
 
+extern const osThreadAttr_t protocolTask_attributes;
 
 extern UART_HandleTypeDef huart1;
 /* Defines -------------------------------------------------------------------*/
@@ -25,10 +32,41 @@ typedef enum {
 	UART_ERROR = 1,
 }UART_CREATION_t;
 
-#define RX_BUFFER_SIZE 30
+typedef struct UartStats
+{
+	uint32_t frames;	//binary frames with valid CRC
+	uint32_t commands;	//ASCII commands
+	uint32_t dropped;	//bytes lost because the ring ran over or reception restarted
+	uint32_t rejected;	//frames with wrong CRC/length, too long messages, unknown commands, wrong arguments
+	uint32_t crc;		//rejected frames with wrong CRC (bit errors on the radio)
+	uint32_t errors;	//overrun, noise and framing errors of the uart
+	uint32_t overruns;	//errors that lost bytes in the uart (ORE), reception restarted
+	uint32_t bytes;		//received since the last uart_resetStats
+}UART_STATS_t;
+
+#define RX_RING_SIZE 128 //DMA ring, the task is woken at idle line and every half
+
+#define PROTOCOL_RX_FLAG 1
+#define PROTOCOL_LINK_FLAG 2 //a frame was sent, the retransmission timer runs
+
+#define NODE_ADDRESS LINK_NODE_DEFAULT //1..LINK_MAX_NODES, one per sensor board on the radio channel (ADR: changes it)
+
+#define LINK_SEND_RETRY_MS 5 //uart_sendMessage: window full, try again
+
+#define PROTOCOL_STACK_SIZE 256 * 4 //1024 Byte, sscanf and printf
+
+#define PROTOCOL_PRIORITY (osPriority_t) osPriorityAboveNormal
 
 /* Function Prototypes -------------------------------------------------------*/
 UART_CREATION_t init_uart(void);
 void uart_callback(UART_HandleTypeDef *huart, uint16_t size);
+void StartProtocolTask(void *argument);
+void uart_getStats(UART_STATS_t* copy);
+void uart_getLinkStats(LINK_ARQ_STATS_t* copy);
+void uart_getLinkRtt(HISTOGRAM_t* copy);
+void uart_resetStats(void);
+void uart_sendMessage(const LINK_MESSAGE_t* message);
+void uart_sendSample(uint8_t type, uint8_t id, const struct MEASUREMENT_S* values, uint32_t time);
+void uart_putSample(const struct MEASUREMENT_S* values, uint32_t time);
 
 #endif /* INC_UART_H_ */
@@ -0,0 +1,334 @@
+/**
+  ******************************************************************************
+  * @file    animation.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Non blocking LED animations with keyframes and easing, driven by
+  * 		 an RTOS software timer.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "animation.h"
+#include "gamma.h"
+#include "command.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define ANIM_ONE 0x10000 //progress in Q16
+
+/* Globals -------------------------------------------------------------------*/
+//Same sequence as the former busy waiting start up animation: brightness 30 (96 before gamma), 450ms per color
+const ANIM_KEYFRAME_t animation_StartUp[] = {
+	{ { 96, 0, 0 }, 450, EASE_LINEAR },		//R
+	{ { 96, 96, 0 }, 450, EASE_LINEAR },	//RG
+	{ { 0, 96, 0 }, 450, EASE_LINEAR },		//G
+	{ { 0, 96, 96 }, 450, EASE_LINEAR },	//GB
+	{ { 0, 0, 96 }, 450, EASE_LINEAR },		//B
+	{ { 96, 0, 96 }, 450, EASE_LINEAR },	//RB
+	{ { 96, 96, 96 }, 450, EASE_LINEAR },	//RGB
+	{ { 0, 0, 0 }, 450, EASE_IN_OUT }		//0
+};
+const uint8_t animation_StartUpLength = sizeof(animation_StartUp) / sizeof(animation_StartUp[0]);
+
+static osTimerId_t frameTimerHandle;
+
+static const osTimerAttr_t frameTimer_attributes = {
+  .name = "AnimationFrame"
+};
+
+//written by the caller, read by the timer callback, always under osKernelLock
+static const ANIM_KEYFRAME_t* sequence = NULL;
+static uint8_t sequenceLength = 0;
+static _Bool sequenceLoop = false;
+static uint8_t keyframe = 0;
+static uint32_t keyframeStart = 0;
+static RGB16_t keyframeFrom;
+static RGB16_t target; //color while no sequence runs
+static _Bool outputDirty = false;
+
+static RGB_t output; //last frame the timer callback sent
+static volatile uint32_t shownCycle = 0; //DWT cycle when the last new color went out
+
+static ANIM_KEYFRAME_t transition = { { 0, 0, 0 }, ANIM_TRANSITION_MS, EASE_OUT }; //sequence of animation_SetColor
+static volatile uint16_t transitionTime = ANIM_TRANSITION_MS;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t ease(uint32_t progress, ANIM_EASING_t easing)
+{
+	uint64_t p = progress;
+	if(easing == EASE_IN)
+		return (uint32_t)((p * p) >> 16);
+	if(easing == EASE_OUT)
+		return (uint32_t)(ANIM_ONE - (((ANIM_ONE - p) * (ANIM_ONE - p)) >> 16));
+	if(easing == EASE_IN_OUT)
+		return (uint32_t)((p * p * (3 * ANIM_ONE - 2 * p)) >> 32);
+	return progress;
+}
+static uint16_t mix(uint16_t from, uint8_t to, uint32_t weight)
+{
+	//interpolated in 16 bit, so slow fades have no 8 bit steps
+	int64_t difference = (int32_t)(to * 257) - from;
+	return (uint16_t)(from + ((difference * weight + (ANIM_ONE/2)) >> 16));
+}
+static _Bool same_color(RGB_t a, RGB_t b)
+{
+	return (a.red == b.red) && (a.green == b.green) && (a.blue == b.blue);
+}
+static _Bool same_color16(RGB16_t a, RGB16_t b)
+{
+	return (a.red == b.red) && (a.green == b.green) && (a.blue == b.blue);
+}
+/*
+ * Color of the running sequence at time now, advances to the next keyframe
+ * (or ends the sequence and holds its last color). Called with kernel locked.
+ */
+static RGB16_t sequence_color(uint32_t now)
+{
+	while(sequence != NULL)
+	{
+		const ANIM_KEYFRAME_t* frame = &sequence[keyframe];
+		uint32_t elapsed = now - keyframeStart;
+		if(elapsed < frame->duration)
+		{
+			uint32_t weight = ease((elapsed * ANIM_ONE) / frame->duration, frame->easing);
+			RGB16_t color;
+			color.red = mix(keyframeFrom.red, frame->color.red, weight);
+			color.green = mix(keyframeFrom.green, frame->color.green, weight);
+			color.blue = mix(keyframeFrom.blue, frame->color.blue, weight);
+			return color;
+		}
+		//keyframe done, the next one starts where this one ended
+		keyframeFrom = gamma_Expand(frame->color);
+		keyframeStart += frame->duration;
+		keyframe++;
+		if(keyframe >= sequenceLength)
+		{
+			if(sequenceLoop)
+				keyframe = 0;
+			else
+			{
+				target = keyframeFrom;
+				sequence = NULL;
+			}
+		}
+	}
+	return target;
+}
+/*
+ * Runs in the timer task every ANIM_FRAME_MS. The 16 bit color is gamma
+ * corrected and dithered to an 8 bit frame. A frame is only sent if it
+ * changed or dithering is active; once nothing is left to do the timer stops
+ * itself. The timer task has a higher priority than the callers, so a stop
+ * command is processed before anyone can check osTimerIsRunning again.
+ */
+static void frame_callback(void *argument)
+{
+	RGB_t frame;
+
+	osKernelLock();
+	RGB16_t color = sequence_color(osKernelGetTickCount());
+	_Bool running = (sequence != NULL);
+	_Bool dirty = outputDirty;
+	osKernelUnlock();
+
+	_Bool dithering = gamma_Dither(&color, &frame);
+	_Bool send = dirty || dithering || !same_color(frame, output);
+
+	if(send && pwm_SendValues(frame) == RUNNING)
+	{
+		output = frame;
+		osKernelLock();
+		//a new color may have been set meanwhile, it is sent with the next frame
+		if(sequence == NULL && same_color16(target, color))
+			outputDirty = false;
+		osKernelUnlock();
+		if(dirty)
+			shownCycle = DWT->CYCCNT;
+	}
+	else if(!send && !running)
+		osTimerStop(frameTimerHandle);
+}
+/*
+ * Starts keyframes at from, the color shown now (sequence_color taken before
+ * the keyframes were changed), so a running sequence or transition is
+ * retargeted instead of restarted. Called with kernel locked.
+ */
+static void start_sequence(const ANIM_KEYFRAME_t* keyframes, uint8_t count, _Bool loop, RGB16_t from)
+{
+	uint32_t now = osKernelGetTickCount();
+	keyframeFrom = from;
+	sequence = keyframes;
+	sequenceLength = count;
+	sequenceLoop = loop;
+	keyframe = 0;
+	keyframeStart = now;
+}
+static void start_timer(void)
+{
+	if(!osTimerIsRunning(frameTimerHandle))
+		osTimerStart(frameTimerHandle, ANIM_FRAME_MS);
+}
+/*
+ * TRN:ms sets the fade time of COL: (clamped to 0..65535), 0 jumps, TRN: back
+ * to the default
+ */
+static void command_transition(const COMMAND_t* command)
+{
+	int32_t duration = (command->argCount > 0) ? command->args[0] : ANIM_TRANSITION_MS;
+	if(duration < 0)
+		duration = 0;
+	if(duration > UINT16_MAX)
+		duration = UINT16_MAX;
+	animation_SetTransitionTime((uint16_t)duration);
+}
+
+static const COMMAND_ENTRY_t transitionCommand = { "TRN", 0, { COMMAND_ARGS_NUMBERS, 1, 0, 0 }, command_transition };
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Creates the frame timer and registers TRN:, LED starts off
+  * @param None
+  * @return _Bool, false if the timer could not be created or the command registered
+  */
+_Bool animation_Init(void)
+{
+	output.red = 0;
+	output.green = 0;
+	output.blue = 0;
+	target = gamma_Expand(output);
+	outputDirty = true;
+	frameTimerHandle = osTimerNew(frame_callback, osTimerPeriodic, NULL, &frameTimer_attributes);
+	return (frameTimerHandle != NULL && command_register(&transitionCommand) == COMMAND_OK);
+}
+/**
+  * @brief Plays keyframes in the background, starting from the current color.
+  * 	   Replaces a running animation. The keyframes must stay valid while playing.
+  * @param const ANIM_KEYFRAME_t* keyframes, uint8_t count, _Bool loop (repeat until stopped)
+  * @return None
+  */
+void animation_Play(const ANIM_KEYFRAME_t* keyframes, uint8_t count, _Bool loop)
+{
+	if(keyframes == NULL || count == 0)
+		return;
+	uint32_t total = 0;
+	for(uint8_t i=0; i<count; i++)
+		total += keyframes[i].duration;
+	if(total == 0)
+		loop = false; //would never leave sequence_color
+	osKernelLock();
+	start_sequence(keyframes, count, loop, sequence_color(osKernelGetTickCount()));
+	osKernelUnlock();
+	start_timer();
+}
+/**
+  * @brief Fades from the current color to color within the transition time,
+  * 	   one step per frame. A new color during a transition (or animation)
+  * 	   retargets it from the color reached so far.
+  * @param RGB_t color
+  * @return None
+  */
+void animation_SetColor(RGB_t color)
+{
+	uint16_t duration = transitionTime;
+	osKernelLock();
+	if(duration == 0)
+	{
+		sequence = NULL;
+		target = gamma_Expand(color);
+	}
+	else
+	{
+		//transition may be the running sequence, its color is taken before it changes
+		RGB16_t current = sequence_color(osKernelGetTickCount());
+		transition.color = color;
+		transition.duration = duration;
+		start_sequence(&transition, 1, false, current);
+	}
+	outputDirty = true;
+	osKernelUnlock();
+	start_timer();
+}
+/**
+  * @brief Shows a 16 bit color with the next frame, without fade
+  * @param RGB16_t color, perceptual
+  * @return None
+  */
+void animation_SetColor16(RGB16_t color)
+{
+	osKernelLock();
+	sequence = NULL;
+	target = color;
+	outputDirty = true;
+	osKernelUnlock();
+	start_timer();
+}
+/**
+  * @brief Sets the duration of the fade of animation_SetColor (safe to call
+  * 	   from the uart callback)
+  * @param uint16_t duration in ms, 0 jumps to the new color
+  * @return None
+  */
+void animation_SetTransitionTime(uint16_t duration)
+{
+	transitionTime = duration;
+}
+/**
+  * @brief Stops a running animation, the LED keeps its current color
+  * @param None
+  * @return None
+  */
+void animation_Stop(void)
+{
+	osKernelLock();
+	target = sequence_color(osKernelGetTickCount());
+	sequence = NULL;
+	osKernelUnlock();
+}
+/**
+  * @brief Checks if keyframes are being played
+  * @param None
+  * @return _Bool
+  */
+_Bool animation_IsRunning(void)
+{
+	return (sequence != NULL);
+}
+/**
+  * @brief DWT cycle counter when the last new color (not a fade step) was handed
+  * 	   to the LEDs, the transfer itself takes 30us per LED
+  * @param None
+  * @return uint32_t cycles
+  */
+uint32_t animation_GetShownCycle(void)
+{
+	return shownCycle;
+}
+/**
+  * @brief Shows a 16 bit color without fade and blocks until the LEDs have taken
+  * 	   it over (frame sent, DMA complete and reset gap passed), for a
+  * 	   measurement that must only see the new color. Not from the timer task.
+  * @param RGB16_t color, perceptual, uint32_t* latchCycle (DWT) when the color was taken over, may be NULL
+  * @return _Bool, false if no frame went out within ANIM_SETTLE_TIMEOUT_MS
+  */
+_Bool animation_SetColorSettled(RGB16_t color, uint32_t* latchCycle)
+{
+	uint32_t start = DWT->CYCCNT;
+	animation_SetColor16(color);
+	for(uint32_t i=0; i<ANIM_SETTLE_TIMEOUT_MS; i++)
+	{
+		osDelay(1);
+		//the frame with the color started after the call and the DMA is done
+		if((shownCycle - start) <= (DWT->CYCCNT - start) && !pwm_IsBusy())
+		{
+			uint32_t latch = pwm_GetLatchCycle();
+			while((int32_t)(DWT->CYCCNT - latch) < 0)
+			{
+				;
+			}
+			if(latchCycle != NULL)
+				*latchCycle = latch;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,372 @@
+/**
+  ******************************************************************************
+  * @file    calibration.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Dark offset / infrared compensation and color correction matrix
+  * 		 for the VEML3328, stored in the last flash page.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "calibration.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+//Last 2K page, removed from FLASH region in STM32L432KCUX_FLASH.ld
+#define CALIB_FLASH_PAGE 127
+#define CALIB_FLASH_ADDRESS (FLASH_BASE + (CALIB_FLASH_PAGE * FLASH_PAGE_SIZE))
+
+#define CALIB_MAGIC 0x43414C42 //"CALB"
+#define CALIB_VERSION 3
+#define CALIB_ONE (1 << CALIB_FRACTION_BITS)
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct CalibrationData
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t matrix[3][4]; //rows: R,G,B out, columns: R,G,B,IR in
+	uint16_t dark[5]; //R,G,B,C,IR
+	int16_t infrared[3]; //IR leakage into R,G,B, Q12
+	uint16_t darkSensitivity; //i2c_getSensitivity of the profile the dark offset was measured with
+	uint16_t reserved;
+	uint32_t checksum;
+}CALIB_DATA_t; //multiple of 8 Byte for double word programming
+
+typedef struct CalibrationPatch
+{
+	uint32_t measured[4]; //R,G,B,IR
+	uint32_t clear;
+	uint8_t reference[3]; //R,G,B
+}CALIB_PATCH_t;
+
+/* Globals -------------------------------------------------------------------*/
+static CALIB_DATA_t calibration;
+static _Bool isIdentity = true;
+static uint16_t activeSensitivity = 0; //of the running profile, 0 until measurement sets it
+static uint32_t activeDark[5]; //dark offset scaled to the running profile
+
+static CALIB_PATCH_t patches[CALIB_MAX_PATCHES];
+static uint8_t patchCount = 0;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t calc_checksum(const CALIB_DATA_t* data)
+{
+	const uint32_t* words = (const uint32_t*)data;
+	uint32_t sum = 0;
+	for(uint32_t i=0; i<(offsetof(CALIB_DATA_t, checksum)/sizeof(uint32_t)); i++)
+		sum += words[i];
+	return ~sum;
+}
+static void set_identity(void)
+{
+	memset(&calibration, 0, sizeof(calibration));
+	calibration.magic = CALIB_MAGIC;
+	calibration.version = CALIB_VERSION;
+	for(int i=0; i<3; i++)
+		calibration.matrix[i][i] = CALIB_ONE;
+	isIdentity = true;
+}
+static _Bool check_identity(void)
+{
+	for(int row=0; row<3; row++)
+		for(int col=0; col<4; col++)
+			if(calibration.matrix[row][col] != ((row==col) ? CALIB_ONE : 0))
+				return false;
+	return true;
+}
+static uint32_t subtract_offset(uint32_t value, uint32_t offset)
+{
+	return (value > offset) ? (value - offset) : 0;
+}
+static uint16_t clamp_offset(uint32_t value)
+{
+	return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+}
+static uint32_t clamp_u32(int64_t value)
+{
+	if(value < 0)
+		return 0;
+	if(value > UINT32_MAX)
+		return UINT32_MAX;
+	return (uint32_t)value;
+}
+/*
+ * Dark counts grow with gain and integration time, so the stored offset is
+ * scaled from the sensitivity it was measured with to the running one. Done
+ * once per profile change, compensation stays without division.
+ */
+static void scale_dark(void)
+{
+	uint16_t measured = calibration.darkSensitivity;
+	for(int i=0; i<5; i++)
+	{
+		if(measured == 0 || activeSensitivity == 0)
+			activeDark[i] = calibration.dark[i];
+		else
+			activeDark[i] = ((uint32_t)calibration.dark[i] * activeSensitivity + measured/2) / measured;
+	}
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Loads the stored matrix from flash, falls back to identity if the
+  * 	   page is erased or corrupted.
+  * @param None
+  * @return None
+  */
+void calib_Init(void)
+{
+	const CALIB_DATA_t* stored = (const CALIB_DATA_t*)CALIB_FLASH_ADDRESS;
+	if(stored->magic == CALIB_MAGIC && stored->version == CALIB_VERSION && stored->checksum == calc_checksum(stored))
+	{
+		memcpy(&calibration, stored, sizeof(calibration));
+		isIdentity = check_identity();
+	}
+	else
+		set_identity();
+	scale_dark();
+	patchCount = 0;
+}
+/**
+  * @brief Subtracts the dark offset of every channel (scaled to the running profile)
+  * 	   and removes the infrared leakage from red, green and blue (integer only, no division).
+  * 	   The leakage is a ratio of two channels with the same gain and integration
+  * 	   time, so it holds for every profile.
+  * @param const struct MEASUREMENT_S* raw, struct MEASUREMENT_S* compensated (may be the same)
+  * @return None
+  */
+void calib_compensate(const struct MEASUREMENT_S* raw, struct MEASUREMENT_S* compensated)
+{
+	const uint32_t* dark = activeDark;
+	uint32_t infrared = subtract_offset(raw->infrared, dark[4]);
+	int64_t red = subtract_offset(raw->red, dark[0]);
+	int64_t green = subtract_offset(raw->green, dark[1]);
+	int64_t blue = subtract_offset(raw->blue, dark[2]);
+
+	compensated->clear = subtract_offset(raw->clear, dark[3]);
+	compensated->infrared = infrared;
+	compensated->red = clamp_u32(red - ((calibration.infrared[0] * (int64_t)infrared) >> CALIB_FRACTION_BITS));
+	compensated->green = clamp_u32(green - ((calibration.infrared[1] * (int64_t)infrared) >> CALIB_FRACTION_BITS));
+	compensated->blue = clamp_u32(blue - ((calibration.infrared[2] * (int64_t)infrared) >> CALIB_FRACTION_BITS));
+}
+/**
+  * @brief Applies the correction matrix in Q12 fixed point (12 MACs, skipped for identity)
+  * @param struct MEASUREMENT_S* values, red/green/blue are replaced in place
+  * @return None
+  */
+void calib_apply(struct MEASUREMENT_S* values)
+{
+	if(isIdentity)
+		return;
+
+	const int64_t in[4] = { values->red, values->green, values->blue, values->infrared };
+	uint32_t out[3];
+	for(int row=0; row<3; row++)
+	{
+		const int32_t* m = calibration.matrix[row];
+		int64_t acc = m[0]*in[0] + m[1]*in[1] + m[2]*in[2] + m[3]*in[3];
+		out[row] = clamp_u32((acc + (CALIB_ONE/2)) >> CALIB_FRACTION_BITS);
+	}
+	values->red = out[0];
+	values->green = out[1];
+	values->blue = out[2];
+}
+/**
+  * @brief Stores a measurement of a reference patch with its known 8 bit color
+  * @param const struct MEASUREMENT_S* raw (compensated, without matrix), uint8_t red, green, blue reference
+  * @return CALIB_STATUS_t, CALIB_ERROR if patch buffer is full or patch is dark
+  */
+CALIB_STATUS_t calib_addPatch(const struct MEASUREMENT_S* raw, uint8_t red, uint8_t green, uint8_t blue)
+{
+	if(patchCount >= CALIB_MAX_PATCHES || raw->clear == 0)
+		return CALIB_ERROR;
+
+	CALIB_PATCH_t* patch = &patches[patchCount];
+	patch->measured[0] = raw->red;
+	patch->measured[1] = raw->green;
+	patch->measured[2] = raw->blue;
+	patch->measured[3] = raw->infrared;
+	patch->clear = raw->clear;
+	patch->reference[0] = red;
+	patch->reference[1] = green;
+	patch->reference[2] = blue;
+	patchCount++;
+	return CALIB_OK;
+}
+/**
+  * @brief Least squares fit of the matrix over all stored patches. The target of
+  * 	   every patch is reference*clear/255, so the existing "value*255/clear"
+  * 	   scaling on the display returns the reference color. Runs once, so the
+  * 	   normal equations are solved in double.
+  * @param _Bool useInfrared, fits 3x4 instead of 3x3
+  * @return CALIB_STATUS_t
+  */
+CALIB_STATUS_t calib_fit(_Bool useInfrared)
+{
+	const int n = useInfrared ? 4 : 3;
+	if(patchCount < n)
+		return CALIB_NOT_ENOUGH_PATCHES;
+
+	//Normal equations (X^T X) m = X^T t, one column of t per output channel
+	double a[4][4+3] = { 0 };
+	for(int p=0; p<patchCount; p++)
+	{
+		double x[4];
+		double t[3];
+		for(int i=0; i<n; i++)
+			x[i] = patches[p].measured[i] / 65535.0; //keep the system well conditioned
+		for(int k=0; k<3; k++)
+			t[k] = (patches[p].reference[k] * (double)patches[p].clear / 255.0) / 65535.0;
+		for(int i=0; i<n; i++)
+		{
+			for(int j=0; j<n; j++)
+				a[i][j] += x[i]*x[j];
+			for(int k=0; k<3; k++)
+				a[i][n+k] += x[i]*t[k];
+		}
+	}
+
+	//Gauss-Jordan with partial pivoting
+	for(int col=0; col<n; col++)
+	{
+		int pivot = col;
+		for(int row=col+1; row<n; row++)
+			if(fabs(a[row][col]) > fabs(a[pivot][col]))
+				pivot = row;
+		if(fabs(a[pivot][col]) < 1e-12)
+			return CALIB_ERROR; //patches do not span the color space
+		if(pivot != col)
+		{
+			for(int j=0; j<n+3; j++)
+			{
+				double tmp = a[col][j];
+				a[col][j] = a[pivot][j];
+				a[pivot][j] = tmp;
+			}
+		}
+		for(int row=0; row<n; row++)
+		{
+			if(row == col)
+				continue;
+			double factor = a[row][col] / a[col][col];
+			for(int j=col; j<n+3; j++)
+				a[row][j] -= factor * a[col][j];
+		}
+	}
+
+	int32_t fitted[3][4] = { 0 };
+	for(int k=0; k<3; k++)
+	{
+		for(int i=0; i<n; i++)
+		{
+			double coefficient = a[i][n+k] / a[i][i];
+			if(fabs(coefficient) > 64.0) //outside of any sensible correction
+				return CALIB_ERROR;
+			fitted[k][i] = (int32_t)lround(coefficient * CALIB_ONE);
+		}
+	}
+
+	memcpy(calibration.matrix, fitted, sizeof(calibration.matrix));
+	isIdentity = check_identity();
+	return CALIB_OK;
+}
+/**
+  * @brief Writes matrix, dark offsets and infrared coefficients to the reserved flash page
+  * @param None
+  * @return CALIB_STATUS_t, CALIB_FLASH_ERROR if erase or programming failed
+  */
+CALIB_STATUS_t calib_save(void)
+{
+	FLASH_EraseInitTypeDef erase;
+	uint32_t pageError = 0;
+	CALIB_STATUS_t status = CALIB_OK;
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.Banks = FLASH_BANK_1;
+	erase.Page = CALIB_FLASH_PAGE;
+	erase.NbPages = 1;
+
+	calibration.checksum = calc_checksum(&calibration);
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	if(HAL_FLASHEx_Erase(&erase, &pageError) != HAL_OK)
+		status = CALIB_FLASH_ERROR;
+
+	const uint64_t* data = (const uint64_t*)&calibration;
+	for(uint32_t i=0; status==CALIB_OK && i<(sizeof(calibration)/sizeof(uint64_t)); i++)
+	{
+		if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, CALIB_FLASH_ADDRESS + i*sizeof(uint64_t), data[i]) != HAL_OK)
+			status = CALIB_FLASH_ERROR;
+	}
+	HAL_FLASH_Lock();
+
+	if(status == CALIB_OK && memcmp((const void*)CALIB_FLASH_ADDRESS, &calibration, sizeof(calibration)) != 0)
+		status = CALIB_FLASH_ERROR;
+	return status;
+}
+/**
+  * @brief Resets to identity matrix without offsets and drops all recorded patches (flash is kept until next save)
+  * @param None
+  * @return None
+  */
+void calib_reset(void)
+{
+	set_identity();
+	scale_dark();
+	patchCount = 0;
+}
+/**
+  * @brief Takes a measurement in darkness (LED off, sensor covered) as offset for all channels,
+  * 	   measured with the running profile (calib_setSensitivity)
+  * @param const struct MEASUREMENT_S* dark, raw values
+  * @return None
+  */
+void calib_setDark(const struct MEASUREMENT_S* dark)
+{
+	calibration.darkSensitivity = activeSensitivity;
+	calibration.dark[0] = clamp_offset(dark->red);
+	calibration.dark[1] = clamp_offset(dark->green);
+	calibration.dark[2] = clamp_offset(dark->blue);
+	calibration.dark[3] = clamp_offset(dark->clear);
+	calibration.dark[4] = clamp_offset(dark->infrared);
+	scale_dark();
+}
+/**
+  * @brief Sets the sensitivity the raw values are measured with (high sensitivity
+  * 	   configuration in HDR mode, the fused values are scaled to it)
+  * @param uint16_t sensitivity, i2c_getSensitivity of the profile
+  * @return None
+  */
+void calib_setSensitivity(uint16_t sensitivity)
+{
+	activeSensitivity = sensitivity;
+	scale_dark();
+}
+/**
+  * @brief Sets how much of the infrared channel leaks into red, green and blue
+  * @param uint16_t red, green, blue in 1/1000 of the infrared count
+  * @return CALIB_STATUS_t, CALIB_ERROR if one is above CALIB_MAX_INFRARED (nothing changed)
+  */
+CALIB_STATUS_t calib_setInfrared(uint16_t red, uint16_t green, uint16_t blue)
+{
+	if(red > CALIB_MAX_INFRARED || green > CALIB_MAX_INFRARED || blue > CALIB_MAX_INFRARED)
+		return CALIB_ERROR; //would wrap to a negative coefficient
+	calibration.infrared[0] = (int16_t)(((uint32_t)red * CALIB_ONE + 500) / 1000);
+	calibration.infrared[1] = (int16_t)(((uint32_t)green * CALIB_ONE + 500) / 1000);
+	calibration.infrared[2] = (int16_t)(((uint32_t)blue * CALIB_ONE + 500) / 1000);
+	return CALIB_OK;
+}
+/**
+  * @brief Number of patches recorded since last reset
+  * @param None
+  * @return uint8_t
+  */
+uint8_t calib_getPatchCount(void)
+{
+	return patchCount;
+}
@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    closedloop.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Closed loop color matching: the LED is adjusted until the on-board
+  * 		 sensor measures the requested color and intensity.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "closedloop.h"
+#include "measurement.h"
+#include "calibration.h"
+#include "animation.h"
+#include "colorlut.h"
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Sets the LED and measures the first sample taken completely with the new color
+  * @param const uint32_t* duty R,G,B linear in Q8.8, int64_t* values R,G,B calibrated and unfiltered
+  * @return _Bool, false if the color did not reach the LED (nothing measured)
+  */
+_Bool clm_measure(const uint32_t* duty, int64_t* values)
+{
+	RGB16_t color;
+	struct MEASUREMENT_S calibrated;
+
+	color.red = gamma_Inverse(duty[0]);
+	color.green = gamma_Inverse(duty[1]);
+	color.blue = gamma_Inverse(duty[2]);
+	if(!animation_SetColorSettled(color, NULL))
+		return false; //a sample now would still see the previous drive
+
+	measurement_trigger(&calibrated); //starts now, only sees the new color
+	calib_compensate(&calibrated, &calibrated);
+	calib_apply(&calibrated);
+	values[0] = calibrated.red;
+	values[1] = calibrated.green;
+	values[2] = calibrated.blue;
+	return true;
+}
+/**
+  * @brief Measures the ambient light once (LED off), then corrects every channel
+  * 	   with a secant step through the ambient point: the gain of a channel is
+  * 	   (measured - ambient) / duty, the next duty is (goal - ambient) / gain.
+  * 	   For a LED without crosstalk this converges in one or two steps, each
+  * 	   step costs one triggered integration, at most CLM_MAX_ITERATIONS steps.
+  * 	   With a characterized LED (colorlut.c) the first step starts at the
+  * 	   table value.
+  * 	   Blocks the calling (measurement) task, the LED keeps the last drive.
+  * 	   Aborts with CLM_LED_TIMEOUT when a color does not reach the LED, the
+  * 	   step would otherwise use a sample of the previous drive.
+  * @param const CLM_TARGET_t* target, uint8_t* iterations used, RGB_t* drive (perceptual, as COL:)
+  * @return CLM_STATUS_t
+  */
+CLM_STATUS_t clm_run(const CLM_TARGET_t* target, uint8_t* iterations, RGB_t* drive)
+{
+	const uint8_t chroma[3] = { target->red, target->green, target->blue };
+	uint32_t duty[3] = { 0, 0, 0 };
+	int64_t ambient[3];
+	int64_t measured[3];
+	int64_t goal[3];
+	int64_t wanted[3];
+	_Bool saturated = false;
+	CLM_STATUS_t status = CLM_NOT_CONVERGED;
+
+	int64_t tolerance = ((int64_t)target->intensity * CLM_TOLERANCE) / 1000;
+	if(tolerance < CLM_MIN_TOLERANCE)
+		tolerance = CLM_MIN_TOLERANCE;
+
+	*iterations = 0;
+	if(!clm_measure(duty, ambient))
+	{
+		drive->red = 0;
+		drive->green = 0;
+		drive->blue = 0;
+		return CLM_LED_TIMEOUT;
+	}
+	for(int c=0; c<3; c++)
+	{
+		goal[c] = ((int64_t)chroma[c] * target->intensity) / 255;
+		wanted[c] = (goal[c] > ambient[c]) ? (goal[c] - ambient[c]) : 0;
+		duty[c] = (wanted[c] > tolerance) ? CLM_START_DUTY : 0;
+	}
+	//a characterized LED starts next to the target, usually one step is enough
+	lut_lookup(wanted, duty);
+
+	while(*iterations < CLM_MAX_ITERATIONS)
+	{
+		if(!clm_measure(duty, measured))
+		{
+			status = CLM_LED_TIMEOUT;
+			break;
+		}
+		(*iterations)++;
+
+		_Bool converged = true;
+		for(int c=0; c<3; c++)
+		{
+			int64_t error = measured[c] - goal[c];
+			if(error > tolerance || error < -tolerance)
+				converged = false;
+		}
+		if(converged)
+		{
+			status = CLM_CONVERGED;
+			break;
+		}
+
+		saturated = false;
+		for(int c=0; c<3; c++)
+		{
+			int64_t signal = measured[c] - ambient[c];
+			int64_t next;
+			if(wanted[c] <= 0)
+				next = 0; //ambient alone is already too bright
+			else if(duty[c] == 0 || signal < CLM_MIN_SIGNAL)
+				next = (duty[c] == 0) ? CLM_START_DUTY : (int64_t)duty[c] * 4; //not enough light to estimate the gain
+			else
+				next = ((int64_t)duty[c] * wanted[c]) / signal;
+
+			if(next > CLM_MAX_DUTY)
+			{
+				next = CLM_MAX_DUTY;
+				saturated = saturated || (duty[c] == CLM_MAX_DUTY);
+			}
+			duty[c] = (uint32_t)next;
+		}
+		if(saturated)
+		{
+			status = CLM_OUT_OF_RANGE;
+			break;
+		}
+	}
+
+	drive->red = (gamma_Inverse(duty[0]) + 128) / 257;
+	drive->green = (gamma_Inverse(duty[1]) + 128) / 257;
+	drive->blue = (gamma_Inverse(duty[2]) + 128) / 257;
+	return status;
+}
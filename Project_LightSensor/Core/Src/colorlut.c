@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file    colorlut.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Characterization of the LED with the on-board sensor and inverse
+  * 		 3D lookup table (sensor color -> LED drive), stored in flash.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "colorlut.h"
+#include "closedloop.h"
+#include "animation.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+//Page before the calibration page, removed from FLASH region in STM32L432KCUX_FLASH.ld
+#define LUT_FLASH_PAGE 126
+#define LUT_FLASH_ADDRESS (FLASH_BASE + (LUT_FLASH_PAGE * FLASH_PAGE_SIZE))
+
+#define LUT_MAGIC 0x4C555433 //"LUT3"
+#define LUT_VERSION 1
+
+#if LUT_MAX_DUTY != CLM_MAX_DUTY
+#error "the table has to cover the duty range of the closed loop"
+#endif
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct LutData
+{
+	uint32_t magic;
+	uint32_t version;
+	LUT_GRID_t grid; //white and drives, layout of version 1
+	uint32_t checksum;
+}LUT_DATA_t; //multiple of 8 Byte for double word programming
+
+/* Globals -------------------------------------------------------------------*/
+static LUT_DATA_t table;
+static _Bool valid = false;
+
+static int32_t sweep[LUT_SWEEP_POINTS][3]; //R,G,B above ambient for every drive of the grid
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t calc_checksum(const LUT_DATA_t* data)
+{
+	const uint32_t* words = (const uint32_t*)data;
+	uint32_t sum = 0;
+	for(uint32_t i=0; i<(offsetof(LUT_DATA_t, checksum)/sizeof(uint32_t)); i++)
+		sum += words[i];
+	return ~sum;
+}
+static LUT_STATUS_t save_table(void)
+{
+	FLASH_EraseInitTypeDef erase;
+	uint32_t pageError = 0;
+	LUT_STATUS_t status = LUT_OK;
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.Banks = FLASH_BANK_1;
+	erase.Page = LUT_FLASH_PAGE;
+	erase.NbPages = 1;
+
+	table.checksum = calc_checksum(&table);
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	if(HAL_FLASHEx_Erase(&erase, &pageError) != HAL_OK)
+		status = LUT_FLASH_ERROR;
+
+	const uint64_t* data = (const uint64_t*)&table;
+	for(uint32_t i=0; status==LUT_OK && i<(sizeof(table)/sizeof(uint64_t)); i++)
+	{
+		if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, LUT_FLASH_ADDRESS + i*sizeof(uint64_t), data[i]) != HAL_OK)
+			status = LUT_FLASH_ERROR;
+	}
+	HAL_FLASH_Lock();
+
+	if(status == LUT_OK && memcmp((const void*)LUT_FLASH_ADDRESS, &table, sizeof(table)) != 0)
+		status = LUT_FLASH_ERROR;
+	return status;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Loads the table from flash, without a valid table every lookup
+  * 	   returns LUT_NOT_CHARACTERIZED.
+  * @param None
+  * @return None
+  */
+void lut_Init(void)
+{
+	const LUT_DATA_t* stored = (const LUT_DATA_t*)LUT_FLASH_ADDRESS;
+	valid = (stored->magic == LUT_MAGIC && stored->version == LUT_VERSION && stored->checksum == calc_checksum(stored));
+	if(valid)
+		memcpy(&table, stored, sizeof(table));
+}
+/**
+  * @brief Returns if a characterization is available
+  * @param None
+  * @return _Bool
+  */
+_Bool lut_isValid(void)
+{
+	return valid;
+}
+/**
+  * @brief Sweeps the LED over a LUT_SWEEP_LEVELS^3 grid of linear drives, measures
+  * 	   every point (one triggered integration, ~15 s with the default profile),
+  * 	   inverts the grid into the table and saves it. The LED is off afterwards.
+  * 	   Blocks the calling (measurement) task.
+  * @param None
+  * @return LUT_STATUS_t, LUT_ERROR if a channel of the LED is not measurable
+  */
+LUT_STATUS_t lut_characterize(void)
+{
+	int64_t ambient[3] = { 0 };
+	int64_t values[3];
+	uint32_t duty[3];
+	LUT_STATUS_t status = LUT_OK;
+
+	for(uint32_t point=0; point<LUT_SWEEP_POINTS; point++)
+	{
+		duty[0] = (point / (LUT_SWEEP_LEVELS * LUT_SWEEP_LEVELS)) * LUT_SWEEP_STEP;
+		duty[1] = ((point / LUT_SWEEP_LEVELS) % LUT_SWEEP_LEVELS) * LUT_SWEEP_STEP;
+		duty[2] = (point % LUT_SWEEP_LEVELS) * LUT_SWEEP_STEP;
+		if(!clm_measure(duty, values))
+		{
+			animation_SetColor16((RGB16_t){ 0, 0, 0 });
+			return LUT_ERROR; //the table would mix in a point of the previous drive
+		}
+		if(point == 0)
+			memcpy(ambient, values, sizeof(ambient)); //first point is the LED off
+		for(int c=0; c<3; c++)
+			sweep[point][c] = (int32_t)(values[c] - ambient[c]);
+	}
+	animation_SetColor16((RGB16_t){ 0, 0, 0 });
+
+	valid = false;
+	memset(&table, 0, sizeof(table));
+	table.magic = LUT_MAGIC;
+	table.version = LUT_VERSION;
+	if(!lut_gridBuild(&table.grid, (const int32_t (*)[3])sweep))
+		status = LUT_ERROR;
+	else
+		status = save_table();
+
+	if(status == LUT_OK)
+		valid = true;
+	else
+		lut_Init(); //keep the previous table
+	return status;
+}
+/**
+  * @brief Finds the LED drive for a sensor color by tetrahedral interpolation
+  * 	   of the table (integer only, a few microseconds)
+  * @param const int64_t* target R,G,B calibrated counts above ambient, uint32_t* duty R,G,B linear in Q8.8
+  * @return LUT_STATUS_t, LUT_OUT_OF_GAMUT if the color is not reachable (duty is the nearest)
+  */
+LUT_STATUS_t lut_lookup(const int64_t* target, uint32_t* duty)
+{
+	if(!valid)
+		return LUT_NOT_CHARACTERIZED;
+	return lut_gridLookup(&table.grid, target, duty) ? LUT_OK : LUT_OUT_OF_GAMUT;
+}
+/**
+  * @brief Shows a sensor color without closed loop
+  * @param uint8_t red, green, blue 0...255 of the full white LED, RGB_t* drive (perceptual, as COL:)
+  * @return LUT_STATUS_t
+  */
+LUT_STATUS_t lut_show(uint8_t red, uint8_t green, uint8_t blue, RGB_t* drive)
+{
+	const uint8_t relative[3] = { red, green, blue };
+	int64_t target[3];
+	uint32_t duty[3];
+	RGB16_t color;
+
+	for(int c=0; c<3; c++)
+		target[c] = ((int64_t)relative[c] * table.grid.white[c]) / 255;
+	LUT_STATUS_t status = lut_lookup(target, duty);
+	if(status == LUT_NOT_CHARACTERIZED)
+		return status;
+
+	color.red = gamma_Inverse(duty[0]);
+	color.green = gamma_Inverse(duty[1]);
+	color.blue = gamma_Inverse(duty[2]);
+	animation_SetColor16(color);
+	drive->red = (color.red + 128) / 257;
+	drive->green = (color.green + 128) / 257;
+	drive->blue = (color.blue + 128) / 257;
+	return status;
+}
@@ -0,0 +1,211 @@
+/**
+  ******************************************************************************
+  * @file    command.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Table driven dispatcher for ASCII commands and binary link frames.
+  * 		 Frame types index a table directly, the three letter ASCII names
+  * 		 are found in a small hash table, both in constant time.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "command.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define COMMAND_HASH_SIZE (1 << COMMAND_HASH_BITS)
+
+/* Globals -------------------------------------------------------------------*/
+static COMMAND_STATS_t commands[COMMAND_MAX];
+static uint8_t count = 0;
+//index + 1 into commands, 0 is free
+static uint8_t byOpcode[COMMAND_OPCODES];
+static uint8_t byName[COMMAND_HASH_SIZE];
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Multiplicative hash of the three letters, the top bits select the slot
+ */
+static uint8_t hash_name(const char* name)
+{
+	uint32_t key = ((uint32_t)(uint8_t)name[0] << 16) | ((uint32_t)(uint8_t)name[1] << 8) | (uint8_t)name[2];
+	return (uint8_t)((key * 2654435761UL) >> (32 - COMMAND_HASH_BITS));
+}
+/*
+ * Slot of the name, or the free slot where it belongs (linear probing, the
+ * table never fills up)
+ */
+static uint8_t find_name(const char* name)
+{
+	uint8_t slot = hash_name(name);
+	while(byName[slot] != 0 && strncmp(commands[byName[slot] - 1].entry->name, name, COMMAND_NAME_LENGTH) != 0)
+		slot = (slot + 1) & (COMMAND_HASH_SIZE - 1);
+	return slot;
+}
+/*
+ * Splits the ASCII arguments as the schema describes, false if they do not fit
+ */
+static _Bool parse_text(const char* text, const COMMAND_SCHEMA_t* schema, COMMAND_t* command)
+{
+	const char* position = text;
+	char* end;
+
+	if(schema->args == COMMAND_ARGS_TEXT)
+		return true;
+	if(schema->args == COMMAND_ARGS_OPERATION && *position != '\0')
+	{
+		command->operation = *position++;
+		if(*position == ',')
+			position++;
+	}
+	while(*position != '\0')
+	{
+		if(command->argCount >= schema->maxArgs)
+			return false;
+		long value = strtol(position, &end, 0);
+		if(end == position)
+			return false;
+		command->args[command->argCount++] = (int32_t)value;
+		position = end;
+		while(isspace((unsigned char)*position))
+			position++;
+		if(*position == ',')
+			position++;
+		else if(*position != '\0')
+			return false;
+	}
+	return true;
+}
+/*
+ * Runs the handler and measures it with the DWT cycle counter
+ */
+static void run(COMMAND_STATS_t* stats, const COMMAND_t* command)
+{
+	uint32_t start = DWT->CYCCNT;
+	stats->entry->handler(command);
+	stats->cycles = DWT->CYCCNT - start;
+	stats->calls++;
+	stats->totalCycles += stats->cycles;
+	if(stats->cycles > stats->maxCycles)
+		stats->maxCycles = stats->cycles;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Adds a command to the tables. Call at init, before the protocol task
+  * 	   runs. The entry has to stay valid (static const).
+  * @param const COMMAND_ENTRY_t* entry with name, opcode or both
+  * @return COMMAND_STATUS_t COMMAND_OK, COMMAND_INVALID or COMMAND_FULL
+  */
+COMMAND_STATUS_t command_register(const COMMAND_ENTRY_t* entry)
+{
+	_Bool named = (entry->name[0] != '\0');
+	uint8_t slot = 0;
+
+	if(entry->handler == NULL || entry->opcode >= COMMAND_OPCODES || entry->schema.maxArgs > COMMAND_MAX_ARGS)
+		return COMMAND_INVALID;
+	if(named && strlen(entry->name) != COMMAND_NAME_LENGTH)
+		return COMMAND_INVALID;
+	if(!named && entry->opcode == 0)
+		return COMMAND_INVALID;
+	if(count >= COMMAND_MAX)
+		return COMMAND_FULL;
+	if(entry->opcode != 0 && byOpcode[entry->opcode] != 0)
+		return COMMAND_FULL;
+	if(named)
+	{
+		slot = find_name(entry->name);
+		if(byName[slot] != 0)
+			return COMMAND_FULL;
+	}
+
+	memset(&commands[count], 0, sizeof(commands[count]));
+	commands[count].entry = entry;
+	count++;
+	if(entry->opcode != 0)
+		byOpcode[entry->opcode] = count;
+	if(named)
+		byName[slot] = count;
+	return COMMAND_OK;
+}
+/**
+  * @brief Runs an ASCII command "XXX:arguments" (without CR/LF)
+  * @param const char* text
+  * @return COMMAND_STATUS_t
+  */
+COMMAND_STATUS_t command_dispatchText(const char* text)
+{
+	COMMAND_t command;
+	COMMAND_STATS_t* stats;
+
+	if(strnlen(text, COMMAND_NAME_LENGTH + 1) <= COMMAND_NAME_LENGTH || text[COMMAND_NAME_LENGTH] != ':')
+		return COMMAND_UNKNOWN;
+	uint8_t index = byName[find_name(text)];
+	if(index == 0)
+		return COMMAND_UNKNOWN;
+	stats = &commands[index - 1];
+
+	memset(&command, 0, sizeof(command));
+	command.text = &text[COMMAND_NAME_LENGTH + 1];
+	if(!parse_text(command.text, &stats->entry->schema, &command))
+	{
+		stats->rejected++;
+		return COMMAND_INVALID;
+	}
+	run(stats, &command);
+	return COMMAND_OK;
+}
+/**
+  * @brief Runs a decoded binary frame, every payload byte is one argument
+  * @param const LINK_MESSAGE_t* message
+  * @return COMMAND_STATUS_t
+  */
+COMMAND_STATUS_t command_dispatchMessage(const LINK_MESSAGE_t* message)
+{
+	COMMAND_t command;
+	COMMAND_STATS_t* stats;
+
+	if(message->type >= COMMAND_OPCODES || byOpcode[message->type] == 0)
+		return COMMAND_UNKNOWN;
+	stats = &commands[byOpcode[message->type] - 1];
+	if(message->length < stats->entry->schema.minLength || message->length > stats->entry->schema.maxLength)
+	{
+		stats->rejected++;
+		return COMMAND_INVALID;
+	}
+
+	memset(&command, 0, sizeof(command));
+	command.binary = true;
+	command.id = message->id;
+	command.text = "";
+	command.payload = message->payload;
+	command.argCount = message->length;
+	for(int i=0; i<message->length && i<COMMAND_MAX_ARGS; i++)
+		command.args[i] = message->payload[i];
+	run(stats, &command);
+	return COMMAND_OK;
+}
+/**
+  * @brief Number of registered commands
+  * @param None
+  * @return uint8_t
+  */
+uint8_t command_getCount(void)
+{
+	return count;
+}
+/**
+  * @brief Copy of the counters of one command, in order of registration
+  * @param uint8_t index < command_getCount(), COMMAND_STATS_t* copy
+  * @return _Bool false if index is out of range
+  */
+_Bool command_getStats(uint8_t index, COMMAND_STATS_t* copy)
+{
+	if(index >= count)
+		return false;
+	memcpy(copy, &commands[index], sizeof(*copy));
+	return true;
+}
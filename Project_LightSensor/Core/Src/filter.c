@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file    filter.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Streaming filter between acquisition and output: moving average,
+  * 		 median and exponential moving average per channel.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "filter.h"
+#include "command.h"
+
+/* Globals -------------------------------------------------------------------*/
+static FILTER_WINDOW_t filterWindow;
+//mode and window in one variable, so the uart callback changes both at once
+static volatile uint16_t requestedConfig = (FILTER_NONE << 8) | 1;
+static uint16_t appliedConfig = 0;
+
+static uint32_t cycles = 0;
+static uint32_t maxCycles = 0;
+
+/* Private Functions ---------------------------------------------------------*/
+static void apply_config(uint16_t config)
+{
+	appliedConfig = config;
+	filter_windowInit(&filterWindow, (FILTER_MODE_t)(config >> 8), config & 0xFF);
+	maxCycles = 0;
+}
+/*
+ * FLT:mode,n selects the filter, FLT: only reports
+ */
+static void command_filter(const COMMAND_t* command)
+{
+	int32_t window = command->args[0];
+
+	//clamped before the narrowing to uint8_t, 256 would wrap to 0
+	if(window < 1)
+		window = 1;
+	if(window > FILTER_MAX_WINDOW)
+		window = FILTER_MAX_WINDOW;
+	if(command->operation != '\0')
+		filter_configure((FILTER_MODE_t)command->operation, (uint8_t)window);
+	osEventFlagsSet(colorUpdateEventHandle,FILTER_REPORT);
+}
+
+static const COMMAND_ENTRY_t filterCommand = { "FLT", 0, { COMMAND_ARGS_OPERATION, 1, 0, 0 }, command_filter };
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Starts without filtering and registers FLT:
+  * @param None
+  * @return _Bool, false if the command could not be registered
+  */
+_Bool filter_Init(void)
+{
+	requestedConfig = (FILTER_NONE << 8) | 1;
+	apply_config(requestedConfig);
+	return (command_register(&filterCommand) == COMMAND_OK);
+}
+/**
+  * @brief Requests another filter, applied with the next sample (safe to call
+  * 	   from the uart callback)
+  * @param FILTER_MODE_t mode, uint8_t window 1...FILTER_MAX_WINDOW (clamped)
+  * @return None
+  */
+void filter_configure(FILTER_MODE_t mode, uint8_t window)
+{
+	requestedConfig = ((uint16_t)mode << 8) | window;
+}
+/**
+  * @brief Applies the requested filter if it changed, done by filter_process as well
+  * @param None
+  * @return _Bool, true if the filter was changed (window is cleared)
+  */
+_Bool filter_applyConfig(void)
+{
+	uint16_t config = requestedConfig;
+	if(config == appliedConfig)
+		return false;
+	apply_config(config);
+	return true;
+}
+/**
+  * @brief Drops all samples in the window, e.g. after the profile was changed
+  * @param None
+  * @return None
+  */
+void filter_reset(void)
+{
+	filter_windowReset(&filterWindow);
+	maxCycles = 0;
+}
+/**
+  * @brief Adds a sample to the window of every channel and replaces it with
+  * 	   the filtered value (filter_window.c). The cost of every call is
+  * 	   measured, see filter_getCycles and filter_getMaxCycles; on the host
+  * 	   Tools/filter_bench.c times the windows alone.
+  * @param struct MEASUREMENT_S* values
+  * @return None
+  */
+void filter_process(struct MEASUREMENT_S* values)
+{
+	uint32_t start = DWT->CYCCNT;
+	filter_applyConfig();
+
+	uint32_t channel_values[FILTER_CHANNELS] = { values->red, values->green, values->blue, values->clear, values->infrared };
+	filter_windowAdd(&filterWindow, channel_values);
+	values->red = channel_values[0];
+	values->green = channel_values[1];
+	values->blue = channel_values[2];
+	values->clear = channel_values[3];
+	values->infrared = channel_values[4];
+
+	cycles = DWT->CYCCNT - start;
+	if(cycles > maxCycles)
+		maxCycles = cycles;
+}
+/**
+  * @brief Active filter mode
+  * @param None
+  * @return FILTER_MODE_t
+  */
+FILTER_MODE_t filter_getMode(void)
+{
+	return filterWindow.mode;
+}
+/**
+  * @brief Active window length
+  * @param None
+  * @return uint8_t
+  */
+uint8_t filter_getWindow(void)
+{
+	return filterWindow.window;
+}
+/**
+  * @brief CPU cycles of the last filter_process call (DWT cycle counter)
+  * @param None
+  * @return uint32_t
+  */
+uint32_t filter_getCycles(void)
+{
+	return cycles;
+}
+/**
+  * @brief Maximum CPU cycles of filter_process since the last reset
+  * @param None
+  * @return uint32_t
+  */
+uint32_t filter_getMaxCycles(void)
+{
+	return maxCycles;
+}
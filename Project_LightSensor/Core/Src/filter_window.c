@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    filter_window.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Sample windows of the streaming filter (filter.c): moving
+  * 		 average, median and exponential moving average of every channel.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "filter_window.h"
+#include <string.h>
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Binary search for the position of value in the sorted window
+ */
+static uint8_t find_position(const uint32_t* sorted, uint8_t length, uint32_t value)
+{
+	uint8_t low = 0;
+	uint8_t high = length;
+	while(low < high)
+	{
+		uint8_t middle = (low + high) / 2;
+		if(sorted[middle] < value)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+/*
+ * Replaces the oldest sample (if the window is full) with the new one,
+ * a single shift of the elements in between keeps the window sorted
+ */
+static void update_sorted(uint32_t* sorted, uint8_t length, _Bool full, uint32_t oldest, uint32_t value)
+{
+	if(full)
+	{
+		uint8_t remove = find_position(sorted, length, oldest);
+		memmove(&sorted[remove], &sorted[remove+1], (length - remove - 1) * sizeof(uint32_t));
+		length--;
+	}
+	uint8_t insert = find_position(sorted, length, value);
+	memmove(&sorted[insert+1], &sorted[insert], (length - insert) * sizeof(uint32_t));
+	sorted[insert] = value;
+}
+static uint32_t filter_channel(FILTER_WINDOW_t* filter, FILTER_CHANNEL_t* channel, uint32_t value)
+{
+	uint8_t count = filter->count;
+	_Bool full = (count == filter->window);
+	uint32_t oldest = channel->ring[filter->head];
+	channel->ring[filter->head] = value;
+
+	if(filter->mode == FILTER_AVERAGE)
+	{
+		channel->sum += value;
+		if(full)
+			channel->sum -= oldest;
+		uint8_t length = full ? count : count + 1;
+		return (uint32_t)((channel->sum + length/2) / length);
+	}
+	if(filter->mode == FILTER_MEDIAN)
+	{
+		uint8_t length = full ? count : count + 1;
+		update_sorted(channel->sorted, count, full, oldest, value);
+		if(length & 1)
+			return channel->sorted[length/2];
+		return (uint32_t)(((uint64_t)channel->sorted[length/2 - 1] + channel->sorted[length/2] + 1) / 2);
+	}
+	if(filter->mode == FILTER_EMA)
+	{
+		int64_t input = (int64_t)value << FILTER_EMA_BITS;
+		if(count == 0)
+			channel->ema = input;
+		else
+			channel->ema += ((input - channel->ema) * filter->emaAlpha) >> FILTER_EMA_BITS;
+		return (uint32_t)((channel->ema + (1 << (FILTER_EMA_BITS-1))) >> FILTER_EMA_BITS);
+	}
+	return value;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Selects the filter and empties the window
+  * @param FILTER_WINDOW_t* filter
+  * @param FILTER_MODE_t mode, an unknown one is FILTER_NONE
+  * @param uint8_t window 1...FILTER_MAX_WINDOW (clamped)
+  * @return None
+  */
+void filter_windowInit(FILTER_WINDOW_t* filter, FILTER_MODE_t mode, uint8_t window)
+{
+	if(window < 1)
+		window = 1;
+	if(window > FILTER_MAX_WINDOW)
+		window = FILTER_MAX_WINDOW;
+	if(mode != FILTER_AVERAGE && mode != FILTER_MEDIAN && mode != FILTER_EMA)
+	{
+		mode = FILTER_NONE;
+		window = 1;
+	}
+	filter->mode = mode;
+	filter->window = window;
+	filter->emaAlpha = (2 << FILTER_EMA_BITS) / (window + 1);
+	filter_windowReset(filter);
+}
+/**
+  * @brief Drops all samples in the window, the filter stays
+  * @param FILTER_WINDOW_t* filter
+  * @return None
+  */
+void filter_windowReset(FILTER_WINDOW_t* filter)
+{
+	memset(filter->channels, 0, sizeof(filter->channels));
+	filter->head = 0;
+	filter->count = 0;
+}
+/**
+  * @brief Adds a sample to the window of every channel and replaces it with
+  * 	   the filtered value. Until the window is full the samples so far are
+  * 	   filtered.
+  * @param FILTER_WINDOW_t* filter
+  * @param uint32_t values[FILTER_CHANNELS] R,G,B,C,IR
+  * @return None
+  */
+void filter_windowAdd(FILTER_WINDOW_t* filter, uint32_t values[FILTER_CHANNELS])
+{
+	for(uint8_t i = 0; i < FILTER_CHANNELS; i++)
+		values[i] = filter_channel(filter, &filter->channels[i], values[i]);
+
+	filter->head = (filter->head + 1 < filter->window) ? filter->head + 1 : 0;
+	if(filter->count < filter->window)
+		filter->count++;
+}
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    gamma.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Gamma correct LED output stage: 16 bit channel values are mapped
+  * 		 to 8 bit frames with temporal dithering of the remaining fraction.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "gamma.h"
+
+/* Globals -------------------------------------------------------------------*/
+//(i/256)^2.2 * 255 in Q8.8, one entry per upper byte of the input plus end point
+static const uint16_t gammaTable[257] = {
+	0, 0, 2, 4, 7, 11, 17, 24, 32, 41, 52, 64, 78, 93, 109, 127,
+	146, 167, 190, 214, 239, 266, 295, 325, 357, 391, 426, 463, 502, 542, 584, 628,
+	673, 720, 769, 820, 872, 926, 982, 1040, 1099, 1161, 1224, 1289, 1356, 1425, 1495, 1568,
+	1642, 1718, 1796, 1876, 1958, 2042, 2128, 2215, 2305, 2396, 2490, 2585, 2683, 2782, 2883, 2987,
+	3092, 3199, 3309, 3420, 3533, 3649, 3766, 3885, 4007, 4130, 4256, 4383, 4513, 4644, 4778, 4914,
+	5052, 5192, 5334, 5478, 5624, 5773, 5923, 6076, 6230, 6387, 6546, 6707, 6870, 7036, 7203, 7373,
+	7545, 7719, 7895, 8073, 8254, 8436, 8621, 8808, 8998, 9189, 9383, 9578, 9777, 9977, 10179, 10384,
+	10591, 10800, 11011, 11225, 11441, 11659, 11879, 12102, 12327, 12554, 12783, 13015, 13249, 13485, 13724, 13964,
+	14207, 14453, 14700, 14950, 15202, 15457, 15714, 15973, 16234, 16498, 16764, 17033, 17303, 17577, 17852, 18130,
+	18410, 18692, 18977, 19264, 19554, 19845, 20140, 20436, 20735, 21036, 21340, 21646, 21955, 22265, 22579, 22894,
+	23212, 23533, 23855, 24180, 24508, 24838, 25170, 25505, 25842, 26182, 26524, 26869, 27215, 27565, 27916, 28271,
+	28627, 28986, 29348, 29712, 30078, 30447, 30818, 31192, 31568, 31947, 32328, 32712, 33098, 33486, 33877, 34271,
+	34667, 35065, 35466, 35870, 36276, 36684, 37095, 37508, 37924, 38343, 38764, 39187, 39613, 40042, 40473, 40906,
+	41342, 41781, 42222, 42665, 43111, 43560, 44011, 44465, 44921, 45380, 45841, 46305, 46772, 47241, 47712, 48186,
+	48663, 49142, 49624, 50108, 50595, 51085, 51577, 52071, 52569, 53068, 53571, 54076, 54583, 55093, 55606, 56121,
+	56639, 57160, 57683, 58208, 58737, 59268, 59801, 60337, 60876, 61417, 61961, 62508, 63057, 63609, 64163, 64720,
+	65280
+};
+
+//error accumulators of the temporal dithering, R,G,B
+static uint8_t ditherError[3] = { 0 };
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Sigma-delta: the fraction is accumulated frame by frame and carried into
+ * the integer part when it overflows, so the average over the frames hits
+ * the fraction. Returns true if a fraction is left (frames keep changing).
+ */
+static uint8_t dither_channel(uint16_t corrected, uint8_t* error, _Bool* active)
+{
+	uint8_t value = corrected >> 8;
+	uint8_t fraction = (corrected & 0xFF) >> (8 - GAMMA_DITHER_BITS);
+	if(fraction == 0 || value == 255)
+		return value;
+
+	*active = true;
+	*error += fraction;
+	if(*error >= (1 << GAMMA_DITHER_BITS))
+	{
+		*error -= (1 << GAMMA_DITHER_BITS);
+		value++;
+	}
+	return value;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Gamma correction with linear interpolation between table entries
+  * @param uint16_t value, perceptual 0...65535
+  * @return uint16_t LED duty in Q8.8 (0...255.0)
+  */
+uint16_t gamma_Correct(uint16_t value)
+{
+	//position in the table in Q8, 65535 -> 256.0 (last entry)
+	uint32_t position = ((uint32_t)value << 16) / 0xFFFF;
+	uint32_t index = position >> 8;
+	if(index >= 256)
+		return gammaTable[256];
+	int32_t low = gammaTable[index];
+	int32_t high = gammaTable[index+1];
+	return (uint16_t)(low + (((high - low) * (int32_t)(position & 0xFF)) >> 8));
+}
+/**
+  * @brief Gamma corrects a color and quantizes it to the next 8 bit frame,
+  * 	   has to be called for every frame that is sent
+  * @param const RGB16_t* color, RGB_t* frame
+  * @return _Bool, true while dithering, frames have to be sent continuously
+  */
+_Bool gamma_Dither(const RGB16_t* color, RGB_t* frame)
+{
+	_Bool active = false;
+	frame->red = dither_channel(gamma_Correct(color->red), &ditherError[0], &active);
+	frame->green = dither_channel(gamma_Correct(color->green), &ditherError[1], &active);
+	frame->blue = dither_channel(gamma_Correct(color->blue), &ditherError[2], &active);
+	return active;
+}
+/**
+  * @brief Inverse of gamma_Correct (binary search, 16 steps)
+  * @param uint16_t duty in Q8.8
+  * @return uint16_t smallest perceptual value that reaches the duty
+  */
+uint16_t gamma_Inverse(uint16_t duty)
+{
+	uint32_t low = 0;
+	uint32_t high = 0xFFFF;
+	while(low < high)
+	{
+		uint32_t middle = (low + high) / 2;
+		if(gamma_Correct(middle) < duty)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return (uint16_t)low;
+}
+/**
+  * @brief Widens an 8 bit color to the 16 bit range (255 -> 65535)
+  * @param RGB_t color
+  * @return RGB16_t
+  */
+RGB16_t gamma_Expand(RGB_t color)
+{
+	RGB16_t wide;
+	wide.red = color.red * 257;
+	wide.green = color.green * 257;
+	wide.blue = color.blue * 257;
+	return wide;
+}
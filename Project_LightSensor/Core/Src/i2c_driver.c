@@ -52,6 +52,7 @@ const uint16_t I2C_CFG_GAIN2_X4 = 0x0800;
 uint8_t address = 0x10;
 uint8_t HIGH_LOW_buffer[2] = { 0 };
 I2C_HandleTypeDef* hi2c_local = NULL;
+static uint16_t activeConfig = 0;
 
 /* Functions -----------------------------------------------------------------*/
 /**
@@ -126,14 +127,12 @@ uint16_t i2c_getIR(void)
 	return (uint16_t)(HIGH_LOW_buffer[0] | (HIGH_LOW_buffer[1]<<8));
 }
 /**
-  * @brief sends Configuration to VEML3328 Color Sensor
-  * @param None
-  * @return None
+  * @brief Writes a configuration to the VEML3328 and reads it back
+  * @param uint16_t config, combination of I2C_CFG_ values
+  * @return _Bool, true if the sensor accepted the configuration
   */
-_Bool i2c_startUp()
+_Bool i2c_setConfig(uint16_t config)
 {
-	//Identical to default Configuration, apart from Integration time
-	uint16_t config = (I2C_CFG_PWR_ON | I2C_CFG_MEAS_ALL_CHANNELS | I2C_CFG_GAIN1_X1 | I2C_CFG_GAIN2_X1 | I2C_CFG_HDR_ONE | I2C_CFG_INTEGRATION_TIME_100MS | I2C_CFG_MODE_AUTO | I2C_CFG_TRIGGER_NONE);
 	HIGH_LOW_buffer[0] = config & 0xFF;
 	HIGH_LOW_buffer[1] = config >> 8;
 
@@ -143,6 +142,60 @@ _Bool i2c_startUp()
 	HAL_I2C_Mem_Read(hi2c_local, (I2C_SLAVE_ADDR<<1), I2C_CMD_CFG_REG, 1, HIGH_LOW_buffer, 2, HAL_MAX_DELAY);
 	uint16_t check_config = (uint16_t)(HIGH_LOW_buffer[0] | (HIGH_LOW_buffer[1]<<8));
 
-	return (config == check_config);
+	activeConfig = check_config;
+	//trigger bit clears itself at the end of the integration
+	return ((config & ~I2C_CFG_TRIGGER_ONCE) == (check_config & ~I2C_CFG_TRIGGER_ONCE));
 }
+/**
+  * @brief sends Configuration to VEML3328 Color Sensor
+  * @param None
+  * @return None
+  */
+_Bool i2c_startUp()
+{
+	//Identical to default Configuration, apart from Integration time
+	return i2c_setConfig(i2c_getDefaultConfig());
+}
+/**
+  * @brief Configuration used after start up
+  * @param None
+  * @return uint16_t config
+  */
+uint16_t i2c_getDefaultConfig(void)
+{
+	return (I2C_CFG_PWR_ON | I2C_CFG_MEAS_ALL_CHANNELS | I2C_CFG_GAIN1_X1 | I2C_CFG_GAIN2_X1 | I2C_CFG_HDR_ONE | I2C_CFG_INTEGRATION_TIME_100MS | I2C_CFG_MODE_AUTO | I2C_CFG_TRIGGER_NONE);
+}
+/**
+  * @brief Last configuration read back from the VEML3328
+  * @param None
+  * @return uint16_t config
+  */
+uint16_t i2c_getConfig(void)
+{
+	return activeConfig;
+}
+/**
+  * @brief Integration time of the active configuration
+  * @param None
+  * @return uint16_t integration time in ms (50, 100, 200 or 400)
+  */
+uint16_t i2c_getIntegrationTime(void)
+{
+	return 50 << ((activeConfig & I2C_CFG_INTEGRATION_TIME_400MS) >> 4);
+}
+/**
+  * @brief Relative sensitivity of a configuration (gains, HDR bit and integration time),
+  * 	   in 1/6 steps so that x1/2 gain and 1/3 HDR stay integer.
+  * 	   1 * 6 = gain x1, HDR_ONE, 50ms
+  * @param uint16_t config
+  * @return uint16_t sensitivity (1 ... 768)
+  */
+uint16_t i2c_getSensitivity(uint16_t config)
+{
+	static const uint8_t gain1[4] = { 1, 2, 4, 4 }; //bits 13:12
+	static const uint8_t gain2[4] = { 2, 4, 8, 1 }; //bits 11:10 in 1/2 steps, 0b11 = GAIN1_HALF
 
+	uint16_t sensitivity = gain1[(config >> 12) & 0x3] * gain2[(config >> 10) & 0x3];
+	sensitivity *= (config & I2C_CFG_HDR_THIRD) ? 1 : 3;
+	return sensitivity << ((config & I2C_CFG_INTEGRATION_TIME_400MS) >> 4);
+}
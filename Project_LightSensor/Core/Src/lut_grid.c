@@ -0,0 +1,207 @@
+/**
+  ******************************************************************************
+  * @file    lut_grid.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Inverse 3D lookup table of the LED (colorlut.c): inverted from
+  * 		 the measured sweep, looked up by tetrahedral interpolation.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "lut_grid.h"
+#include <math.h>
+
+/* Globals -------------------------------------------------------------------*/
+//axis order of the 6 tetrahedra of a cube
+static const uint8_t tetrahedra[6][3] = {
+	{ 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+};
+
+/* Private Functions ---------------------------------------------------------*/
+static double clamp_weight(double value, double low)
+{
+	if(value < low)
+		return low;
+	if(value > 1.0)
+		return 1.0;
+	return value;
+}
+/*
+ * Inverts the measured grid for one sensor color: every tetrahedron of the
+ * sweep is affine, so the drive follows from a 3x3 solve. The tetrahedron
+ * that contains the color wins. Colors outside of the gamut are extrapolated
+ * from the tetrahedron with the nearest surface (even to negative drives), so interpolation
+ * between entries stays accurate up to the border of the gamut.
+ */
+static void build_entry(LUT_GRID_t* grid, const int32_t sweep[LUT_SWEEP_POINTS][3], uint32_t entry, const double* target)
+{
+	double best = INFINITY;
+	double drive[3] = { 0 };
+	const uint32_t stride[3] = { LUT_SWEEP_LEVELS * LUT_SWEEP_LEVELS, LUT_SWEEP_LEVELS, 1 };
+
+	for(uint32_t cell=0; cell<LUT_SWEEP_POINTS; cell++)
+	{
+		const uint32_t base[3] = { cell / stride[0], (cell / stride[1]) % LUT_SWEEP_LEVELS, cell % LUT_SWEEP_LEVELS };
+		if(base[0] == LUT_SWEEP_LEVELS-1 || base[1] == LUT_SWEEP_LEVELS-1 || base[2] == LUT_SWEEP_LEVELS-1)
+			continue;
+		for(int t=0; t<6; t++)
+		{
+			//corner k+1 = corner k + one step along axis tetrahedra[t][k]
+			double edge[3][3];
+			double offset[3];
+			uint32_t corner = cell;
+			for(int c=0; c<3; c++)
+				offset[c] = target[c] - sweep[corner][c];
+			for(int k=0; k<3; k++)
+			{
+				uint32_t next = corner + stride[tetrahedra[t][k]];
+				for(int c=0; c<3; c++)
+					edge[k][c] = sweep[next][c] - sweep[corner][c];
+				corner = next;
+			}
+
+			//Cramer's rule: offset = w0*edge0 + w1*edge1 + w2*edge2
+			double det = edge[0][0]*(edge[1][1]*edge[2][2] - edge[1][2]*edge[2][1])
+					   - edge[1][0]*(edge[0][1]*edge[2][2] - edge[0][2]*edge[2][1])
+					   + edge[2][0]*(edge[0][1]*edge[1][2] - edge[0][2]*edge[1][1]);
+			if(fabs(det) < 1e-9)
+				continue;
+			double w[3];
+			w[0] = (offset[0]*(edge[1][1]*edge[2][2] - edge[1][2]*edge[2][1])
+				  - edge[1][0]*(offset[1]*edge[2][2] - offset[2]*edge[2][1])
+				  + edge[2][0]*(offset[1]*edge[1][2] - offset[2]*edge[1][1])) / det;
+			w[1] = (edge[0][0]*(offset[1]*edge[2][2] - offset[2]*edge[2][1])
+				  - offset[0]*(edge[0][1]*edge[2][2] - edge[0][2]*edge[2][1])
+				  + edge[2][0]*(edge[0][1]*offset[2] - edge[0][2]*offset[1])) / det;
+			w[2] = (edge[0][0]*(edge[1][1]*offset[2] - edge[1][2]*offset[1])
+				  - edge[1][0]*(edge[0][1]*offset[2] - edge[0][2]*offset[1])
+				  + offset[0]*(edge[0][1]*edge[1][2] - edge[0][2]*edge[1][1])) / det;
+
+			//inside the tetrahedron: 1 >= w0 >= w1 >= w2 >= 0
+			double inside[3];
+			inside[2] = clamp_weight(w[2], 0.0);
+			inside[1] = clamp_weight(w[1], inside[2]);
+			inside[0] = clamp_weight(w[0], inside[1]);
+			double distance = 0;
+			for(int c=0; c<3; c++)
+			{
+				double error = offset[c] - (inside[0]*edge[0][c] + inside[1]*edge[1][c] + inside[2]*edge[2][c]);
+				distance += error*error;
+			}
+			if(distance < best)
+			{
+				best = distance;
+				for(int k=0; k<3; k++)
+				{
+					int axis = tetrahedra[t][k];
+					drive[axis] = (base[axis] + w[k]) * LUT_SWEEP_STEP;
+				}
+			}
+		}
+	}
+
+	for(int c=0; c<3; c++)
+	{
+		long value = lround(drive[c] / (1 << LUT_DRIVE_SHIFT));
+		grid->drive[entry][c] = (value > INT16_MAX) ? INT16_MAX : ((value < INT16_MIN) ? INT16_MIN : value);
+	}
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Inverts the sweep into the table (double, once per characterization)
+  * @param LUT_GRID_t* grid
+  * @param const int32_t sweep[][3] R,G,B above ambient for the drives
+  * 	   0, LUT_SWEEP_STEP, ... LUT_MAX_DUTY of every channel, point (r*L + g)*L + b
+  * @return _Bool, false if a channel of the full LED is not measurable (grid not built)
+  */
+_Bool lut_gridBuild(LUT_GRID_t* grid, const int32_t sweep[LUT_SWEEP_POINTS][3])
+{
+	for(int c=0; c<3; c++)
+	{
+		if(sweep[LUT_SWEEP_POINTS-1][c] <= 0)
+			return false;
+		grid->white[c] = sweep[LUT_SWEEP_POINTS-1][c];
+	}
+	for(uint32_t entry=0; entry<LUT_GRID_ENTRIES; entry++)
+	{
+		const uint32_t index[3] = { entry / (LUT_GRID_SIZE * LUT_GRID_SIZE), (entry / LUT_GRID_SIZE) % LUT_GRID_SIZE, entry % LUT_GRID_SIZE };
+		double target[3];
+		for(int c=0; c<3; c++)
+			target[c] = (double)grid->white[c] * index[c] / (LUT_GRID_SIZE - 1);
+		build_entry(grid, sweep, entry, target);
+	}
+	return true;
+}
+/**
+  * @brief Finds the LED drive for a sensor color by tetrahedral interpolation
+  * 	   of the table (integer only, a few microseconds)
+  * @param const LUT_GRID_t* grid
+  * @param const int64_t* target R,G,B calibrated counts above ambient, uint32_t* duty R,G,B linear in Q8.8
+  * @return _Bool, false if the color is not reachable (duty is the nearest)
+  */
+_Bool lut_gridLookup(const LUT_GRID_t* grid, const int64_t* target, uint32_t* duty)
+{
+	const uint32_t stride[3] = { LUT_GRID_SIZE * LUT_GRID_SIZE, LUT_GRID_SIZE, 1 };
+	int32_t fraction[3]; //Q8
+	uint8_t order[3] = { 0, 1, 2 };
+	uint32_t entry = 0;
+	_Bool reachable = true;
+
+	for(int c=0; c<3; c++)
+	{
+		int64_t position = 0;
+		if(target[c] > 0)
+			position = ((target[c] * (LUT_GRID_SIZE - 1)) << 8) / grid->white[c];
+		if(position > ((LUT_GRID_SIZE - 1) << 8))
+		{
+			position = (LUT_GRID_SIZE - 1) << 8;
+			reachable = false;
+		}
+		uint32_t index = position >> 8;
+		if(index > LUT_GRID_SIZE - 2)
+			index = LUT_GRID_SIZE - 2;
+		fraction[c] = position - (index << 8);
+		entry += index * stride[c];
+	}
+
+	//walk from the base corner along the axes with the largest fraction first
+	for(int i=0; i<2; i++)
+	{
+		for(int j=0; j<2-i; j++)
+		{
+			if(fraction[order[j]] < fraction[order[j+1]])
+			{
+				uint8_t tmp = order[j];
+				order[j] = order[j+1];
+				order[j+1] = tmp;
+			}
+		}
+	}
+
+	int32_t weight = 256 - fraction[order[0]];
+	int32_t sum[3];
+	for(int c=0; c<3; c++)
+		sum[c] = weight * grid->drive[entry][c];
+	for(int k=0; k<3; k++)
+	{
+		entry += stride[order[k]];
+		weight = fraction[order[k]] - ((k < 2) ? fraction[order[k+1]] : 0);
+		for(int c=0; c<3; c++)
+			sum[c] += weight * grid->drive[entry][c];
+	}
+
+	//a drive the LED cannot reach means the color is outside of the gamut
+	for(int c=0; c<3; c++)
+	{
+		int32_t value = (sum[c] + (1 << (7 - LUT_DRIVE_SHIFT))) >> (8 - LUT_DRIVE_SHIFT);
+		if(value < 0 || value > LUT_MAX_DUTY)
+		{
+			value = (value < 0) ? 0 : LUT_MAX_DUTY;
+			reachable = false;
+		}
+		duty[c] = value;
+	}
+	return reachable;
+}
@@ -27,7 +27,14 @@
 #include "i2c_driver.h"
 #include "math.h"
 #include "uart.h"
+#include "printf.h"
+#include "log.h"
 #include "tasks.h"
+#include "calibration.h"
+#include "measurement.h"
+#include "filter.h"
+#include "animation.h"
+#include "colorlut.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -53,6 +60,8 @@ DMA_HandleTypeDef hdma_tim2_ch1;
 
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* Definitions for controllerTask */
 osThreadId_t controllerTaskHandle;
@@ -118,6 +127,10 @@ int main(void)
   MX_TIM2_Init();
   MX_USART1_UART_Init();
   /* USER CODE BEGIN 2 */
+    //Cycle counter for the WS2812 reset gap and execution time of the filter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
   	pwm_Init(&htim2, &hdma_tim2_ch1);
     i2c_Init(&hi2c1);
 
@@ -127,6 +140,19 @@ int main(void)
     //Start measuring
     if(!i2c_startUp())
   	  Error_Handler();
+    //Load color correction matrix from flash
+    calib_Init();
+    //Load LED characterization from flash
+    lut_Init();
+    //CRC unit for the binary link frames
+    link_Init();
+    //printf and link frames are sent with DMA from a ring
+    printf_Init();
+    //both register their uart commands
+    if(!filter_Init())
+  	  Error_Handler();
+    if(!measurement_Init())
+  	  Error_Handler();
 
   /* USER CODE END 2 */
 
@@ -143,6 +169,8 @@ int main(void)
 
   /* USER CODE BEGIN RTOS_TIMERS */
   /* start timers, add new ones, ... */
+  if(!animation_Init())
+	  Error_Handler();
   /* USER CODE END RTOS_TIMERS */
 
   /* USER CODE BEGIN RTOS_QUEUES */
@@ -163,6 +191,11 @@ int main(void)
   if(init_Tasks()==TASKS_ERROR)
 	  Error_Handler();
 
+  //binary log on USART2 (ST-Link VCP), decoded with Tools/log_decode.py
+  if(!log_Init())
+	  Error_Handler();
+  LOG_INFO(BOOT, 0);
+
   /* USER CODE END RTOS_THREADS */
 
   /* USER CODE BEGIN RTOS_EVENTS */
@@ -419,11 +452,18 @@ static void MX_DMA_Init(void)
 
   /* DMA controller clock enable */
   __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
 
   /* DMA interrupt init */
   /* DMA1_Channel5_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 5, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+  /* DMA2_Channel6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Channel6_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel6_IRQn);
+  /* DMA2_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Channel7_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel7_IRQn);
 
 }
 
@@ -492,38 +532,43 @@ void StartControllerTask(void *argument)
     colors.green = 0;
     colors.blue = 0;
 
-    pwm_SendValues(colors);
-
     uint32_t update_flags = 0;
-    struct MEASUREMENT_S values;
-    values.blue = 0;
-    values.green = 0;
-    values.red = 0;
-    values.clear = 0;
-    values.infrared = 0;
-
-    while(pwm_StartUpAnimation()==RUNNING)
-      {
-      	//Do Startup Animation
-      }
+    struct SAMPLE_S sample;
+    struct MEASUREMENT_S* values = &sample.compensated;
+    SAMPLE_REQUEST_t request;
+
+    //Startup animation plays in the background, commands are served right away
+    animation_Play(animation_StartUp, animation_StartUpLength, false);
   /* Infinite loop */
   for(;;)
   {
 	 update_flags = osEventFlagsWait(colorUpdateEventHandle,DONE_OR_NEW_COLOR,osFlagsNoClear,osWaitForever);
-	 if(update_flags == MEASUREMENT_DONE)
+	 if(update_flags & osFlagsError)
+		 update_flags = 0;
+	 if(update_flags & MEASUREMENT_DONE)
 	 {
 		 	osEventFlagsClear(colorUpdateEventHandle, MEASUREMENT_DONE);
-	  	if(osMessageQueueGet(MeasurementQueueHandle, &values, 0, osWaitForever)==osOK)
-	  		printf("MEA:%u,%u,%u,%u,%u\r\n",values.red,values.green,values.blue,values.infrared,values.clear);
-	  	else
-	  		printf("MEA:0,0,0,0,0\r\n");
+	  	if(osMessageQueueGet(MeasurementQueueHandle, &sample, 0, osWaitForever)==osOK)
+	  	{
+	  		//the newest sample answers every request queued so far, each with its id
+	  		while(osMessageQueueGet(MeasurementQueueHandle, &sample, 0, 0)==osOK);
+	  		while(osMessageQueueGet(requestQueueHandle, &request, 0, 0)==osOK)
+	  		{
+	  			//RAW: requests uncompensated values, MEA: compensated ones
+	  			values = (request.type == LINK_MSG_MEASURE_RAW) ? &sample.raw : &sample.compensated;
+	  			if(request.binary)
+	  				uart_sendSample(request.type | LINK_MSG_REPLY, request.id, values, sample.time);
+	  			else
+	  				printf("%s:%lu,%lu,%lu,%lu,%lu\r\n",(values == &sample.raw) ? "RAW" : "MEA",values->red,values->green,values->blue,values->infrared,values->clear);
+	  		}
+	  	}
 	 }
-	 else if(update_flags == NEW_COLOR)
+	 else if(update_flags & NEW_COLOR)
 	 {
 		 osEventFlagsClear(colorUpdateEventHandle, NEW_COLOR);
 		 if(osMessageQueueGet(colorUpdateQueueHandle, &colors, 0, osWaitForever)==osOK)
 		 {
-			 pwm_SendValues(colors);
+			 animation_SetColor(colors); //fades, also ends the startup animation
 		 }
 	 }
 	 osDelay(10);
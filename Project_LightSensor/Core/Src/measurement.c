@@ -0,0 +1,394 @@
+/**
+  ******************************************************************************
+  * @file    measurement.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Continuous acquisition of the VEML3328 with named profiles, including
+  * 		 the HDR mode that fuses a high and a low sensitivity integration into one sample.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "measurement.h"
+#include "i2c_driver.h"
+#include "calibration.h"
+#include "filter.h"
+#include "command.h"
+#include "clock_sync.h"
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define MEAS_CHANNELS 5 //R,G,B,C,IR
+#define MEAS_HDR_BLEND_RANGE (MEAS_HDR_SATURATION - MEAS_HDR_KNEE)
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	HDR_PHASE_HIGH = 0,
+	HDR_PHASE_LOW = 1
+}HDR_PHASE_t;
+
+typedef struct ProfileStatistics
+{
+	uint32_t samples;
+	uint32_t ticks; //time the profile was active, without the running period
+	uint32_t skipped; //integrations never read, the task was delayed
+}PROFILE_STATS_t;
+
+/* Globals -------------------------------------------------------------------*/
+static const MEAS_PROFILE_t profiles[MEAS_PROFILE_COUNT] = {
+	//name				integration	all channels	mode				rate (mHz)	latency (ms)
+	{ "default",		100,		true,			MEAS_MODE_SINGLE,	10000,		100 },
+	{ "fast-lux",		50,			false,			MEAS_MODE_SINGLE,	20000,		50 },
+	{ "accurate-color",	400,		true,			MEAS_MODE_SINGLE,	2500,		400 },
+	{ "hdr",			100,		true,			MEAS_MODE_HDR,		4270,		234 } //2 x (integration + settle margin + I2C)
+};
+
+static volatile uint8_t requestedProfile = MEAS_PROFILE_DEFAULT;
+static uint8_t activeProfile = MEAS_PROFILE_DEFAULT;
+static PROFILE_STATS_t statistics[MEAS_PROFILE_COUNT];
+static uint32_t profileStartTick = 0;
+
+static HDR_PHASE_t hdrPhase = HDR_PHASE_HIGH;
+static uint16_t configHigh;
+static uint16_t configLow;
+static uint32_t sensitivityRatio; //Q8, high/low
+
+static uint16_t highChannels[MEAS_CHANNELS];
+static uint32_t nextTick = 0;
+
+static struct SAMPLE_S latest;
+static uint32_t sampleCount = 0;
+static uint32_t sampleCycle = 0; //DWT cycle at the end of the integration of latest
+static uint32_t sampleStartCycle = 0; //DWT cycle at the start of the integration of latest
+static uint32_t triggerCycle = 0; //DWT cycle when the high sensitivity integration was triggered
+
+/* Private Functions ---------------------------------------------------------*/
+static void read_channels(uint16_t* channels)
+{
+	//red and blue are not measured with I2C_CFG_MEAS_G_C_IR_ONLY, skip the transfer
+	_Bool allChannels = profiles[activeProfile].allChannels;
+	channels[0] = allChannels ? i2c_getRed() : 0;
+	channels[1] = i2c_getGreen();
+	channels[2] = allChannels ? i2c_getBlue() : 0;
+	channels[3] = i2c_getClear();
+	channels[4] = i2c_getIR();
+}
+static uint16_t profile_config(const MEAS_PROFILE_t* profile)
+{
+	uint16_t config = i2c_getDefaultConfig() & ~(I2C_CFG_INTEGRATION_TIME_400MS | I2C_CFG_MEAS_G_C_IR_ONLY);
+	config |= profile->allChannels ? I2C_CFG_MEAS_ALL_CHANNELS : I2C_CFG_MEAS_G_C_IR_ONLY;
+	for(uint16_t time = 50; time < profile->integrationTime; time <<= 1)
+		config += I2C_CFG_INTEGRATION_TIME_100MS; //one step doubles the integration time
+	return config;
+}
+/*
+ * Time until a triggered integration (or the first one after a
+ * configuration change) is complete, with margin for the sensor oscillator
+ */
+static uint32_t settle_time(void)
+{
+	uint32_t integration = i2c_getIntegrationTime();
+	return integration + (integration / 8) + 2;
+}
+/*
+ * Picks the high sensitivity value while it is well below saturation, the
+ * scaled low sensitivity value once it saturates and blends linearly in between,
+ * so a channel crossing the knee has no step. Low values in the noise floor
+ * never take part in the blend.
+ */
+static uint32_t fuse_channel(uint16_t high, uint16_t low)
+{
+	uint32_t scaledLow = ((uint32_t)low * sensitivityRatio) >> MEAS_HDR_RATIO_BITS;
+
+	if(high >= MEAS_HDR_SATURATION)
+		return scaledLow;
+	if(high < MEAS_HDR_KNEE || low < MEAS_HDR_NOISE_FLOOR)
+		return high;
+
+	uint32_t weight = high - MEAS_HDR_KNEE;
+	return (uint32_t)(((uint64_t)high * (MEAS_HDR_BLEND_RANGE - weight) + (uint64_t)scaledLow * weight) / MEAS_HDR_BLEND_RANGE);
+}
+/*
+ * (Re)starts the continuous measurement of the active profile
+ */
+static void start_integration(void)
+{
+	const MEAS_PROFILE_t* profile = &profiles[activeProfile];
+
+	hdrPhase = HDR_PHASE_HIGH;
+	if(profile->mode == MEAS_MODE_HDR)
+	{
+		//triggered integrations, so every reading belongs to a known configuration
+		configHigh = profile_config(profile) | I2C_CFG_MODE_MANUAL | I2C_CFG_TRIGGER_ONCE;
+		configLow = configHigh | I2C_CFG_GAIN1_HALF | I2C_CFG_HDR_THIRD;
+		sensitivityRatio = ((uint32_t)i2c_getSensitivity(configHigh) << MEAS_HDR_RATIO_BITS) / i2c_getSensitivity(configLow);
+		triggerCycle = DWT->CYCCNT;
+		i2c_setConfig(configHigh); //also triggers the first integration
+	}
+	else
+		i2c_setConfig(profile_config(profile));
+	calib_setSensitivity(i2c_getSensitivity(profile_config(profile))); //dark offset of this profile
+	nextTick = osKernelGetTickCount() + settle_time();
+}
+static void start_profile(uint8_t index)
+{
+	uint32_t now = osKernelGetTickCount();
+
+	statistics[activeProfile].ticks += now - profileStartTick;
+	profileStartTick = now;
+	activeProfile = index;
+	filter_reset(); //window would mix both profiles
+	start_integration();
+}
+/*
+ * PRF:name switches the measurement profile, every PRF: reports all profiles
+ */
+static void command_profile(const COMMAND_t* command)
+{
+	int index = measurement_findProfile(command->text);
+	if(index >= 0)
+		measurement_setProfile(index);
+	osEventFlagsSet(colorUpdateEventHandle,PROFILE_REPORT);
+}
+
+static const COMMAND_ENTRY_t profileCommand = { "PRF", 0, { COMMAND_ARGS_TEXT, 0, 0, 0 }, command_profile };
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Starts the default profile and registers PRF:, call after i2c_startUp
+  * @param None
+  * @return _Bool, false if the command could not be registered
+  */
+_Bool measurement_Init(void)
+{
+	memset(statistics, 0, sizeof(statistics));
+	requestedProfile = MEAS_PROFILE_DEFAULT;
+	activeProfile = MEAS_PROFILE_DEFAULT;
+	profileStartTick = osKernelGetTickCount();
+	start_profile(MEAS_PROFILE_DEFAULT);
+	sampleCount = 0;
+	return (command_register(&profileCommand) == COMMAND_OK);
+}
+/**
+  * @brief Requests another profile, applied by the measurement task on its next
+  * 	   acquisition (safe to call from the uart callback)
+  * @param uint8_t index into the profile table, ignored if out of range
+  * @return None
+  */
+void measurement_setProfile(uint8_t index)
+{
+	if(index < MEAS_PROFILE_COUNT)
+		requestedProfile = index;
+}
+/**
+  * @brief Looks up a profile by name
+  * @param const char* name, may be followed by "\r\n"
+  * @return int index, -1 if there is no profile with this name
+  */
+int measurement_findProfile(const char* name)
+{
+	for(int i=0; i<MEAS_PROFILE_COUNT; i++)
+	{
+		size_t length = strlen(profiles[i].name);
+		if(strncmp(name, profiles[i].name, length)==0 && (name[length]=='\0' || name[length]=='\r' || name[length]=='\n'))
+			return i;
+	}
+	return -1;
+}
+/**
+  * @brief Index of the active profile
+  * @param None
+  * @return uint8_t
+  */
+uint8_t measurement_getProfileIndex(void)
+{
+	return activeProfile;
+}
+/**
+  * @brief Profile table entry
+  * @param uint8_t index
+  * @return const MEAS_PROFILE_t*, NULL if out of range
+  */
+const MEAS_PROFILE_t* measurement_getProfile(uint8_t index)
+{
+	return (index < MEAS_PROFILE_COUNT) ? &profiles[index] : NULL;
+}
+/**
+  * @brief Achieved sample rate of a profile over all periods it was active,
+  * 	   to compare with the expected rate of the table
+  * @param uint8_t index
+  * @return uint32_t samples per 1000s (mHz), 0 if never active
+  */
+uint32_t measurement_getAchievedRate(uint8_t index)
+{
+	if(index >= MEAS_PROFILE_COUNT)
+		return 0;
+	uint32_t ticks = statistics[index].ticks;
+	if(index == activeProfile)
+		ticks += osKernelGetTickCount() - profileStartTick;
+	if(ticks == 0)
+		return 0;
+	return (uint32_t)(((uint64_t)statistics[index].samples * 1000 * osKernelGetTickFreq()) / ticks);
+}
+/**
+  * @brief Integrations of a profile that were never read because the
+  * 	   measurement task was delayed (long command, flash write)
+  * @param uint8_t index
+  * @return uint32_t periods, 0 if out of range
+  */
+uint32_t measurement_getSkipped(uint8_t index)
+{
+	return (index < MEAS_PROFILE_COUNT) ? statistics[index].skipped : 0;
+}
+/**
+  * @brief Switches to the requested profile if it differs from the active one,
+  * 	   done by measurement_acquire as well
+  * @param None
+  * @return _Bool, true if the profile was changed
+  */
+_Bool measurement_applyProfile(void)
+{
+	if(requestedProfile == activeProfile)
+		return false;
+	start_profile(requestedProfile);
+	return true;
+}
+/**
+  * @brief Ticks until the next reading of the sensor is due
+  * @param None
+  * @return uint32_t ticks, 0 if measurement_acquire should be called now
+  */
+uint32_t measurement_getTimeout(void)
+{
+	int32_t remaining = (int32_t)(nextTick - osKernelGetTickCount());
+	return (remaining > 0) ? (uint32_t)remaining : 0;
+}
+/**
+  * @brief Reads the sensor and schedules the next reading. In HDR mode every
+  * 	   second call completes a fused sample. Complete samples are compensated,
+  * 	   corrected with the calibration and filtered (raw values stay unfiltered).
+  * @param None
+  * @return _Bool, true if a new sample is available
+  */
+_Bool measurement_acquire(void)
+{
+	uint16_t channels[MEAS_CHANNELS];
+	struct MEASUREMENT_S* raw = &latest.raw;
+
+	if(measurement_applyProfile())
+		return false;
+
+	read_channels(channels);
+	if(profiles[activeProfile].mode == MEAS_MODE_HDR)
+	{
+		if(hdrPhase == HDR_PHASE_HIGH)
+		{
+			memcpy(highChannels, channels, sizeof(highChannels));
+			hdrPhase = HDR_PHASE_LOW;
+			i2c_setConfig(configLow);
+			nextTick = osKernelGetTickCount() + settle_time();
+			return false;
+		}
+		raw->red = fuse_channel(highChannels[0], channels[0]);
+		raw->green = fuse_channel(highChannels[1], channels[1]);
+		raw->blue = fuse_channel(highChannels[2], channels[2]);
+		raw->clear = fuse_channel(highChannels[3], channels[3]);
+		raw->infrared = fuse_channel(highChannels[4], channels[4]);
+		hdrPhase = HDR_PHASE_HIGH;
+		sampleStartCycle = triggerCycle; //fused sample covers both integrations
+		triggerCycle = DWT->CYCCNT;
+		i2c_setConfig(configHigh);
+		nextTick = osKernelGetTickCount() + settle_time();
+	}
+	else
+	{
+		raw->red = channels[0];
+		raw->green = channels[1];
+		raw->blue = channels[2];
+		raw->clear = channels[3];
+		raw->infrared = channels[4];
+		nextTick += i2c_getIntegrationTime(); //sensor integrates continuously in auto mode
+		uint32_t now = osKernelGetTickCount();
+		if((int32_t)(nextTick - now) < 0)
+		{
+			//delayed: catching up would read the same integration back to back
+			statistics[activeProfile].skipped += (now - nextTick) / i2c_getIntegrationTime() + 1;
+			nextTick = now + i2c_getIntegrationTime();
+		}
+	}
+
+	//read settle_time after the start, so the integration ended the margin before
+	sampleCycle = DWT->CYCCNT - (settle_time() - i2c_getIntegrationTime()) * (SystemCoreClock / 1000);
+	if(profiles[activeProfile].mode != MEAS_MODE_HDR)
+		sampleStartCycle = sampleCycle - i2c_getIntegrationTime() * (SystemCoreClock / 1000);
+	//the sample is stamped with the middle of its integration window
+	latest.time = clock_micros() - (DWT->CYCCNT - sampleStartCycle - (sampleCycle - sampleStartCycle) / 2) / (SystemCoreClock / 1000000);
+	calib_compensate(&latest.raw, &latest.compensated);
+	calib_apply(&latest.compensated);
+	filter_process(&latest.compensated);
+	statistics[activeProfile].samples++;
+	sampleCount++;
+	return true;
+}
+/**
+  * @brief Copies the most recent complete sample
+  * @param struct SAMPLE_S* sample
+  * @return _Bool, false if no sample was completed yet
+  */
+_Bool measurement_getLatest(struct SAMPLE_S* sample)
+{
+	if(sampleCount == 0)
+		return false;
+	*sample = latest;
+	return true;
+}
+/**
+  * @brief Blocks until the next complete sample, for calibration which must not
+  * 	   use a sample taken before the command
+  * @param struct SAMPLE_S* sample
+  * @return None
+  */
+void measurement_waitNext(struct SAMPLE_S* sample)
+{
+	uint32_t count = sampleCount;
+	while(sampleCount == count)
+	{
+		osDelay(measurement_getTimeout());
+		measurement_acquire();
+	}
+	*sample = latest;
+}
+/**
+  * @brief DWT cycle counter at the end of the integration of the latest sample
+  * 	   (estimated from the reading time and the settle margin)
+  * @param None
+  * @return uint32_t cycles
+  */
+uint32_t measurement_getSampleCycle(void)
+{
+	return sampleCycle;
+}
+/**
+  * @brief Triggers one integration with the (high sensitivity) configuration of
+  * 	   the active profile and reads it. The integration starts with this call,
+  * 	   so it is aligned to a light change right before. Continuous reading
+  * 	   restarts afterwards, the sample is not filtered and not counted.
+  * 	   Blocks for one integration time plus margin.
+  * @param struct MEASUREMENT_S* raw
+  * @return None
+  */
+void measurement_trigger(struct MEASUREMENT_S* raw)
+{
+	uint16_t channels[MEAS_CHANNELS];
+
+	measurement_applyProfile();
+	i2c_setConfig(profile_config(&profiles[activeProfile]) | I2C_CFG_MODE_MANUAL | I2C_CFG_TRIGGER_ONCE);
+	osDelay(settle_time());
+	read_channels(channels);
+	raw->red = channels[0];
+	raw->green = channels[1];
+	raw->blue = channels[2];
+	raw->clear = channels[3];
+	raw->infrared = channels[4];
+	start_integration();
+}
@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    mirror.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Mirror mode: every new sample is shown on the LED without a round
+  * 		 trip over the link.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "mirror.h"
+#include "measurement.h"
+#include "animation.h"
+#include "gamma.h"
+
+/* Globals -------------------------------------------------------------------*/
+static volatile _Bool requestedEnabled = false;
+static _Bool enabled = false;
+
+static _Bool pending = false; //latest color was not shown yet
+static uint32_t setCycle = 0;
+static uint32_t integrationEnd = 0;
+
+static uint32_t latency = 0; //us
+static uint32_t maxLatency = 0;
+static uint32_t count = 0;
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Value relative to clear as 16 bit perceptual channel, the same scaling as
+ * "value*255/clear" on the display
+ */
+static uint16_t normalize(uint32_t value, uint32_t clear)
+{
+	uint64_t scaled = ((uint64_t)value * 0xFFFF) / clear;
+	return (scaled > 0xFFFF) ? 0xFFFF : (uint16_t)scaled;
+}
+/*
+ * Latency from the end of the integration until the color went out, once the
+ * animation timer has sent it
+ */
+static void update_latency(void)
+{
+	if(!pending)
+		return;
+	uint32_t shown = animation_GetShownCycle();
+	if((shown - setCycle) > (DWT->CYCCNT - setCycle))
+		return; //last new color went out before the mirrored one
+	latency = (shown - integrationEnd) / (SystemCoreClock / 1000000);
+	if(latency > maxLatency)
+		maxLatency = latency;
+	pending = false;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Requests mirror mode on or off, applied with the next sample (safe to
+  * 	   call from the uart callback)
+  * @param _Bool enable
+  * @return None
+  */
+void mirror_setEnabled(_Bool enable)
+{
+	requestedEnabled = enable;
+}
+/**
+  * @brief Applies the requested mode, statistics start over, the LED fades off
+  * 	   when mirroring stops
+  * @param None
+  * @return _Bool, true if the mode was changed
+  */
+_Bool mirror_apply(void)
+{
+	_Bool request = requestedEnabled;
+	if(request == enabled)
+		return false;
+	enabled = request;
+	pending = false;
+	latency = 0;
+	maxLatency = 0;
+	count = 0;
+	if(!enabled)
+		animation_SetColor((RGB_t){ 0, 0, 0 });
+	return true;
+}
+/**
+  * @brief Returns if mirror mode is active
+  * @param None
+  * @return _Bool
+  */
+_Bool mirror_isEnabled(void)
+{
+	return enabled;
+}
+/**
+  * @brief Shows a new sample on the LED: compensated (and filtered) values are
+  * 	   normalized to clear and set without fade, the animation timer applies
+  * 	   gamma and dithering with its next frame (2 ms). Call for every new sample.
+  * @param const struct SAMPLE_S* sample
+  * @return None
+  */
+void mirror_update(const struct SAMPLE_S* sample)
+{
+	RGB16_t color = { 0, 0, 0 };
+	const struct MEASUREMENT_S* values = &sample->compensated;
+
+	mirror_apply();
+	update_latency();
+	if(!enabled)
+		return;
+
+	if(values->clear > 0)
+	{
+		color.red = normalize(values->red, values->clear);
+		color.green = normalize(values->green, values->clear);
+		color.blue = normalize(values->blue, values->clear);
+	}
+	animation_SetColor16(color);
+	setCycle = DWT->CYCCNT;
+	integrationEnd = measurement_getSampleCycle();
+	pending = true;
+	count++;
+}
+/**
+  * @brief Latency of the last mirrored sample, from the end of its integration
+  * 	   until the LED frame was started
+  * @param None
+  * @return uint32_t us
+  */
+uint32_t mirror_getLatency(void)
+{
+	update_latency();
+	return latency;
+}
+/**
+  * @brief Highest latency since mirror mode was enabled
+  * @param None
+  * @return uint32_t us
+  */
+uint32_t mirror_getMaxLatency(void)
+{
+	update_latency();
+	return maxLatency;
+}
+/**
+  * @brief Mirrored samples since mirror mode was enabled
+  * @param None
+  * @return uint32_t
+  */
+uint32_t mirror_getCount(void)
+{
+	return count;
+}
@@ -5,14 +5,206 @@
   * @date 	 29.04.2024
   * @brief   Provides traditional printf() functionality
   *
+  * 		 Output goes into a ring that the DMA sends in the background,
+  * 		 one transfer per contiguous part, the next one is chained in the
+  * 		 transfer complete callback. Writing only copies into the ring.
+  *
+  * 		 The ring itself is tx_ring.c (Common), this file locks it and
+  * 		 drives the DMA.
+  *
+  * 		 Gated (polled radio channel, link_schedule.h) only the bytes up to
+  * 		 the end of the last printf_writeLast go out, everything written
+  * 		 before leaves in one burst in the turn of the board.
+  *
   ******************************************************************************
   */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "printf.h"
+#include "cmsis_os.h"
+#include "log.h"
+#include "tx_ring.h"
+#include <stdbool.h>
+
+/* Globals -------------------------------------------------------------------*/
+static TX_RING_t ring = { .policy = TX_OVERFLOW_POLICY }; //printf may run before printf_Init
+
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Starts the DMA with the next part of the ring (interrupts off or from the
+ * callback)
+ */
+static void start_transfer(void)
+{
+	const uint8_t* data;
+	uint16_t length = tx_ringNext(&ring, &data);
+
+	if(length > 0 && HAL_UART_Transmit_DMA(&huart1, (uint8_t*)data, length) == HAL_OK)
+		tx_ringStarted(&ring, length);
+}
+static void tx_complete_callback(UART_HandleTypeDef *huart)
+{
+	tx_ringSent(&ring);
+	start_transfer();
+}
+static _Bool can_block(void)
+{
+	return __get_IPSR() == 0 && osKernelGetState() == osKernelRunning;
+}
+
+/*
+ * Copies data into the ring, release moves the gate behind it
+ */
+static int queue(const uint8_t* data, uint16_t length, _Bool release)
+{
+	uint32_t primask;
+
+	if(length == 0)
+		return 0;
+
+	for(;;)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		if(tx_ringReserve(&ring, length))
+			break;
+		__set_PRIMASK(primask);
+		//gated the ring only empties in the own turn, waiting would block the task for a whole cycle
+		if(ring.policy != TX_OVERFLOW_BLOCK || length > TX_RING_SIZE || !can_block() || ring.gated)
+		{
+			ring.dropped++;
+			LOG_WARN(TX_DROPPED, length);
+			return 0;
+		}
+		osDelay(1);
+	}
+
+	tx_ringPut(&ring, data, length, release);
+	start_transfer();
+	__set_PRIMASK(primask);
+	return length;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Registers the transfer complete callback, call after MX_USART1_UART_Init
+  * @param None
+  * @retval None
+  */
+void printf_Init(void)
+{
+	HAL_UART_RegisterCallback(&huart1, HAL_UART_TX_COMPLETE_CB_ID, tx_complete_callback);
+}
+
+/**
+  * @brief Queues data for sending, never splits it: a message is sent
+  * 	   completely or not at all (binary frames stay intact)
+  * @param const uint8_t* data
+  * @param uint16_t length
+  * @return int length, 0 if dropped
+  */
+int printf_write(const uint8_t* data, uint16_t length)
+{
+	return queue(data, length, false);
+}
+
+/**
+  * @brief Queues data like printf_write and releases everything queued up to
+  * 	   its end at once (gated mode), e.g. the frame that ends the turn
+  * @param const uint8_t* data
+  * @param uint16_t length
+  * @return int length, 0 if dropped (what was queued before is released anyway)
+  */
+int printf_writeLast(const uint8_t* data, uint16_t length)
+{
+	uint32_t primask;
+	int written = queue(data, length, true);
+
+	if(written == 0)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		tx_ringRelease(&ring);
+		start_transfer();
+		__set_PRIMASK(primask);
+	}
+	return written;
+}
+
+/**
+  * @brief Gated only what printf_writeLast released is sent, the rest waits.
+  * 	   Gating starts with everything queued so far released, ungating sends
+  * 	   the rest.
+  * @param _Bool gated
+  * @return None
+  */
+void printf_setGated(_Bool gated)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	tx_ringSetGated(&ring, gated);
+	start_transfer();
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief Bytes that leave before the next one written, once released: the
+  * 	   queued ones and the rest of the running transfer
+  * @param None
+  * @return uint32_t
+  */
+uint32_t printf_getPending(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t pending = ring.head - ring.tail;
+	if(ring.sending > 0)
+		pending += __HAL_DMA_GET_COUNTER(huart1.hdmatx);
+	__set_PRIMASK(primask);
+	return pending;
+}
+
+/**
+  * @brief Selects what happens when the ring is full
+  * @param TX_OVERFLOW_t overflow
+  * @retval None
+  */
+void printf_setOverflowPolicy(TX_OVERFLOW_t overflow)
+{
+	ring.policy = overflow;
+}
+
+/**
+  * @brief Messages discarded because the ring was full (new ones dropped and
+  * 	   old ones overwritten)
+  * @param None
+  * @return uint32_t
+  */
+uint32_t printf_getDropped(void)
+{
+	return ring.dropped;
+}
 
 /* prototype -----------------------------------------------------------------*/
 PUTCHAR_PROTOTYPE {
-	HAL_UART_Transmit(&huart1, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
+	uint8_t byte = ch;
+	printf_write(&byte, 1);
 	return ch;
 }
+
+/**
+  * @brief Replaces the weak _write of syscalls.c, printf hands over whole lines
+  */
+int _write(int file, char *ptr, int len)
+{
+	(void)file;
+	int written = 0;
+	//longer than the ring: in parts, so printf never loses everything
+	while(len - written > TX_RING_SIZE)
+	{
+		printf_write((uint8_t*)&ptr[written], TX_RING_SIZE);
+		written += TX_RING_SIZE;
+	}
+	printf_write((uint8_t*)&ptr[written], len - written);
+	return len;
+}
@@ -3,13 +3,19 @@
   * @file    pwm_driver.c
   * @author  Mathias Bohle
   * @date 	 05.12.2023
-  * @brief   Controls PWM generation for controlling WS2812 RGB LED
+  * @brief   Controls PWM generation for controlling a chain of WS2812 RGB LEDs
   *
   ******************************************************************************
   */
 
 /* Includes ------------------------------------------------------------------*/
 #include <pwm_driver.h>
+#include <pwm_encode.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define PWM_BITS_PER_LED 24
+#define PWM_HALF_LENGTH (PWM_LEDS_PER_HALF * PWM_BITS_PER_LED)
 
 /* Globals -------------------------------------------------------------------*/
 static _Bool isInitiated = false;
@@ -18,7 +24,59 @@ static volatile _Bool isRunning = false;
 static TIM_HandleTypeDef* htim_local = NULL;
 static DMA_HandleTypeDef* hdma_local = NULL;
 
-static uint32_t pwmData[(240+24+240)]; //delay + color values + delay
+static const uint8_t encodeTable[256][8] __attribute__((aligned(4))) = PWM_ENCODE_TABLE;
+
+static RGB_t pixels[PWM_LED_COUNT];
+//circular, one half is refilled while the other one is sent. DMA widens each byte to the 32 bit CCR1
+static uint8_t pwmData[2 * PWM_HALF_LENGTH] __attribute__((aligned(4)));
+
+static uint16_t nextPixel = 0;
+static uint8_t idleHalves = 0;
+static uint32_t resetStart = 0; //DWT cycle count when the line went idle
+static uint32_t resetCycles = 0;
+
+/* Private Functions ---------------------------------------------------------*/
+static void encode_pixel(uint8_t* data, RGB_t color)
+{
+	//Format color values, GRB and MSB first, one table lookup per byte
+	memcpy(&data[0], encodeTable[color.green], 8);
+	memcpy(&data[8], encodeTable[color.red], 8);
+	memcpy(&data[16], encodeTable[color.blue], 8);
+}
+/*
+ * Encodes the next pixels of the frame into one half of the DMA buffer,
+ * slots behind the last pixel are 0 (line stays low)
+ */
+static void encode_half(uint8_t* half)
+{
+	if(nextPixel >= PWM_LED_COUNT)
+		idleHalves++;
+	for(int led=0; led<PWM_LEDS_PER_HALF; led++)
+	{
+		if(nextPixel < PWM_LED_COUNT)
+			encode_pixel(half, pixels[nextPixel++]);
+		else
+			memset(half, 0, PWM_BITS_PER_LED * sizeof(half[0]));
+		half += PWM_BITS_PER_LED;
+	}
+}
+/*
+ * Called from the DMA interrupts after one half was sent. Once a complete
+ * half of zeros went out behind the last pixel the timer is stopped, the
+ * reset gap then comes from the idle (low) output instead of zero words.
+ */
+static void refill_half(uint8_t* half)
+{
+	if(idleHalves >= 2)
+	{
+		HAL_TIM_PWM_Stop_DMA(htim_local, TIM_CHANNEL_1);
+		__HAL_TIM_SET_COMPARE(htim_local, TIM_CHANNEL_1, 0);
+		resetStart = DWT->CYCCNT;
+		isRunning = false;
+		return;
+	}
+	encode_half(half);
+}
 
 /* Functions -----------------------------------------------------------------*/
 /**
@@ -28,140 +86,110 @@ static uint32_t pwmData[(240+24+240)]; //delay + color values + delay
   */
 void pwm_Init(TIM_HandleTypeDef* htim, DMA_HandleTypeDef* hdma)
 {
-	//TIM1, DMA, PSC 1, Counter Period 40 (0-39),
-	//DMA1, Memory to Peripheral, Normal, Half Word -> Half Word, Increment Memory Adress, TIM2 Channel 1
-	//Priority Low
+	//TIM2, DMA, PSC 0, Counter Period 40 (0-39),
+	//DMA1, Memory to Peripheral, Circular, Byte -> Word, Increment Memory Adress, TIM2 Channel 1
+	//Priority Low, DWT cycle counter has to run for the reset gap
 	htim_local = htim;
 	hdma_local = hdma;
+	resetCycles = (SystemCoreClock / 1000000) * PWM_RESET_US;
+	resetStart = DWT->CYCCNT - resetCycles;
+	memset(pixels, 0, sizeof(pixels));
 	isInitiated = true;
 }
 /**
-  * @brief Sends values for single WS2812 RGB LED
-  * @param RGB colors (with brightness for all 3 colors)
-  * @return Current state of timer controlled send
+  * @brief Sets the color of one LED in the chain, sent with the next pwm_Show
+  * @param uint16_t index (0 is the LED next to the controller), RGB_t color
+  * @return None
   */
-PWM_STATE_t pwm_SendValues(RGB_t colors)
+void pwm_SetPixel(uint16_t index, RGB_t color)
 {
-	if(isInitiated)
-	{
-		if(!isRunning)
-		{
-			uint16_t index = 0;
-			uint32_t color = ((((uint8_t)colors.green)<<16) | (((uint8_t)colors.red)<<8) | (((uint8_t)colors.blue)));
-
-			for(int i=0;i<240;i++) //Pull down DO for about 280us
-			{
-				pwmData[index] = 0;
-				index++;
-			}
-			for(int i=23; i>=0; i--) //Format color values
-			{
-				if(color&(1<<i))
-				{
-					pwmData[index] = 29; //0,9 us (29/40) "1"
-				}
-				else
-				{
-					pwmData[index] = 11; //0,35 us (11/40) "0"
-				}
-				index++;
-			}
-			for(int i=0;i<240;i++) //Pull down DO for about 280us
-			{
-				pwmData[index] = 0;
-				index++;
-			}
-			if(HAL_TIM_PWM_Start_DMA(htim_local, TIM_CHANNEL_1, (uint32_t*)pwmData, sizeof(pwmData)/sizeof(pwmData[0]))!=HAL_OK) //start transmission to RGB LED
-			{
-				return PROBLEM;
-			}
-			else
-			{
-				isRunning = true;
-				return RUNNING;
-			}
-		}
-		else return STOPPED;
-
-	}
-	else
-		return PROBLEM;
+	if(index < PWM_LED_COUNT)
+		pixels[index] = color;
 }
 /**
-  * @brief Transitions through all RGB colors in nice animation
+  * @brief Starts sending the whole chain. Pixels are encoded on the fly into
+  * 	   the circular DMA buffer, so RAM use does not depend on the chain length.
   * @param None
-  * @return PWM_STATE current state of timer while sending colors
+  * @return Current state of timer controlled send, STOPPED if a frame is still being sent
   */
-PWM_STATE_t pwm_StartUpAnimation(void)
+PWM_STATE_t pwm_Show(void)
 {
-	static RGB_t animation_Colors;
-	uint16_t speed = 15;
-	uint8_t brightness = 30;
-	if(animation_Colors.red<brightness && animation_Colors.green == 0 && animation_Colors.blue == 0) //R
-	{
-		animation_Colors.red++;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.green<brightness && animation_Colors.red == brightness && animation_Colors.blue == 0) //RG
-	{
-		animation_Colors.green++;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.red>0 && animation_Colors.green == brightness && animation_Colors.blue == 0) //G
-	{
-		animation_Colors.red--;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.blue<brightness && animation_Colors.green == brightness && animation_Colors.red == 0) //GB
-	{
-		animation_Colors.blue++;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.green>0 && animation_Colors.blue == brightness && animation_Colors.red == 0) //B
-	{
-		animation_Colors.green--;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.red<brightness && animation_Colors.green == 0 && animation_Colors.blue == brightness) //RB
-	{
-		animation_Colors.red++;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.green<brightness && animation_Colors.red == brightness && animation_Colors.blue == brightness) //RGB
-	{
-		animation_Colors.green++;
-		HAL_Delay(speed);
-	}
-	else if(animation_Colors.red>0) //0
+	if(!isInitiated)
+		return PROBLEM;
+	if(isRunning)
+		return STOPPED;
+
+	//Wait for the rest of the reset gap (at most PWM_RESET_US)
+	while((DWT->CYCCNT - resetStart) < resetCycles)
 	{
-		animation_Colors.red--;
-		animation_Colors.green--;
-		animation_Colors.blue--;
-		HAL_Delay(speed);
-		if(animation_Colors.red == 1 && animation_Colors.green == 1 && animation_Colors.blue == 1)
-		{
-			animation_Colors.red = 0;
-			animation_Colors.green = 0;
-			animation_Colors.blue = 0;
-			pwm_SendValues(animation_Colors);
-			return STOPPED;
-		}
+		;
 	}
-	while(pwm_SendValues(animation_Colors)==RUNNING)
+
+	nextPixel = 0;
+	idleHalves = 0;
+	encode_half(&pwmData[0]);
+	encode_half(&pwmData[PWM_HALF_LENGTH]);
+
+	isRunning = true;
+	if(HAL_TIM_PWM_Start_DMA(htim_local, TIM_CHANNEL_1, (uint32_t*)pwmData, sizeof(pwmData)/sizeof(pwmData[0]))!=HAL_OK) //start transmission to RGB LED
 	{
-		;
+		isRunning = false;
+		return PROBLEM;
 	}
 	return RUNNING;
-
 }
-
 /**
-  * @brief Stops the timer controlled DMA when finished
+  * @brief Checks if a frame is still being sent
+  * @param None
+  * @return _Bool, true while the DMA is running
+  */
+_Bool pwm_IsBusy(void)
+{
+	return isRunning;
+}
+/**
+  * @brief DWT cycle count when the chain has taken over the last frame: DMA
+  * 	   completion (timestamped in the transfer complete callback) plus the
+  * 	   reset gap, may lie up to PWM_RESET_US in the future
+  * @param None
+  * @return uint32_t cycles, only valid while pwm_IsBusy is false
+  */
+uint32_t pwm_GetLatchCycle(void)
+{
+	return resetStart + resetCycles;
+}
+/**
+  * @brief Sends the same values to every WS2812 RGB LED of the chain
+  * @param RGB colors (with brightness for all 3 colors)
+  * @return Current state of timer controlled send
+  */
+PWM_STATE_t pwm_SendValues(RGB_t colors)
+{
+	if(!isInitiated)
+		return PROBLEM;
+	if(isRunning)
+		return STOPPED;
+	for(int i=0; i<PWM_LED_COUNT; i++)
+		pixels[i] = colors;
+	return pwm_Show();
+}
+/**
+  * @brief Refills the first half of the DMA buffer while the second one is sent
+  * @param TIM_HandleTypeDef
+  * @return None
+  */
+void HAL_TIM_PWM_PulseFinishedHalfCpltCallback(TIM_HandleTypeDef *htim) //DMA half transfer callback
+{
+	if(htim->Instance == htim_local->Instance)
+		refill_half(&pwmData[0]);
+}
+/**
+  * @brief Refills the second half of the DMA buffer, stops the DMA after the frame
   * @param TIM_HandleTypeDef
   * @return None
   */
-void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) //DMA finished callback
+void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) //DMA transfer complete callback
 {
-	HAL_TIM_PWM_Stop_DMA(htim_local, TIM_CHANNEL_1); //Stop DMA again
-	isRunning = false;
+	if(htim->Instance == htim_local->Instance)
+		refill_half(&pwmData[PWM_HALF_LENGTH]);
 }
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    reflectance.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Two-shot reflective measurement: one integration with the LED off
+  * 		 and one with the LED on, the difference is free of ambient light.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "reflectance.h"
+#include "measurement.h"
+#include "calibration.h"
+#include "animation.h"
+#include "gamma.h"
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t subtract(uint32_t lit, uint32_t dark)
+{
+	return (lit > dark) ? (lit - dark) : 0;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Measures with the LED off and then with the illumination color, both
+  * 	   integrations are triggered right after the LED took over the color (no
+  * 	   sample with mixed light, no guessed delay). Both are compensated and
+  * 	   corrected, the difference is returned. The LED is off afterwards.
+  * 	   Blocks the calling (measurement) task for two integrations.
+  * @param RGB_t illumination (as COL:), struct MEASUREMENT_S* values
+  * @return _Bool, false if the LED did not change in time
+  */
+_Bool reflectance_measure(RGB_t illumination, struct MEASUREMENT_S* values)
+{
+	const RGB_t off = { 0, 0, 0 };
+	struct MEASUREMENT_S dark;
+	struct MEASUREMENT_S lit;
+	_Bool ok = true;
+
+	ok &= animation_SetColorSettled(gamma_Expand(off), NULL);
+	measurement_trigger(&dark);
+	ok &= animation_SetColorSettled(gamma_Expand(illumination), NULL);
+	measurement_trigger(&lit);
+	animation_SetColorSettled(gamma_Expand(off), NULL);
+
+	calib_compensate(&dark, &dark);
+	calib_apply(&dark);
+	calib_compensate(&lit, &lit);
+	calib_apply(&lit);
+
+	values->red = subtract(lit.red, dark.red);
+	values->green = subtract(lit.green, dark.green);
+	values->blue = subtract(lit.blue, dark.blue);
+	values->clear = subtract(lit.clear, dark.clear);
+	values->infrared = subtract(lit.infrared, dark.infrared);
+	return ok;
+}
@@ -11,6 +11,17 @@
 #include "tasks.h"
 #include "pwm_driver.h"
 #include "i2c_driver.h"
+#include "calibration.h"
+#include "measurement.h"
+#include "filter.h"
+#include "closedloop.h"
+#include "colorlut.h"
+#include "mirror.h"
+#include "reflectance.h"
+#include "animation.h"
+#include "uart.h"
+#include "command.h"
+#include "log.h"
 
 /* Globals -------------------------------------------------------------------*/
 osThreadId_t measurementTaskHandle;
@@ -32,12 +43,286 @@ const osMessageQueueAttr_t MeasurementQueue_attributes = {
   .name = "MeasurementQueue"
 };
 
+osMessageQueueId_t calibrationQueueHandle;
+
+const osMessageQueueAttr_t calibrationQueue_attributes = {
+  .name = "CalibrationQueue"
+};
+
+osMessageQueueId_t closedLoopQueueHandle;
+
+const osMessageQueueAttr_t closedLoopQueue_attributes = {
+  .name = "ClosedLoopQueue"
+};
+
+osMessageQueueId_t lutQueueHandle;
+
+const osMessageQueueAttr_t lutQueue_attributes = {
+  .name = "LutQueue"
+};
+
+osMessageQueueId_t requestQueueHandle;
+
+const osMessageQueueAttr_t requestQueue_attributes = {
+  .name = "RequestQueue"
+};
+
+osMessageQueueId_t reflectanceQueueHandle;
+
+const osMessageQueueAttr_t reflectanceQueue_attributes = {
+  .name = "ReflectanceQueue"
+};
+
+osMessageQueueId_t settledQueueHandle;
+
+const osMessageQueueAttr_t settledQueue_attributes = {
+  .name = "SettledQueue"
+};
+
 osEventFlagsId_t colorUpdateEventHandle;
 
 const osEventFlagsAttr_t colorUpdateEvent_attributes = {
   .name = "ColorUpdate"
 };
 
+/* Private Functions ---------------------------------------------------------*/
+static void read_dark(struct MEASUREMENT_S* values)
+{
+	struct SAMPLE_S sample;
+	uint32_t sum[5] = { 0 };
+	for(int i=0; i<CALIB_DARK_SAMPLES; i++)
+	{
+		measurement_waitNext(&sample);
+		sum[0] += sample.raw.red;
+		sum[1] += sample.raw.green;
+		sum[2] += sample.raw.blue;
+		sum[3] += sample.raw.clear;
+		sum[4] += sample.raw.infrared;
+	}
+	values->red = sum[0] / CALIB_DARK_SAMPLES;
+	values->green = sum[1] / CALIB_DARK_SAMPLES;
+	values->blue = sum[2] / CALIB_DARK_SAMPLES;
+	values->clear = sum[3] / CALIB_DARK_SAMPLES;
+	values->infrared = sum[4] / CALIB_DARK_SAMPLES;
+}
+static void handle_calibration(const CALIB_CMD_t* cmd)
+{
+	struct MEASUREMENT_S raw;
+	struct SAMPLE_S sample;
+	CALIB_STATUS_t status = CALIB_ERROR;
+
+	if(cmd->operation == CALIB_OP_PATCH)
+	{
+		//matrix is fitted on compensated values
+		measurement_waitNext(&sample);
+		calib_compensate(&sample.raw, &raw);
+		status = calib_addPatch(&raw, cmd->args[0], cmd->args[1], cmd->args[2]);
+	}
+	else if(cmd->operation == CALIB_OP_DARK)
+	{
+		read_dark(&raw);
+		calib_setDark(&raw);
+		status = calib_save();
+	}
+	else if(cmd->operation == CALIB_OP_INFRARED)
+	{
+		status = calib_setInfrared(cmd->args[0], cmd->args[1], cmd->args[2]);
+		if(status == CALIB_OK)
+			status = calib_save();
+	}
+	else if(cmd->operation == CALIB_OP_FIT)
+	{
+		status = calib_fit(cmd->args[0] != 0);
+		if(status == CALIB_OK)
+			status = calib_save();
+	}
+	else if(cmd->operation == CALIB_OP_RESET)
+	{
+		calib_reset();
+		status = calib_save();
+	}
+	LOG_INFO(CALIBRATION, cmd->operation, status, calib_getPatchCount());
+	printf("CAL:%c,%u,%u\r\n", cmd->operation, status, calib_getPatchCount());
+}
+
+static void report_profiles(void)
+{
+	measurement_applyProfile();
+	for(uint8_t i=0; i<MEAS_PROFILE_COUNT; i++)
+	{
+		const MEAS_PROFILE_t* profile = measurement_getProfile(i);
+		printf("PRF:%u,%s,%lu,%lu,%u,%u,%lu\r\n", i, profile->name, profile->expectedRate,
+				measurement_getAchievedRate(i), profile->latency, (i == measurement_getProfileIndex()), measurement_getSkipped(i));
+	}
+}
+static void report_filter(void)
+{
+	filter_applyConfig();
+	printf("FLT:%c,%u,%lu,%lu\r\n", filter_getMode(), filter_getWindow(), filter_getCycles(), filter_getMaxCycles());
+}
+
+static void run_closed_loop(const CLM_TARGET_t* target)
+{
+	uint8_t iterations = 0;
+	RGB_t drive = { 0 };
+	CLM_STATUS_t status = clm_run(target, &iterations, &drive);
+	printf("CLM:%u,%u,%u,%u,%u\r\n", status, iterations, drive.red, drive.green, drive.blue);
+}
+static void handle_lut(const LUT_CMD_t* cmd)
+{
+	RGB_t drive = { 0 };
+	LUT_STATUS_t status = LUT_ERROR;
+	if(cmd->operation == LUT_OP_CHARACTERIZE)
+		status = lut_characterize();
+	else if(cmd->operation == LUT_OP_SHOW)
+		status = lut_show(cmd->args[0], cmd->args[1], cmd->args[2], &drive);
+	LOG_INFO(LUT, cmd->operation, status);
+	printf("LUT:%c,%u,%u,%u,%u\r\n", cmd->operation, status, drive.red, drive.green, drive.blue);
+}
+static void report_mirror(void)
+{
+	mirror_apply();
+	printf("MIR:%u,%lu,%lu,%lu,%lu\r\n", mirror_isEnabled(), mirror_getLatency(), mirror_getMaxLatency(),
+			(uint32_t)i2c_getIntegrationTime() * 1000, mirror_getCount());
+}
+static void measure_reflectance(const REF_REQUEST_t* request)
+{
+	struct MEASUREMENT_S values;
+	uint32_t start = clock_micros();
+	if(!reflectance_measure(request->illumination, &values))
+		values = (struct MEASUREMENT_S){ 0 };
+	//the difference covers both measurements, LED off and on
+	if(request->binary)
+		uart_sendSample(LINK_MSG_SAMPLE_REFLECTANCE, request->id, &values, start + (clock_micros() - start) / 2);
+	else
+		printf("REF:%lu,%lu,%lu,%lu,%lu\r\n", values.red, values.green, values.blue, values.infrared, values.clear);
+}
+static void measure_settled(RGB_t color)
+{
+	struct MEASUREMENT_S values;
+	uint32_t latch = DWT->CYCCNT;
+
+	if(!animation_SetColorSettled(gamma_Expand(color), &latch))
+	{
+		printf("MAS:E\r\n");
+		return;
+	}
+	//triggered after the latch, the integration window starts exactly there
+	measurement_trigger(&values);
+	//unfiltered, the filter window still holds samples of the old color
+	calib_compensate(&values, &values);
+	calib_apply(&values);
+	printf("MAS:%lu,%lu,%lu,%lu,%lu,%lu\r\n", values.red, values.green, values.blue, values.infrared, values.clear,
+			(DWT->CYCCNT - latch) / (SystemCoreClock / 1000000));
+}
+
+static RGB_t command_color(const COMMAND_t* command, uint8_t missing)
+{
+	RGB_t color = { missing, missing, missing };
+	if(command->argCount > 0)
+		color.red = command->args[0];
+	if(command->argCount > 1)
+		color.green = command->args[1];
+	if(command->argCount > 2)
+		color.blue = command->args[2];
+	return color;
+}
+//queued until the controller task replies, several requests may be in flight
+static void request_sample(const COMMAND_t* command, uint8_t type)
+{
+	SAMPLE_REQUEST_t request = { type, command->id, command->binary };
+	if(osMessageQueuePut(requestQueueHandle, &request, 0, 0) == osOK)
+		osEventFlagsSet(colorUpdateEventHandle,MEASUREMENT_NEEDED);
+	else
+		LOG_WARN(REQUEST_DROPPED, type, command->id);
+}
+//MEA: / frame MEASURE
+static void command_measure(const COMMAND_t* command)
+{
+	request_sample(command, LINK_MSG_MEASURE);
+}
+//RAW: / frame MEASURE_RAW
+static void command_raw(const COMMAND_t* command)
+{
+	request_sample(command, LINK_MSG_MEASURE_RAW);
+}
+//COL:r,g,b / frame COLOR
+static void command_color_update(const COMMAND_t* command)
+{
+	RGB_t color = command_color(command, 0);
+	osMessageQueuePut(colorUpdateQueueHandle, &color, 0, 0);
+	osEventFlagsSet(colorUpdateEventHandle,NEW_COLOR);
+}
+//CAL:op,r,g,b
+static void command_calibration(const COMMAND_t* command)
+{
+	CALIB_CMD_t cmd;
+	cmd.operation = command->operation;
+	for(int i=0; i<3; i++) //out of range saturates instead of wrapping, calib_setInfrared rejects it
+		cmd.args[i] = (command->args[i] < 0 || command->args[i] > UINT16_MAX) ? UINT16_MAX : command->args[i];
+	osMessageQueuePut(calibrationQueueHandle, &cmd, 0, 0);
+	osEventFlagsSet(colorUpdateEventHandle,CALIBRATION_NEEDED);
+}
+//CLM:r,g,b,clear adjusts the LED until the sensor measures the target
+static void command_closed_loop(const COMMAND_t* command)
+{
+	CLM_TARGET_t target;
+	RGB_t color = command_color(command, 0);
+	target.red = color.red;
+	target.green = color.green;
+	target.blue = color.blue;
+	target.intensity = (uint32_t)command->args[3];
+	osMessageQueuePut(closedLoopQueueHandle, &target, 0, 0);
+	osEventFlagsSet(colorUpdateEventHandle,CLOSED_LOOP_NEEDED);
+}
+//LUT:op,r,g,b
+static void command_lut(const COMMAND_t* command)
+{
+	LUT_CMD_t cmd;
+	cmd.operation = command->operation;
+	for(int i=0; i<3; i++)
+		cmd.args[i] = command->args[i];
+	osMessageQueuePut(lutQueueHandle, &cmd, 0, 0);
+	osEventFlagsSet(colorUpdateEventHandle,LUT_NEEDED);
+}
+//MIR:1 / MIR:0 switches mirror mode, every MIR: reports state and latency
+static void command_mirror(const COMMAND_t* command)
+{
+	if(command->argCount == 1 && (command->args[0] == 0 || command->args[0] == 1))
+		mirror_setEnabled(command->args[0] == 1);
+	osEventFlagsSet(colorUpdateEventHandle,MIRROR_REPORT);
+}
+//REF:r,g,b / frame REFLECTANCE measures with LED off and with r,g,b, REF: uses full white
+static void command_reflectance(const COMMAND_t* command)
+{
+	REF_REQUEST_t request = { command_color(command, 255), command->id, command->binary };
+	if(osMessageQueuePut(reflectanceQueueHandle, &request, 0, 0) == osOK)
+		osEventFlagsSet(colorUpdateEventHandle,REFLECTANCE_NEEDED);
+	else
+		LOG_WARN(REQUEST_DROPPED, LINK_MSG_REFLECTANCE, command->id);
+}
+//MAS:r,g,b sets the LED and measures after it settled
+static void command_settled(const COMMAND_t* command)
+{
+	RGB_t color = command_color(command, 0);
+	osMessageQueuePut(settledQueueHandle, &color, 0, 0);
+	osEventFlagsSet(colorUpdateEventHandle,SETTLED_NEEDED);
+}
+
+//commands handled by the controller and measurement task
+static const COMMAND_ENTRY_t taskCommands[] = {
+	//name	opcode					schema (args, maxArgs, payload bytes)		handler
+	{ "MEA", LINK_MSG_MEASURE,		{ COMMAND_ARGS_NUMBERS, 0, 0, 0 },			command_measure },
+	{ "RAW", LINK_MSG_MEASURE_RAW,	{ COMMAND_ARGS_NUMBERS, 0, 0, 0 },			command_raw },
+	{ "COL", LINK_MSG_COLOR,		{ COMMAND_ARGS_NUMBERS, 3, 3, 3 },			command_color_update },
+	{ "CAL", 0,						{ COMMAND_ARGS_OPERATION, 3, 0, 0 },		command_calibration },
+	{ "CLM", 0,						{ COMMAND_ARGS_NUMBERS, 4, 0, 0 },			command_closed_loop },
+	{ "LUT", 0,						{ COMMAND_ARGS_OPERATION, 3, 0, 0 },		command_lut },
+	{ "MIR", 0,						{ COMMAND_ARGS_NUMBERS, 1, 0, 0 },			command_mirror },
+	{ "REF", LINK_MSG_REFLECTANCE,	{ COMMAND_ARGS_NUMBERS, 3, 3, 3 },			command_reflectance },
+	{ "MAS", 0,						{ COMMAND_ARGS_NUMBERS, 3, 0, 0 },			command_settled },
+};
+
 /* Functions -----------------------------------------------------------------*/
 /**
  *  @brief Initiates all tasks, message queues and events
@@ -54,11 +339,40 @@ TASK_CREATION_t init_Tasks(void)
 	if(colorUpdateEventHandle == NULL)
 		return TASKS_ERROR;
 
-	MeasurementQueueHandle = osMessageQueueNew(2, sizeof(struct MEASUREMENT_S), &MeasurementQueue_attributes);
+	MeasurementQueueHandle = osMessageQueueNew(2, sizeof(struct SAMPLE_S), &MeasurementQueue_attributes);
 	if(MeasurementQueueHandle == NULL)
 		return TASKS_ERROR;
 
+	calibrationQueueHandle = osMessageQueueNew(2, sizeof(CALIB_CMD_t), &calibrationQueue_attributes);
+	if(calibrationQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	closedLoopQueueHandle = osMessageQueueNew(1, sizeof(CLM_TARGET_t), &closedLoopQueue_attributes);
+	if(closedLoopQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	lutQueueHandle = osMessageQueueNew(2, sizeof(LUT_CMD_t), &lutQueue_attributes);
+	if(lutQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	requestQueueHandle = osMessageQueueNew(LINK_REQUEST_WINDOW, sizeof(SAMPLE_REQUEST_t), &requestQueue_attributes);
+	if(requestQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	reflectanceQueueHandle = osMessageQueueNew(LINK_REQUEST_WINDOW, sizeof(REF_REQUEST_t), &reflectanceQueue_attributes);
+	if(reflectanceQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	settledQueueHandle = osMessageQueueNew(1, sizeof(RGB_t), &settledQueue_attributes);
+	if(settledQueueHandle == NULL)
+		return TASKS_ERROR;
+
+	for(int i=0; i<sizeof(taskCommands)/sizeof(taskCommands[0]); i++)
+		if(command_register(&taskCommands[i]) != COMMAND_OK)
+			return TASKS_ERROR;
+
 	Task_attributes.name = "measurementTask";
+	Task_attributes.stack_size = MEASUREMENT_STACK_SIZE;
 	measurementTaskHandle = osThreadNew(StartMeasurementTask,NULL,&Task_attributes);
 	if(osThreadGetState(measurementTaskHandle)==osThreadError)
 		return TASKS_ERROR;
@@ -66,35 +380,95 @@ TASK_CREATION_t init_Tasks(void)
 	return TASKS_CREATED;
 }
 /**
- *  @brief MeasurementTask waits for MEASUREMENT_NEEDED flag, measures and sets
- *  	   MEASUREMENT_DONE flag.
+ *  @brief MeasurementTask reads the sensor continuously (see measurement.c) and
+ *  	   waits for flags in between. MEASUREMENT_NEEDED queues the latest raw and
+ *  	   compensated sample and sets MEASUREMENT_DONE flag.
+ *  	   CALIBRATION_NEEDED flag handles commands from calibrationQueue,
+ *  	   PROFILE_REPORT flag prints expected and achieved rate of all profiles,
+ *  	   FILTER_REPORT flag prints the filter and its cost in cycles,
+ *  	   CLOSED_LOOP_NEEDED flag adjusts the LED to the target from closedLoopQueue,
+ *  	   LUT_NEEDED flag characterizes the LED or shows a color from lutQueue,
+ *  	   MIRROR_REPORT flag prints state and latency of the mirror mode,
+ *  	   REFLECTANCE_NEEDED flag measures with LED off and on for every request in reflectanceQueue,
+ *  	   SETTLED_NEEDED flag sets a color and measures once the LED took it over.
+ *  	   In mirror mode every new sample is shown on the LED right away.
  *  @param None
  *  @return None
  */
 void StartMeasurementTask(void *argument)
 {
 	uint32_t measure_flags = 0;
-	struct MEASUREMENT_S values;
+	struct SAMPLE_S sample;
+	CALIB_CMD_t calib_cmd;
+	CLM_TARGET_t clm_target;
+	LUT_CMD_t lut_cmd;
+	REF_REQUEST_t reflectance_request;
+	RGB_t settled_color;
 
 	for(;;)
 	{
-		measure_flags = osEventFlagsWait(colorUpdateEventHandle,MEASUREMENT_NEEDED,osFlagsNoClear,osWaitForever);
-		if(measure_flags == MEASUREMENT_NEEDED)
+		if(measurement_getTimeout() == 0 && measurement_acquire() && measurement_getLatest(&sample))
+		{
+			mirror_update(&sample);
+			uart_putSample(&sample.compensated, sample.time);
+		}
+		//wakes up for the next reading of the sensor or for a request
+		measure_flags = osEventFlagsWait(colorUpdateEventHandle,MEASUREMENT_NEEDED|CALIBRATION_NEEDED|PROFILE_REPORT|FILTER_REPORT|CLOSED_LOOP_NEEDED|LUT_NEEDED|MIRROR_REPORT|REFLECTANCE_NEEDED|SETTLED_NEEDED,osFlagsNoClear,measurement_getTimeout());
+		if(measure_flags & osFlagsError)
+			continue;
+		if(measure_flags & MEASUREMENT_NEEDED)
 		{
 			osEventFlagsClear(colorUpdateEventHandle, MEASUREMENT_NEEDED);
-			values.red = i2c_getRed();
-			values.green = i2c_getGreen();
-			values.blue = i2c_getBlue();
-			values.infrared = i2c_getIR();
-			values.clear = i2c_getClear();
-			osMessageQueuePut(MeasurementQueueHandle, &values, 0, 0);
+			if(!measurement_getLatest(&sample))
+				measurement_waitNext(&sample);
+			LOG_DEBUG(SAMPLE, sample.compensated.red, sample.compensated.green, sample.compensated.blue, sample.compensated.clear);
+			osMessageQueuePut(MeasurementQueueHandle, &sample, 0, 0);
 			osEventFlagsSet(colorUpdateEventHandle, MEASUREMENT_DONE);
 		}
+		if(measure_flags & PROFILE_REPORT)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, PROFILE_REPORT);
+			report_profiles();
+		}
+		if(measure_flags & FILTER_REPORT)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, FILTER_REPORT);
+			report_filter();
+		}
+		if(measure_flags & CALIBRATION_NEEDED)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, CALIBRATION_NEEDED);
+			while(osMessageQueueGet(calibrationQueueHandle, &calib_cmd, 0, 0)==osOK)
+				handle_calibration(&calib_cmd);
+		}
+		if(measure_flags & CLOSED_LOOP_NEEDED)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, CLOSED_LOOP_NEEDED);
+			if(osMessageQueueGet(closedLoopQueueHandle, &clm_target, 0, 0)==osOK)
+				run_closed_loop(&clm_target);
+		}
+		if(measure_flags & LUT_NEEDED)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, LUT_NEEDED);
+			while(osMessageQueueGet(lutQueueHandle, &lut_cmd, 0, 0)==osOK)
+				handle_lut(&lut_cmd);
+		}
+		if(measure_flags & MIRROR_REPORT)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, MIRROR_REPORT);
+			report_mirror();
+		}
+		if(measure_flags & REFLECTANCE_NEEDED)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, REFLECTANCE_NEEDED);
+			while(osMessageQueueGet(reflectanceQueueHandle, &reflectance_request, 0, 0)==osOK)
+				measure_reflectance(&reflectance_request);
+		}
+		if(measure_flags & SETTLED_NEEDED)
+		{
+			osEventFlagsClear(colorUpdateEventHandle, SETTLED_NEEDED);
+			if(osMessageQueueGet(settledQueueHandle, &settled_color, 0, 0)==osOK)
+				measure_settled(settled_color);
+		}
 	}
-
-
-
-
-
 }
-
@@ -11,71 +11,581 @@
 #include "uart.h"
 #include "stdbool.h"
 #include "tasks.h"
-#include "pwm_driver.h"
+#include "printf.h"
+#include "log.h"
+#include "link_arq.h"
+#include "command.h"
+#include <string.h>
 
 /* Globals -------------------------------------------------------------------*/
+osThreadId_t protocolTaskHandle;
+
+const osThreadAttr_t protocolTask_attributes = {
+  .name = "protocolTask",
+  .stack_size = PROTOCOL_STACK_SIZE,
+  .priority = PROTOCOL_PRIORITY,
+};
+
+static uint8_t rxRing[RX_RING_SIZE]; //written by the DMA in circular mode
+static uint16_t rxPosition = 0; //last DMA position seen by the callback
+static volatile uint32_t rxWritten = 0; //bytes received in total, only the callback writes
+static volatile uint32_t rxRestart = 0; //rxWritten at the last restart of the DMA
+static volatile uint32_t rxCleared = 0; //rxWritten at the last uart_resetStats
+static volatile _Bool rxIdle = false;
+static volatile uint32_t rxTime = 0; //µs (clock_micros) of the last callback, arrival of clock sync replies
+static volatile uint32_t rxTimeWritten = 0; //rxWritten at rxTime
+static uint32_t rxRead = 0; //only the protocol task reads and writes
+
+static LINK_RECEIVER_t receiver;
+static volatile UART_STATS_t stats;
+
+static LINK_ARQ_t arq; //sequence numbers and retransmission of the frames, guarded by linkMutex
+static osMutexId_t linkMutex;
+static const osMutexAttr_t linkMutex_attributes = {
+  .name = "linkMutex",
+};
+static CLOCK_SYNC_t sync; //offset and drift to the display clock, guarded by linkMutex
+static LINK_NODE_t node; //address and turns on the radio channel, only the protocol task writes
+
+//newest sample for the reply to the poll, guarded by linkMutex
+static uint32_t latest[LINK_SAMPLE_CHANNELS];
+static uint32_t latestTime = 0;
+static _Bool latestNew = false;
 
-char RxData[RX_BUFFER_SIZE];
 /* Private Functions ---------------------------------------------------------*/
-static _Bool check_for_buffer_overflow(UART_HandleTypeDef *huart)
+/*
+ * Output of link_arq: frames, retransmissions and acks go into the TX ring
+ */
+static void link_output(void* context, const LINK_MESSAGE_t* message)
+{
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length = link_encode(message, frame, sizeof(frame));
+	if(length > 0)
+		printf_write(frame, length);
+}
+/*
+ * µs the uart needs for bytes (start, 8 data and stop bit each)
+ */
+static uint32_t line_time(uint32_t bytes)
 {
-	return __HAL_UART_GET_FLAG(huart,UART_FLAG_ORE);
+	return (uint32_t)((uint64_t)bytes * 10000000 / huart1.Init.BaudRate);
 }
-static void clear_buffer_overflow(UART_HandleTypeDef *huart)
+/*
+ * Acks are consumed, duplicates and frames out of order are dropped, true if
+ * the message has to be handled. Ticks are ms (configTICK_RATE_HZ 1000).
+ */
+static _Bool link_accept(const LINK_MESSAGE_t* message)
 {
-	__HAL_UART_CLEAR_OREFLAG(huart);
-	//Discard Data
-	__HAL_UART_SEND_REQ(huart, UART_RXDATA_FLUSH_REQUEST);
+	osMutexAcquire(linkMutex, osWaitForever);
+	_Bool accepted = link_arqReceive(&arq, message, osKernelGetTickCount());
+	osMutexRelease(linkMutex);
+	return accepted;
+}
+/*
+ * Retransmits timed out frames, returns the ticks until the next timeout
+ */
+static uint32_t link_poll(void)
+{
+	static uint32_t lost = 0;
+	uint32_t timeout;
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_arqPoll(&arq, osKernelGetTickCount());
+	timeout = link_arqNextTimeout(&arq, osKernelGetTickCount());
+	if(arq.stats.lost != lost)
+	{
+		LOG_WARN(LINK_LOST, arq.stats.lost - lost, arq.stats.lost);
+		lost = arq.stats.lost;
+	}
+	osMutexRelease(linkMutex);
+	return (timeout == LINK_ARQ_NEVER) ? osWaitForever : timeout;
+}
+/*
+ * Without polls clock sync requests go out when they are due, polled they
+ * wait for the turn of this node and the TX ring is gated. Returns the ticks
+ * until the next request or until the polls count as lost.
+ */
+static uint32_t node_poll(void)
+{
+	LINK_MESSAGE_t message;
+	uint32_t timeout;
+	uint32_t tick = osKernelGetTickCount();
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	_Bool polled = link_nodeIsPolled(&node, tick);
+	printf_setGated(polled);
+	if(polled)
+		timeout = node.lastPoll + LINK_POLL_LOST + 1 - tick;
+	else
+	{
+		if(clock_syncPoll(&sync, clock_micros(), &message))
+		{
+			message.address = node.address;
+			link_output(NULL, &message);
+		}
+		timeout = (clock_syncNextTimeout(&sync, clock_micros()) + 999) / 1000;
+	}
+	osMutexRelease(linkMutex);
+	return timeout;
+}
+/*
+ * Poll of the display: the clock sync request (when due) and the newest
+ * sample queue up behind everything since the last turn, the poll reply ends
+ * the turn and releases all of it in one burst
+ */
+static void take_turn(LINK_MESSAGE_t* reply)
+{
+	LINK_MESSAGE_t message;
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length;
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	printf_setGated(true);
+	//stamped with the time it leaves the uart, after the bytes queued before it
+	if(clock_syncPoll(&sync, clock_micros() + line_time(printf_getPending()), &message))
+	{
+		message.address = node.address;
+		link_output(NULL, &message);
+	}
+	if(latestNew)
+	{
+		link_packSample(latest, clock_syncRemote(&sync, latestTime), clock_syncError(&sync, clock_micros()), reply,
+				LINK_MSG_POLL_REPLY);
+		latestNew = false;
+	}
+	length = link_encode(reply, frame, sizeof(frame));
+	printf_writeLast(frame, length);
+	osMutexRelease(linkMutex);
+}
+/*
+ * Reply of the display to a clock sync request
+ */
+static void sync_receive(const LINK_MESSAGE_t* message, uint32_t received)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	_Bool wasSynchronized = clock_syncIsSynchronized(&sync);
+	if(clock_syncReceive(&sync, message, received) && !wasSynchronized && clock_syncIsSynchronized(&sync))
+		LOG_INFO(CLOCK_SYNCED, clock_syncError(&sync, received), sync.drift, sync.delay);
+	osMutexRelease(linkMutex);
+}
+/*
+ * LNK: prints the receive counters
+ */
+static void command_link(const COMMAND_t* command)
+{
+	UART_STATS_t copy;
+	uart_getStats(&copy);
+	printf("LNK:%lu,%lu,%lu,%lu,%lu\r\n", copy.frames, copy.commands, copy.dropped, copy.rejected, copy.errors);
+}
+/*
+ * CMD: prints calls, rejected calls and execution time in cycles of every
+ * registered command
+ */
+static void command_report(const COMMAND_t* command)
+{
+	COMMAND_STATS_t entry;
+	for(uint8_t i=0; command_getStats(i, &entry); i++)
+	{
+		printf("CMD:%s,%u,%lu,%lu,%lu,%lu\r\n", (entry.entry->name[0] != '\0') ? entry.entry->name : "-", entry.entry->opcode,
+				entry.calls, entry.rejected, entry.calls ? (uint32_t)(entry.totalCycles / entry.calls) : 0, entry.maxCycles);
+	}
+}
+
+/*
+ * STA: link statistics of this node, "STA:R" clears them
+ * STA:UART,frames,commands,bytes,dropped,rejected,crc,errors,overruns
+ * STA:ARQ,sent,retransmitted,acked,lost,timeouts,resyncs,delivered,duplicates,acks
+ * STA:RTT,count,min,mean,p50,p90,p99,max,srtt,rttvar,rto (ms)
+ * STA:HIS,low,high,count for every bucket of the histogram that is not empty
+ */
+static void command_stats(const COMMAND_t* command)
+{
+	static HISTOGRAM_t rtt; //too large for the stack of the protocol task
+	UART_STATS_t uart;
+	LINK_ARQ_STATS_t link;
+
+	if(command->operation == 'R')
+	{
+		uart_resetStats();
+		printf("STA:R\r\n");
+		return;
+	}
+	uart_getStats(&uart);
+	uart_getLinkStats(&link);
+	uart_getLinkRtt(&rtt);
+	printf("STA:UART,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", uart.frames, uart.commands, uart.bytes, uart.dropped,
+			uart.rejected, uart.crc, uart.errors, uart.overruns);
+	printf("STA:ARQ,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", link.sent, link.retransmitted, link.acked, link.lost,
+			link.timeouts, link.resyncs, link.delivered, link.duplicates, link.acks);
+	printf("STA:RTT,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", rtt.count, rtt.min, histogram_mean(&rtt),
+			histogram_percentile(&rtt, 50), histogram_percentile(&rtt, 90), histogram_percentile(&rtt, 99), rtt.max,
+			link.srtt, link.rttvar, link.rto);
+	for(uint8_t i=0; i<HISTOGRAM_BUCKETS; i++)
+		if(rtt.counts[i] > 0)
+			printf("STA:HIS,%lu,%lu,%lu\r\n", histogram_low(i), histogram_high(i), rtt.counts[i]);
+}
+
+/*
+ * SYN: clock synchronization to the display, "SYN:R" starts it over
+ * SYN:synchronized,offset,drift,error,jitter,delay (µs, drift in ppb)
+ * SYN:requests,replies,rejected,points,outliers,restarts
+ */
+static void command_sync(const COMMAND_t* command)
+{
+	CLOCK_SYNC_t copy;
+	uint32_t now = clock_micros();
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	if(command->operation == 'R')
+		clock_syncInit(&sync, now);
+	copy = sync;
+	osMutexRelease(linkMutex);
+	if(command->operation == 'R')
+	{
+		printf("SYN:R\r\n");
+		return;
+	}
+	printf("SYN:%u,%lu,%ld,%ld,%lu,%lu\r\n", clock_syncIsSynchronized(&copy), clock_syncRemote(&copy, now) - now, copy.drift,
+			(long)clock_syncError(&copy, now), copy.jitter, copy.delay);
+	printf("SYN:%lu,%lu,%lu,%lu,%lu,%lu\r\n", copy.stats.requests, copy.stats.replies, copy.stats.rejected,
+			copy.stats.points, copy.stats.outliers, copy.stats.restarts);
+}
+
+/*
+ * ADR: address of this node on the radio channel, "ADR:n" sets it (1..4,
+ * others are ignored)
+ * ADR:address,polled,turns,late
+ */
+static void command_address(const COMMAND_t* command)
+{
+	if(command->argCount > 0 && command->args[0] >= 1 && command->args[0] <= LINK_MAX_NODES)
+		node.address = command->args[0];
+	printf("ADR:%u,%u,%lu,%lu\r\n", node.address, link_nodeIsPolled(&node, osKernelGetTickCount()), node.turns, node.late);
+}
+
+static const COMMAND_ENTRY_t uartCommands[] = {
+	{ "LNK", 0, { COMMAND_ARGS_NUMBERS, 0, 0, 0 }, command_link },
+	{ "CMD", 0, { COMMAND_ARGS_NUMBERS, 0, 0, 0 }, command_report },
+	{ "STA", 0, { COMMAND_ARGS_OPERATION, 0, 0, 0 }, command_stats },
+	{ "SYN", 0, { COMMAND_ARGS_OPERATION, 0, 0, 0 }, command_sync },
+	{ "ADR", 0, { COMMAND_ARGS_NUMBERS, 1, 0, 0 }, command_address },
+};
+/*
+ * Frames and ASCII commands go to the registered handlers, unknown ones and
+ * wrong arguments count as rejected
+ */
+static void dispatch_result(COMMAND_STATUS_t status, uint32_t opcode)
+{
+	if(status == COMMAND_OK)
+		return;
+	stats.rejected++;
+	LOG_WARN(COMMAND_REJECTED, opcode, status);
+}
+static void dispatch_text(const char* text)
+{
+	//the log shows the name as hex, "COL" is 0x434f4c
+	uint32_t name = 0;
+	for(int i=0; i<COMMAND_NAME_LENGTH && text[i] != '\0'; i++)
+		name = (name << 8) | (uint8_t)text[i];
+	dispatch_result(command_dispatchText(text), name);
+}
+/*
+ * Hands the bytes the DMA wrote since the last call to the receiver, frames
+ * and commands are handled as soon as they are complete
+ */
+static void process_received(void)
+{
+	LINK_MESSAGE_t message;
+	LINK_RX_RESULT_t result;
+	LINK_STATUS_t status = LINK_OK;
+	uint32_t written = rxWritten;
+	uint32_t restart = rxRestart;
+	uint32_t received;
+	uint32_t receivedWritten;
+
+	//time and byte count of the same callback, read after written so it covers all of them
+	do {
+		received = rxTime;
+		receivedWritten = rxTimeWritten;
+	} while(received != rxTime);
+
+	//reception was restarted after an error, the DMA begins at the start of the ring again
+	if((int32_t)(restart - rxRead) > 0)
+	{
+		stats.dropped += restart - rxRead;
+		LOG_WARN(RX_DROPPED, restart - rxRead, stats.dropped);
+		rxRead = restart;
+		link_resetReceiver(&receiver);
+	}
+	//the DMA overtook the task, the oldest bytes are gone
+	if((int32_t)(written - rxRead) > RX_RING_SIZE)
+	{
+		stats.dropped += written - rxRead - RX_RING_SIZE;
+		LOG_WARN(RX_DROPPED, written - rxRead - RX_RING_SIZE, stats.dropped);
+		rxRead = written - RX_RING_SIZE;
+		link_resetReceiver(&receiver);
+	}
+
+	while((int32_t)(written - rxRead) > 0)
+	{
+		result = link_receive(&receiver, rxRing[rxRead++ % RX_RING_SIZE]);
+		if(result == LINK_RX_NONE)
+			continue;
+		if(result == LINK_RX_FRAME && (status = link_decode((uint8_t*)receiver.data, receiver.length, &message)) == LINK_OK)
+		{
+			stats.frames++;
+			if(!link_nodeReceive(&node, &message, receiver.paused, osKernelGetTickCount()) || !link_accept(&message))
+				continue;
+			//the callback came after the last byte of the frame and the ones behind it
+			if(message.type == LINK_MSG_SYNC_REPLY)
+				sync_receive(&message, received - (((int32_t)(receivedWritten - rxRead) > 0) ? line_time(receivedWritten - rxRead) : 0));
+			else
+				dispatch_result(command_dispatchMessage(&message), message.type);
+		}
+		else if(result == LINK_RX_TEXT)
+		{
+			stats.commands++;
+			dispatch_text(receiver.data);
+		}
+		else
+		{
+			stats.rejected++;
+			if(result == LINK_RX_FRAME && status == LINK_ERR_CRC)
+				stats.crc++;
+			LOG_WARN(FRAME_REJECTED, stats.rejected);
+		}
+	}
+	//no CR/LF from a terminal, the idle line ends the command, after a poll it starts the turn
+	if(rxIdle && written == rxWritten)
+	{
+		rxIdle = false;
+		if(link_receiveIdle(&receiver) == LINK_RX_TEXT)
+		{
+			stats.commands++;
+			dispatch_text(receiver.data);
+		}
+		if(link_nodeIdle(&node, &message))
+			take_turn(&message);
+	}
+}
+/*
+ * Reception was aborted (overrun ends the DMA transfer), restart it at the
+ * beginning of the ring
+ */
+static void uart_errorCallback(UART_HandleTypeDef *huart)
+{
+	stats.errors++;
+	if(huart->ErrorCode & HAL_UART_ERROR_ORE)
+		stats.overruns++;
+	LOG_WARN(UART_ERROR, huart->ErrorCode);
+	if(huart->RxState != HAL_UART_STATE_READY)
+		return; //noise or framing error, the DMA is still running
+	rxWritten += (RX_RING_SIZE - rxWritten % RX_RING_SIZE) % RX_RING_SIZE;
+	rxRestart = rxWritten;
+	rxPosition = 0;
+	HAL_UARTEx_ReceiveToIdle_DMA(huart, rxRing, RX_RING_SIZE);
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_RX_FLAG);
 }
 
 /* Functions -----------------------------------------------------------------*/
 /**
- *  @brief Initiates uart message queue + receive to idle
+ *  @brief Registers LNK:, CMD:, STA:, SYN: and ADR:, starts the protocol task and the circular
+ *  	   DMA reception with idle line detection
  *  @param None
- *  @return UART_CREATION_t to make sure queue was created, check for UART_ERROR
+ *  @return UART_CREATION_t to make sure task was created, check for UART_ERROR
  */
 UART_CREATION_t init_uart(void)
 {
+	link_resetReceiver(&receiver);
+	link_arqInit(&arq, LINK_ARQ_WINDOW, link_output, NULL);
+	clock_syncInit(&sync, clock_micros());
+	link_nodeInit(&node, NODE_ADDRESS, osKernelGetTickCount());
+	linkMutex = osMutexNew(&linkMutex_attributes);
+	if(linkMutex == NULL)
+		return UART_ERROR;
+	for(int i=0; i<sizeof(uartCommands)/sizeof(uartCommands[0]); i++)
+		if(command_register(&uartCommands[i]) != COMMAND_OK)
+			return UART_ERROR;
+	protocolTaskHandle = osThreadNew(StartProtocolTask, NULL, &protocolTask_attributes);
+	if(protocolTaskHandle == NULL)
+		return UART_ERROR;
+
 	//register own callback function (needs a setting in .ioc file to work)
 	HAL_UART_RegisterRxEventCallback(&huart1,uart_callback);
-	if(HAL_UARTEx_ReceiveToIdle_IT(&huart1, (uint8_t*)RxData, RX_BUFFER_SIZE)==HAL_OK)
+	HAL_UART_RegisterCallback(&huart1, HAL_UART_ERROR_CB_ID, uart_errorCallback);
+	if(HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rxRing, RX_RING_SIZE)==HAL_OK)
 		return UART_CREATED;
 	else
 		return UART_ERROR;
 }
-/* Functions -----------------------------------------------------------------*/
 /**
- *  @brief Callback of UART Rx Complete
- *  @param UART_HandleTypeDef *huart, uint16_t size
+ *  @brief Parses everything the DMA received, woken up by the uart callback,
+ *  	   retransmits frames that were not acked in time, answers the polls
+ *  	   of the display and sends the clock sync requests
+ *  @param None
  *  @return None
  */
-void uart_callback(UART_HandleTypeDef *huart, uint16_t size)
+void StartProtocolTask(void *argument)
 {
-	if(RxData[0]=='M'&&RxData[1]=='E'&&RxData[2]=='A'&&RxData[3]==':')
+	uint32_t timeout = 0;
+	uint32_t nodeTimeout;
+	for(;;)
 	{
-		osEventFlagsSet(colorUpdateEventHandle,MEASUREMENT_NEEDED);
+		osThreadFlagsWait(PROTOCOL_RX_FLAG | PROTOCOL_LINK_FLAG, osFlagsWaitAny, timeout);
+		process_received();
+		timeout = link_poll();
+		nodeTimeout = node_poll();
+		if(nodeTimeout < timeout)
+			timeout = nodeTimeout;
 	}
-	else if(RxData[0]=='C' &&RxData[1]=='O'&& RxData[2]=='L'&& RxData[3]==':')
-	{
-		RGB_t values;
-		values.red = 0;
-		values.green = 0;
-		values.blue = 0;
-		int r,g,b;
-		sscanf(RxData, "COL:%i,%i,%i\r\n", &r, &g, &b);
-		values.red = r;
-		values.green = g;
-		values.blue = b;
-		osMessageQueuePut(colorUpdateQueueHandle, &values, 0, 0);
-		osEventFlagsSet(colorUpdateEventHandle,NEW_COLOR);
-	}
-	//Restart receive to idle
-	if(check_for_buffer_overflow(&huart1))
+}
+/**
+ *  @brief Copy of the receive counters
+ *  @param UART_STATS_t* copy
+ *  @return None
+ */
+void uart_getStats(UART_STATS_t* copy)
+{
+	copy->frames = stats.frames;
+	copy->commands = stats.commands;
+	copy->dropped = stats.dropped;
+	copy->rejected = stats.rejected;
+	copy->crc = stats.crc;
+	copy->errors = stats.errors;
+	copy->overruns = stats.overruns;
+	copy->bytes = rxWritten - rxCleared;
+}
+/**
+ *  @brief Callback of UART Rx Event (idle line, half and complete transfer of
+ *  	   the ring), only counts the new bytes and wakes the protocol task
+ *  @param UART_HandleTypeDef *huart, uint16_t size
+ *  @return None
+ */
+void uart_callback(UART_HandleTypeDef *huart, uint16_t size)
+{
+	//size is the DMA position in the ring (RX_RING_SIZE at transfer complete)
+	uint16_t position = size % RX_RING_SIZE;
+	rxWritten += (position + RX_RING_SIZE - rxPosition) % RX_RING_SIZE;
+	rxPosition = position;
+	rxTime = clock_micros();
+	rxTimeWritten = rxWritten;
+	if(HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE)
+		rxIdle = true;
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_RX_FLAG);
+}
+/**
+ *  @brief Copy of the counters and round trip time of the link layer
+ *  @param LINK_ARQ_STATS_t* copy
+ *  @return None
+ */
+void uart_getLinkStats(LINK_ARQ_STATS_t* copy)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_arqGetStats(&arq, copy);
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Clears the receive counters, the counters of the link layer and the
+ *  	   round trip time histogram, e.g. after changing baud rate or window
+ *  @param None
+ *  @return None
+ */
+void uart_resetStats(void)
+{
+	stats.frames = 0;
+	stats.commands = 0;
+	stats.dropped = 0;
+	stats.rejected = 0;
+	stats.crc = 0;
+	stats.errors = 0;
+	stats.overruns = 0;
+	rxCleared = rxWritten; //rxWritten itself keeps counting, the receiver reads the ring with it
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_arqResetStats(&arq);
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Copy of the round trip time histogram of the link layer (ms)
+ *  @param HISTOGRAM_t* copy, about 200 bytes, better static than on the stack
+ *  @return None
+ */
+void uart_getLinkRtt(HISTOGRAM_t* copy)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_arqGetRtt(&arq, copy);
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Sends one binary frame with sequence number, it is retransmitted
+ *  	   until the other board acks it, from the address of this node. Waits while LINK_ARQ_WINDOW frames
+ *  	   are in flight, the protocol task itself drops the frame instead.
+ *  @param const LINK_MESSAGE_t* message
+ *  @return None
+ */
+void uart_sendMessage(const LINK_MESSAGE_t* message)
+{
+	LINK_ARQ_STATUS_t status;
+	LINK_MESSAGE_t addressed = *message;
+
+	addressed.address = node.address;
+	for(;;)
 	{
-		printf("ERR:\r\n");
-		clear_buffer_overflow(&huart1);
+		osMutexAcquire(linkMutex, osWaitForever);
+		status = link_arqSend(&arq, &addressed, osKernelGetTickCount());
+		osMutexRelease(linkMutex);
+		if(status == LINK_ARQ_OK)
+			break;
+		//only the protocol task handles the acks that free the window
+		if(osThreadGetId() == protocolTaskHandle)
+		{
+			LOG_WARN(LINK_DROPPED, message->type);
+			return;
+		}
+		osDelay(LINK_SEND_RETRY_MS);
 	}
-	HAL_UARTEx_ReceiveToIdle_IT(&huart1,(uint8_t*)RxData,RX_BUFFER_SIZE);
-
+	//starts the retransmission timer
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_LINK_FLAG);
+}
+/**
+ *  @brief Sends red, green, blue, infrared and clear packed as binary frame,
+ *  	   stamped with the time of the display and the error of that time
+ *  @param uint8_t type (LINK_MSG_SAMPLE...)
+ *  @param uint8_t id of the request
+ *  @param const struct MEASUREMENT_S* values
+ *  @param uint32_t time µs (clock_micros) the sample was taken
+ *  @return None
+ */
+void uart_sendSample(uint8_t type, uint8_t id, const struct MEASUREMENT_S* values, uint32_t time)
+{
+	LINK_MESSAGE_t message;
+	uint32_t channels[LINK_SAMPLE_CHANNELS] = { values->red, values->green, values->blue, values->infrared, values->clear };
+	uint32_t remote;
+	uint32_t error;
 
+	osMutexAcquire(linkMutex, osWaitForever);
+	remote = clock_syncRemote(&sync, time);
+	error = clock_syncError(&sync, clock_micros());
+	osMutexRelease(linkMutex);
+	link_packSample(channels, remote, error, &message, type);
+	message.id = id;
+	uart_sendMessage(&message);
+}
+/**
+ *  @brief Keeps the newest sample for the reply to the next poll of the
+ *  	   display, called by the measurement task for every reading
+ *  @param const struct MEASUREMENT_S* values, compensated
+ *  @param uint32_t time µs (clock_micros) the sample was taken
+ *  @return None
+ */
+void uart_putSample(const struct MEASUREMENT_S* values, uint32_t time)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	latest[0] = values->red;
+	latest[1] = values->green;
+	latest[2] = values->blue;
+	latest[3] = values->infrared;
+	latest[4] = values->clear;
+	latestTime = time;
+	latestNew = true;
+	osMutexRelease(linkMutex);
 }
@@ -25,7 +25,9 @@ typedef enum {
 	FIRST_ITEM = 1,
 	SECOND_ITEM = 2,
 	THIRD_ITEM = 3,
-	FOURTH_ITEM = 4
+	FOURTH_ITEM = 4,
+	FIFTH_ITEM = 5,
+	SIXTH_ITEM = 6
 }MENU_ITEM_t;
 
 typedef enum {
@@ -54,16 +56,20 @@ typedef enum {
 
 }SET_COLOR_STATE_t;
 
+/* Defines -------------------------------------------------------------------*/
+#define MAIN_MENU_ITEMS 6
+
 /* Function Prototypes -------------------------------------------------------*/
 void oled_blankScreen(void);
 void oled_loadingScreen(void);
 void oled_continueMessage(void);
 void oled_continueMessageDot(ANIMATED_DOT_t);
-void oled_drawMainMenu(const char *item0,const char *item1,const char *item2,const char *item3);
+void oled_drawMainMenu(const char *item0,const char *item1,const char *item2,const char *item3,const char *item4,const char *item5);
 void oled_highlightMainItem(MENU_ITEM_t);
 void oled_drawItemMenu(const char *name, const char *Left, const char *Right);
 void oled_highlightItemLR(SUBMENU_STATE_t);
 void oled_SetColorCursor(SET_COLOR_STATE_t, uint16_t);
+void oled_drawBars(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint32_t* values, uint8_t count, uint16_t color);
 
 
 #endif /* INC_OLED_LIB_H_ */
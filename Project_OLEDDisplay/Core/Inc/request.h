@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    request.h
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Requests to the sensor board with correlation ids: up to
+  * 		 REQUEST_WINDOW in flight, every reply is matched to its waiting
+  * 		 caller by id, every request has its own timeout.
+  *
+  ******************************************************************************
+  */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef INC_REQUEST_H_
+#define INC_REQUEST_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "cmsis_os.h"
+#include "tasks.h"
+#include "oled_driver.h"
+#include "link_codec.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef enum {
+	REQUEST_OK = 0,
+	REQUEST_TIMEOUT = 1,	//no reply in time, a late reply is dropped
+	REQUEST_FULL = 2,		//REQUEST_WINDOW requests in flight, nothing sent
+	REQUEST_UNKNOWN = 3		//id is not pending (already collected or expired)
+}REQUEST_STATUS_t;
+
+typedef struct RequestStats
+{
+	uint32_t sent;
+	uint32_t completed;		//reply matched to its request
+	uint32_t timeouts;
+	uint32_t unmatched;		//replies without pending request: late, duplicate or unknown id
+	uint32_t full;			//not sent, window full
+}REQUEST_STATS_t;
+
+/* Defines -------------------------------------------------------------------*/
+#define REQUEST_WINDOW LINK_REQUEST_WINDOW //the sensor board queues as many
+
+#define REQUEST_REPLY_FLAG 0x100 //thread flag of the waiting task
+
+#define REQUEST_MEASURE_TIMEOUT_MS 1000 //next sample of the slowest profile (400 ms) and the link
+#define REQUEST_REFLECTANCE_TIMEOUT_MS 3000 //two measurements and the LED settling
+
+/* Function Prototypes -------------------------------------------------------*/
+uint8_t request_send(uint8_t type, RGB_t color, uint32_t timeout);
+REQUEST_STATUS_t request_wait(uint8_t id, struct MEASUREMENT_S* values);
+REQUEST_STATUS_t request_measure(uint8_t type, RGB_t color, uint32_t timeout, struct MEASUREMENT_S* values);
+_Bool request_complete(uint8_t type, uint8_t id, const struct MEASUREMENT_S* values);
+void request_getStats(REQUEST_STATS_t* copy);
+
+#endif /* INC_REQUEST_H_ */
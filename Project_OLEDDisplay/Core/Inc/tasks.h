@@ -29,10 +29,10 @@ typedef enum {
 }IO_FLAG_t;
 
 typedef enum {
-	MEASUREMENT_NEEDED = 1,
-	MEASUREMENT_DONE = 2,
 	NEW_COLOR = 4,
-	ALL_THREE = 7
+	MIRROR_ON = 8,
+	MIRROR_OFF = 16,
+	ALL_FLAGS = 28	//measurements are requests with id (request.h)
 }MEASUREMENT_FLAG_t;
 
 typedef struct ScrollValue
@@ -42,11 +42,13 @@ typedef struct ScrollValue
 }ScrollValue_t;
 
 struct MEASUREMENT_S{
-	uint16_t red;
-	uint16_t green;
-	uint16_t blue;
-	uint16_t clear;
-	uint16_t infrared;
+	uint32_t red;		//more than 16 bit in HDR mode of the sensor
+	uint32_t green;
+	uint32_t blue;
+	uint32_t clear;
+	uint32_t infrared;
+	uint32_t time;		//µs, clock of the display (clock_micros) in the middle of the integration
+	uint16_t error;		//µs of time, LINK_SAMPLE_UNSYNCED if the sensor was not synchronized
 };
 
 /* Globals -------------------------------------------------------------------*/
@@ -63,10 +65,6 @@ extern osMessageQueueId_t ColorUpdateQueueHandle;
 
 extern const osMessageQueueAttr_t ColorUpdateQueue_attributes;
 
-extern osMessageQueueId_t MeasurementQueueHandle;
-
-extern const osMessageQueueAttr_t MeasurementQueue_attributes;
-
 extern osEventFlagsId_t ioUpdateEventHandle;
 
 extern const osEventFlagsAttr_t ioUpdateEvent_attributes;
@@ -15,10 +15,14 @@
 #include "math.h"
 #include "stdio.h"
 #include "cmsis_os.h"
+#include "link_codec.h"
+#include "link_arq.h"
+#include "clock_sync.h"
+#include "link_schedule.h"
 /* Globals -------------------------------------------------------------------*/
-extern osMessageQueueId_t UartUpdateQueueHandle;
+extern osThreadId_t protocolTaskHandle;
 
-extern const osMessageQueueAttr_t UartUpdateQueue_attributes;
+extern const osThreadAttr_t protocolTask_attributes;
 
 extern UART_HandleTypeDef huart1;
 /* Defines -------------------------------------------------------------------*/
@@ -27,10 +31,41 @@ typedef enum {
 	UART_ERROR = 1,
 }UART_CREATION_t;
 
-#define RX_BUFFER_SIZE 30
+typedef struct UartStats
+{
+	uint32_t frames;	//binary frames with valid CRC
+	uint32_t commands;	//ASCII replies
+	uint32_t dropped;	//bytes lost because the ring ran over or reception restarted
+	uint32_t rejected;	//frames with wrong CRC/length, too long messages
+	uint32_t crc;		//rejected frames with wrong CRC (bit errors on the radio)
+	uint32_t errors;	//overrun, noise and framing errors of the uart
+	uint32_t overruns;	//errors that lost bytes in the uart (ORE), reception restarted
+	uint32_t bytes;		//received since the last uart_resetStats
+}UART_STATS_t;
+
+#define RX_RING_SIZE 128 //DMA ring, the task is woken at idle line and every half
+
+#define PROTOCOL_RX_FLAG 1
+#define PROTOCOL_LINK_FLAG 2 //a frame was sent, the retransmission timer runs
+
+#define SENSOR_NODES LINK_MAX_NODES //polled round robin, addresses 1..SENSOR_NODES
+
+#define LINK_SEND_RETRY_MS 5 //uart_sendMessage: window full, try again
+
+#define PROTOCOL_STACK_SIZE 192 * 4 //768 Byte, sscanf
+
+#define PROTOCOL_PRIORITY (osPriority_t) osPriorityAboveNormal
 
 /* Function Prototypes -------------------------------------------------------*/
 UART_CREATION_t init_uart(void);
 void uart_callback(UART_HandleTypeDef *huart, uint16_t size);
+void StartProtocolTask(void *argument);
+void uart_getStats(UART_STATS_t* copy);
+void uart_getLinkStats(LINK_ARQ_STATS_t* copy);
+void uart_getLinkRtt(HISTOGRAM_t* copy);
+void uart_getSchedule(LINK_SCHEDULER_t* copy);
+void uart_resetStats(void);
+void uart_sendMessage(const LINK_MESSAGE_t* message);
+void uart_sendColor(uint8_t type, uint8_t id, uint8_t red, uint8_t green, uint8_t blue);
 
 #endif /* INC_UART_H_ */
@@ -28,6 +28,8 @@
 #include "adc_driver.h"
 #include "math.h"
 #include "uart.h"
+#include "printf.h"
+#include "log.h"
 #include "tasks.h"
 
 /* USER CODE END Includes */
@@ -54,6 +56,8 @@ SPI_HandleTypeDef hspi1;
 
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* Definitions for controllerTask */
 osThreadId_t controllerTaskHandle;
@@ -69,6 +73,7 @@ const osThreadAttr_t controllerTask_attributes = {
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_SPI1_Init(void);
 static void MX_ADC1_Init(void);
@@ -112,6 +117,7 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART2_UART_Init();
   MX_SPI1_Init();
   MX_ADC1_Init();
@@ -123,6 +129,11 @@ int main(void)
 
     adc_configure(12); //Default mode -> READ_POTI
 
+    //CRC unit for the binary link frames
+    link_Init();
+    //printf and link frames are sent with DMA from a ring
+    printf_Init();
+
 
   /* USER CODE END 2 */
 
@@ -159,6 +170,11 @@ int main(void)
   if(init_Tasks()==TASKS_ERROR)
 	  Error_Handler();
 
+  //binary log on USART2 (ST-Link VCP), decoded with Tools/log_decode.py
+  if(!log_Init())
+	  Error_Handler();
+  LOG_INFO(BOOT, 1);
+
 
   /* add threads, ... */
   /* USER CODE END RTOS_THREADS */
@@ -410,6 +426,25 @@ static void MX_USART2_UART_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA2_Channel6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Channel6_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel6_IRQn);
+  /* DMA2_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Channel7_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel7_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -476,38 +511,28 @@ void StartControllerTask(void *argument)
 	    CurrentColors.green = 0;
 	    CurrentColors.blue = 0;
 
-	    struct MEASUREMENT_S CurrentValues;
-	    CurrentValues.red = 0;
-	    CurrentValues.green = 0;
-	    CurrentValues.blue = 0;
-	    CurrentValues.clear = 0;
-	    CurrentValues.infrared = 0;
-
 	    uint32_t measure_flags;
   /* Infinite loop */
   for(;;)
   {
-	  measure_flags = osEventFlagsWait(colorUpdateEventHandle,ALL_THREE,osFlagsNoClear,osWaitForever);
-	  if(measure_flags == MEASUREMENT_NEEDED)
-	  {
-		  osEventFlagsClear(colorUpdateEventHandle, MEASUREMENT_NEEDED);
-		  printf("MEA:\r\n");
-	  }
-	  else if(measure_flags == NEW_COLOR)
+	  measure_flags = osEventFlagsWait(colorUpdateEventHandle,ALL_FLAGS,osFlagsNoClear,osWaitForever);
+	  if(measure_flags == NEW_COLOR)
 	  {
 		  osEventFlagsClear(colorUpdateEventHandle, NEW_COLOR);
 		  if(osMessageQueueGet(ColorUpdateQueueHandle, &CurrentColors, 0, 0)==osOK)
 		  {
-			  printf("COL:%u,%u,%u\r\n",CurrentColors.red,CurrentColors.green,CurrentColors.blue);
+			  uart_sendColor(LINK_MSG_COLOR, LINK_ID_NONE, CurrentColors.red, CurrentColors.green, CurrentColors.blue);
 		  }
 	  }
-	  else if(measure_flags == MEASUREMENT_DONE)
+	  else if(measure_flags == MIRROR_ON)
 	  {
-		  osEventFlagsClear(colorUpdateEventHandle, MEASUREMENT_DONE);
-		  if(osMessageQueueGet(UartUpdateQueueHandle, &CurrentValues, 0, 0)==osOK)
-		  {
-			 osMessageQueuePut(MeasurementQueueHandle, &CurrentValues,0,0);
-		  }
+		  osEventFlagsClear(colorUpdateEventHandle, MIRROR_ON);
+		  printf("MIR:1\r\n");
+	  }
+	  else if(measure_flags == MIRROR_OFF)
+	  {
+		  osEventFlagsClear(colorUpdateEventHandle, MIRROR_OFF);
+		  printf("MIR:0\r\n");
 	  }
   }
   /* USER CODE END 5 */
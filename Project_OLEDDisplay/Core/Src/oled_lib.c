@@ -14,6 +14,7 @@
 
 /* Globals -------------------------------------------------------------------*/
 static char write_buffer [30];
+static const uint8_t mainMenuRows[MAIN_MENU_ITEMS+1] = { 12, 26, 40, 54, 68, 82, 95 }; //upper line of every item, last is the bottom line
 
 /**
   * @brief Draws words "PRESS BUTTON TO CONTINUE..." over loading screen
@@ -38,33 +39,26 @@ void oled_continueMessageDot(ANIMATED_DOT_t status)
 	oled_FillArea(85, 22, 86, 24, status);
 }
 /**
-  * @brief Draws menu Layout with 4 different options
-  * @param char arrays of the 4 options
+  * @brief Draws menu Layout with 6 different options
+  * @param char arrays of the 6 options
   * @return None
   */
-void oled_drawMainMenu(const char *item0,const char *item1,const char *item2,const char *item3)
+void oled_drawMainMenu(const char *item0,const char *item1,const char *item2,const char *item3,const char *item4,const char *item5)
 {
+	const char* items[MAIN_MENU_ITEMS] = { item0, item1, item2, item3, item4, item5 };
+
 	snprintf( write_buffer, 30, "MENU" );
 	oled_writeText( &write_buffer[0], 4, 1 );
 	oled_FillArea(0, 12, 96, 13, 0x9494);
 	oled_FillArea(88, 12, 89, 96, 0x9494);
 	oled_FillArea(0, 12, 1, 96, 0x9494);
-	oled_FillArea(0, 33, 89, 34, 0x9494);
-	oled_FillArea(0, 54, 89, 55, 0x9494);
-	oled_FillArea(0, 75, 89, 76, 0x9494);
-	oled_FillArea(0, 95, 89, 96, 0x9494);
-
-	snprintf( write_buffer, 30, item0 );
-	oled_writeText( &write_buffer[0], 4, 17 );
-
-	snprintf( write_buffer, 30, item1 );
-	oled_writeText( &write_buffer[0], 4, 38 );
-
-	snprintf( write_buffer, 30, item2 );
-	oled_writeText( &write_buffer[0], 4, 59 );
 
-	snprintf( write_buffer, 30, item3 );
-	oled_writeText( &write_buffer[0], 4, 80 );
+	for(int i=0; i<MAIN_MENU_ITEMS; i++)
+	{
+		oled_FillArea(0, mainMenuRows[i+1], 89, mainMenuRows[i+1]+1, 0x9494);
+		snprintf( write_buffer, 30, items[i] );
+		oled_writeText( &write_buffer[0], 4, mainMenuRows[i]+3 );
+	}
 }
 /**
   * @brief Highlights one of the Menu Options without needing to refresh whole screen
@@ -73,67 +67,17 @@ void oled_drawMainMenu(const char *item0,const char *item1,const char *item2,con
   */
 void oled_highlightMainItem(MENU_ITEM_t item)
 {
-	if(item == FIRST_ITEM)
-	{
-		oled_FillArea(1,13,88,14,0x6b6d);
-		oled_FillArea(1,32,88,33,0x6b6d);
-		oled_FillArea(1,13,2,33,0x6b6d);
-		oled_FillArea(87,13,88,33,0x6b6d);
-	}
-	else
-	{
-		oled_FillArea(1,13,88,14,0xFFFF);
-		oled_FillArea(1,32,88,33,0xFFFF);
-		oled_FillArea(1,13,2,33,0xFFFF);
-		oled_FillArea(87,13,88,33,0xFFFF);
-	}
-	if(item == SECOND_ITEM)
-	{
-		oled_FillArea(1,34,88,35,0x6b6d);
-		oled_FillArea(1,53,88,54,0x6b6d);
-		oled_FillArea(1,34,2,54,0x6b6d);
-		oled_FillArea(87,34,88,54,0x6b6d);
-	}
-	else
-	{
-		oled_FillArea(1,34,88,35,0xFFFF);
-		oled_FillArea(1,53,88,54,0xFFFF);
-		oled_FillArea(1,34,2,54,0xFFFF);
-		oled_FillArea(87,34,88,54,0xFFFF);
-	}
-	if(item == THIRD_ITEM)
-	{
-		oled_FillArea(1,55,88,56,0x6b6d);
-		oled_FillArea(1,74,88,75,0x6b6d);
-		oled_FillArea(1,55,2,75,0x6b6d);
-		oled_FillArea(87,55,88,75,0x6b6d);
-	}
-	else
+	for(int i=0; i<MAIN_MENU_ITEMS; i++)
 	{
-		oled_FillArea(1,55,88,56,0xFFFF);
-		oled_FillArea(1,74,88,75,0xFFFF);
-		oled_FillArea(1,55,2,75,0xFFFF);
-		oled_FillArea(87,55,88,75,0xFFFF);
+		uint16_t color = (item == (MENU_ITEM_t)(FIRST_ITEM + i)) ? 0x6b6d : 0xFFFF;
+		uint16_t top = mainMenuRows[i] + 1;
+		uint16_t bottom = mainMenuRows[i+1];
+
+		oled_FillArea(1,top,88,top+1,color);
+		oled_FillArea(1,bottom-1,88,bottom,color);
+		oled_FillArea(1,top,2,bottom,color);
+		oled_FillArea(87,top,88,bottom,color);
 	}
-	if(item == FOURTH_ITEM)
-	{
-		oled_FillArea(1,76,88,77,0x6b6d);
-		oled_FillArea(1,94,88,95,0x6b6d);
-		oled_FillArea(1,76,2,95,0x6b6d);
-		oled_FillArea(87,76,88,95,0x6b6d);
-	}
-	else
-	{
-		oled_FillArea(1,76,88,77,0xFFFF);
-		oled_FillArea(1,94,88,95,0xFFFF);
-		oled_FillArea(1,76,2,95,0xFFFF);
-		oled_FillArea(87,76,88,95,0xFFFF);
-	}
-	if(item == NO_ITEM)
-	{
-		;
-	}
-
 }
 /**
   * @brief Draws submenu layout with name of item and lines
@@ -247,4 +191,30 @@ void oled_SetColorCursor(SET_COLOR_STATE_t color, uint16_t level)
 		oled_FillArea(30+level, 59, 31+level, 64, 0);
 	}
 }
-
+/**
+  * @brief Bar chart, every value is one bar scaled to the largest one
+  * @param uint8_t x, y upper left corner, width, height of the chart
+  * @param const uint32_t* values, uint8_t count of bars
+  * @param uint16_t color of the bars
+  * @return None
+  */
+void oled_drawBars(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint32_t* values, uint8_t count, uint16_t color)
+{
+	uint32_t max = 0;
+	uint8_t barWidth = width / count;
+
+	oled_FillArea(x, y, x + width, y + height, 0xFFFF);
+	oled_FillArea(x, y + height, x + width, y + height + 1, 0x9494);
+	for(int i=0; i<count; i++)
+		if(values[i] > max)
+			max = values[i];
+	if(max == 0)
+		return;
+	for(int i=0; i<count; i++)
+	{
+		//an empty bucket stays empty, any other gets at least one line
+		uint8_t bar = (uint8_t)(((uint64_t)values[i] * height + max - 1) / max);
+		if(values[i] > 0)
+			oled_FillArea(x + i*barWidth, y + height - bar, x + (i+1)*barWidth - 1, y + height, color);
+	}
+}
@@ -0,0 +1,214 @@
+/**
+  ******************************************************************************
+  * @file    request.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Requests to the sensor board with correlation ids. The caller
+  * 		 sends, the protocol task completes the matching slot with the
+  * 		 reply and wakes the caller. A reply whose id is not pending any
+  * 		 more (timed out, duplicate) is counted and dropped.
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "request.h"
+#include "uart.h"
+#include "log.h"
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct PendingRequest
+{
+	uint8_t id;					//LINK_ID_NONE if the slot is free
+	uint8_t type;				//LINK_MSG_MEASURE...
+	_Bool done;					//reply is in values
+	uint32_t sentTick;
+	uint32_t timeout;			//ticks
+	osThreadId_t waiter;		//woken with REQUEST_REPLY_FLAG, NULL if nobody waits yet
+	struct MEASUREMENT_S values;
+}PENDING_t;
+
+/* Globals -------------------------------------------------------------------*/
+static PENDING_t pending[REQUEST_WINDOW];
+static uint8_t nextId = 1;
+static REQUEST_STATS_t stats;
+
+/* Private Functions ---------------------------------------------------------*/
+static _Bool is_expired(const PENDING_t* slot, uint32_t now)
+{
+	return !slot->done && (now - slot->sentTick) >= slot->timeout;
+}
+/*
+ * Slot of a pending id, called with kernel locked
+ */
+static PENDING_t* find_slot(uint8_t id)
+{
+	for(int i=0; i<REQUEST_WINDOW; i++)
+		if(id != LINK_ID_NONE && pending[i].id == id)
+			return &pending[i];
+	return NULL;
+}
+/*
+ * Frees the slot of a request that timed out or whose reply was not collected
+ * in time, called with kernel locked
+ */
+static void expire(PENDING_t* slot)
+{
+	if(!slot->done)
+	{
+		stats.timeouts++;
+		LOG_WARN(REQUEST_TIMEOUT, slot->type, slot->id);
+	}
+	slot->id = LINK_ID_NONE;
+}
+
+/* Functions -----------------------------------------------------------------*/
+/**
+  * @brief Sends a request with the next correlation id and returns right away,
+  * 	   collect the reply with request_wait within the timeout. Up to
+  * 	   REQUEST_WINDOW requests can be in flight, so the link is not idle
+  * 	   while a reply travels back.
+  * @param uint8_t type LINK_MSG_MEASURE, LINK_MSG_MEASURE_RAW or LINK_MSG_REFLECTANCE
+  * @param RGB_t color illumination of LINK_MSG_REFLECTANCE, else unused
+  * @param uint32_t timeout in ms, counted from now
+  * @return uint8_t id of the request, LINK_ID_NONE if the window is full
+  */
+uint8_t request_send(uint8_t type, RGB_t color, uint32_t timeout)
+{
+	PENDING_t* slot = NULL;
+	uint32_t now = osKernelGetTickCount();
+	uint8_t id;
+
+	osKernelLock();
+	for(int i=0; i<REQUEST_WINDOW; i++)
+	{
+		//a request nobody waits for gives its slot back after its timeout
+		if(pending[i].id != LINK_ID_NONE && pending[i].waiter == NULL && (now - pending[i].sentTick) >= pending[i].timeout)
+			expire(&pending[i]);
+		if(pending[i].id == LINK_ID_NONE && slot == NULL)
+			slot = &pending[i];
+	}
+	if(slot == NULL)
+	{
+		stats.full++;
+		osKernelUnlock();
+		return LINK_ID_NONE;
+	}
+	id = nextId;
+	nextId = (nextId == 255) ? 1 : nextId + 1;
+	slot->id = id;
+	slot->type = type;
+	slot->done = false;
+	slot->sentTick = now;
+	slot->timeout = timeout * osKernelGetTickFreq() / 1000;
+	slot->waiter = NULL;
+	stats.sent++;
+	osKernelUnlock();
+
+	uart_sendColor(type, id, color.red, color.green, color.blue);
+	return id;
+}
+/**
+  * @brief Blocks until the reply of the request arrived or its timeout passed,
+  * 	   the id is free afterwards
+  * @param uint8_t id from request_send
+  * @param struct MEASUREMENT_S* values of the reply
+  * @return REQUEST_STATUS_t REQUEST_OK, REQUEST_TIMEOUT or REQUEST_UNKNOWN
+  */
+REQUEST_STATUS_t request_wait(uint8_t id, struct MEASUREMENT_S* values)
+{
+	for(;;)
+	{
+		uint32_t now = osKernelGetTickCount();
+		osKernelLock();
+		PENDING_t* slot = find_slot(id);
+		if(slot == NULL)
+		{
+			osKernelUnlock();
+			return REQUEST_UNKNOWN;
+		}
+		if(slot->done)
+		{
+			*values = slot->values;
+			slot->id = LINK_ID_NONE;
+			osKernelUnlock();
+			return REQUEST_OK;
+		}
+		if(is_expired(slot, now))
+		{
+			expire(slot);
+			osKernelUnlock();
+			return REQUEST_TIMEOUT;
+		}
+		uint32_t remaining = slot->timeout - (now - slot->sentTick);
+		slot->waiter = osThreadGetId();
+		osKernelUnlock();
+		//a flag left over from an earlier reply only costs one more pass
+		osThreadFlagsWait(REQUEST_REPLY_FLAG, osFlagsWaitAny, remaining);
+	}
+}
+/**
+  * @brief Sends a request and waits for its reply
+  * @param uint8_t type, RGB_t color, uint32_t timeout in ms (see request_send)
+  * @param struct MEASUREMENT_S* values of the reply
+  * @return REQUEST_STATUS_t
+  */
+REQUEST_STATUS_t request_measure(uint8_t type, RGB_t color, uint32_t timeout, struct MEASUREMENT_S* values)
+{
+	uint8_t id = request_send(type, color, timeout);
+	if(id == LINK_ID_NONE)
+		return REQUEST_FULL;
+	return request_wait(id, values);
+}
+/**
+  * @brief Hands a reply to the pending request with the same id and wakes the
+  * 	   caller. Replies without id (ASCII) complete the oldest pending request
+  * 	   of that type. Called by the protocol task.
+  * @param uint8_t type of the request (reply type without LINK_MSG_REPLY)
+  * @param uint8_t id of the reply, LINK_ID_NONE for ASCII replies
+  * @param const struct MEASUREMENT_S* values
+  * @return _Bool false if no request waits for this reply, it is dropped
+  */
+_Bool request_complete(uint8_t type, uint8_t id, const struct MEASUREMENT_S* values)
+{
+	PENDING_t* slot = NULL;
+	uint32_t now = osKernelGetTickCount();
+
+	osKernelLock();
+	if(id != LINK_ID_NONE)
+		slot = find_slot(id);
+	else
+	{
+		for(int i=0; i<REQUEST_WINDOW; i++)
+			if(pending[i].id != LINK_ID_NONE && pending[i].type == type && !pending[i].done
+				&& (slot == NULL || (now - pending[i].sentTick) > (now - slot->sentTick)))
+				slot = &pending[i];
+	}
+	//late replies are not taken for a newer request
+	if(slot == NULL || slot->type != type || slot->done || is_expired(slot, now))
+	{
+		stats.unmatched++;
+		osKernelUnlock();
+		LOG_WARN(REPLY_UNMATCHED, type, id);
+		return false;
+	}
+	slot->values = *values;
+	slot->done = true;
+	stats.completed++;
+	osThreadId_t waiter = slot->waiter;
+	osKernelUnlock();
+
+	if(waiter != NULL)
+		osThreadFlagsSet(waiter, REQUEST_REPLY_FLAG);
+	return true;
+}
+/**
+  * @brief Copy of the request counters
+  * @param REQUEST_STATS_t* copy
+  * @return None
+  */
+void request_getStats(REQUEST_STATS_t* copy)
+{
+	osKernelLock();
+	*copy = stats;
+	osKernelUnlock();
+}
@@ -12,8 +12,13 @@
 #include "oled_lib.h"
 #include "io_driver.h"
 #include "adc_driver.h"
+#include "request.h"
+#include "uart.h"
 #include "math.h"
 
+/* Defines -------------------------------------------------------------------*/
+#define LINK_STATS_BARS (HISTOGRAM_BUCKETS / HISTOGRAM_HALF) //one bar per power of two of the round trip time
+
 /* Globals -------------------------------------------------------------------*/
 osThreadId_t ioTaskHandle;
 osThreadId_t oledTaskHandle;
@@ -29,12 +34,6 @@ const osMessageQueueAttr_t ScrollValueQueue_attributes = {
   .name = "ScrollValueQueue"
 };
 
-osMessageQueueId_t MeasurementQueueHandle;
-
-const osMessageQueueAttr_t MeasurementQueue_attributes = {
-  .name = "MeasurementQueue"
-};
-
 osMessageQueueId_t ColorUpdateQueueHandle;
 
 const osMessageQueueAttr_t ColorUpdateQueue_attributes = {
@@ -53,7 +52,47 @@ const osEventFlagsAttr_t colorUpdateEvent_attributes = {
   .name = "ioUpdate"
 };
 
+/* Private Functions ---------------------------------------------------------*/
+/*
+ * Diagnostics screen: counters of this node, the sensor nodes answering polls
+ * with the cycle time and the round trip times as histogram (bars 0-3, 4-7,
+ * 8-15 ... ms). The copies are static, the stack of the OLED task is small.
+ */
+static void draw_linkStats(char* write_buffer)
+{
+	static UART_STATS_t uartStats;
+	static LINK_ARQ_STATS_t linkStats;
+	static HISTOGRAM_t rtt;
+	static LINK_SCHEDULER_t schedule;
+	static uint32_t bars[LINK_STATS_BARS];
+	uint8_t present = 0;
+
+	uart_getStats(&uartStats);
+	uart_getSchedule(&schedule);
+	for(int i=0; i<schedule.count; i++)
+		present += schedule.nodes[i].present;
+	uart_getLinkStats(&linkStats);
+	uart_getLinkRtt(&rtt);
+	for(int i=0; i<LINK_STATS_BARS; i++)
+	{
+		bars[i] = 0;
+		for(int j=0; j<HISTOGRAM_HALF; j++)
+			bars[i] += rtt.counts[i*HISTOGRAM_HALF + j];
+	}
 
+	oled_drawItemMenu("LINK STATS","AGAIN","BACK");
+	snprintf( write_buffer, 30, "Tx %lu Rtx %lu", linkStats.sent, linkStats.retransmitted );
+	oled_writeText( &write_buffer[0], 4, 14 );
+	snprintf( write_buffer, 30, "Rx %lu Crc %lu", uartStats.frames, uartStats.crc );
+	oled_writeText( &write_buffer[0], 4, 24 );
+	snprintf( write_buffer, 30, "Lost %lu Ovr %lu", linkStats.lost, uartStats.overruns );
+	oled_writeText( &write_buffer[0], 4, 34 );
+	snprintf( write_buffer, 30, "RTT %lu/%lu/%lums", histogram_percentile(&rtt, 50), histogram_percentile(&rtt, 99), rtt.max );
+	oled_writeText( &write_buffer[0], 4, 44 );
+	snprintf( write_buffer, 30, "Nodes %u/%u %lums", present, schedule.count, schedule.cycle );
+	oled_writeText( &write_buffer[0], 4, 54 );
+	oled_drawBars(4, 63, 84, 7, bars, LINK_STATS_BARS, 0x630C);
+}
 
 /* Functions -----------------------------------------------------------------*/
 /**
@@ -67,10 +106,6 @@ TASK_CREATION_t init_Tasks(void)
 	if(ScrollValueQueueHandle == NULL)
 		 return TASKS_ERROR;
 
-	MeasurementQueueHandle = osMessageQueueNew(2, sizeof(struct MEASUREMENT_S), &MeasurementQueue_attributes);
-	if(MeasurementQueueHandle == NULL)
-		 return TASKS_ERROR;
-
 	ColorUpdateQueueHandle = osMessageQueueNew(2, sizeof(RGB_t), &ColorUpdateQueue_attributes);
 	if(ColorUpdateQueueHandle == NULL)
 		return TASKS_ERROR;
@@ -139,6 +174,8 @@ void StartOLEDTask(void *argument)
 	CurrentValues.blue = 0;
 	CurrentValues.clear = 0;
 	CurrentValues.infrared = 0;
+	CurrentValues.time = 0;
+	CurrentValues.error = LINK_SAMPLE_UNSYNCED;
 
 	RGB_t CurrentColors;
 	CurrentColors.red = 0;
@@ -153,6 +190,8 @@ void StartOLEDTask(void *argument)
 	MENU_ITEM_t item = NO_ITEM;
 	SUBMENU_STATE_t sub_state = NONE;
 	SET_COLOR_STATE_t sub_4_state = RED;
+	_Bool mirrorOn = false;
+	REQUEST_STATUS_t measured = REQUEST_OK;
 
 	char write_buffer [30];
 
@@ -189,7 +228,7 @@ void StartOLEDTask(void *argument)
 				{
 					state=MAIN;
 					oled_blankScreen();
-					oled_drawMainMenu("Measurement","LUX + CCT","Get Color","Set Color" );
+					oled_drawMainMenu("Measurement","LUX + CCT","Get Color","Set Color","Mirror LED","Link Stats" );
 					osEventFlagsClear(ioUpdateEventHandle,CLICK);
 				}
 				else if(state == MAIN)
@@ -198,32 +237,48 @@ void StartOLEDTask(void *argument)
 
 					if(item == FIRST_ITEM)
 					{
-						osEventFlagsSet(colorUpdateEventHandle, MEASUREMENT_NEEDED);
-
-						osMessageQueueGet(MeasurementQueueHandle, &CurrentValues, 0, osWaitForever);
+						//times out instead of waiting forever for a lost reply
+						measured = request_measure(LINK_MSG_MEASURE, CurrentColors, REQUEST_MEASURE_TIMEOUT_MS, &CurrentValues);
+						if(measured != REQUEST_OK)
+							memset(&CurrentValues, 0, sizeof(CurrentValues));
 
 						oled_drawItemMenu("MEASURE","AGAIN","BACK");
 
-						snprintf( write_buffer, 30, "Red: %u", CurrentValues.red );
+						snprintf( write_buffer, 30, "Red: %lu", CurrentValues.red );
 						oled_writeText( &write_buffer[0], 4, 14 );
-						snprintf( write_buffer, 30, "Green: %u", CurrentValues.green );
+						snprintf( write_buffer, 30, "Green: %lu", CurrentValues.green );
 						oled_writeText( &write_buffer[0], 4, 25 );
-						snprintf( write_buffer, 30, "Blue: %u", CurrentValues.blue );
+						snprintf( write_buffer, 30, "Blue: %lu", CurrentValues.blue );
 						oled_writeText( &write_buffer[0], 4, 36 );
-						snprintf( write_buffer, 30, "Clear: %u", CurrentValues.clear );
+						snprintf( write_buffer, 30, "Clear: %lu", CurrentValues.clear );
 						oled_writeText( &write_buffer[0], 4, 47 );
-						snprintf( write_buffer, 30, "Infrared: %u", CurrentValues.infrared );
+						snprintf( write_buffer, 30, "Infrared: %lu", CurrentValues.infrared );
 						oled_writeText( &write_buffer[0], 4, 58 );
+						if(measured != REQUEST_OK)
+						{
+							snprintf( write_buffer, 30, "No reply" );
+							oled_writeText( &write_buffer[0], 4, 69 );
+						}
+						else
+						{
+							//sample time is in the clock of the display, synchronized by the sensor
+							if(CurrentValues.error == LINK_SAMPLE_UNSYNCED)
+								snprintf( write_buffer, 30, "Age: no sync" );
+							else
+								snprintf( write_buffer, 30, "Age: %lums +-%uus", (clock_micros() - CurrentValues.time) / 1000, CurrentValues.error );
+							oled_writeText( &write_buffer[0], 4, 69 );
+						}
 
 					}
 					else if(item == SECOND_ITEM)
 					{
-						osEventFlagsSet(colorUpdateEventHandle, MEASUREMENT_NEEDED);
-						osMessageQueueGet(MeasurementQueueHandle, &CurrentValues, 0, osWaitForever);
+						measured = request_measure(LINK_MSG_MEASURE, CurrentColors, REQUEST_MEASURE_TIMEOUT_MS, &CurrentValues);
+						if(measured != REQUEST_OK)
+							memset(&CurrentValues, 0, sizeof(CurrentValues));
 
 						  oled_drawItemMenu("LUX + CCT","AGAIN","BACK");
 		      	  		  //Calculation according to correct gain, integration time and sensitivity
-		      	  		  snprintf( write_buffer, 30, "Intensity: %u.%ulux", (CurrentValues.green*192/1000),(CurrentValues.green*192/100)%10 );
+		      	  		  snprintf( write_buffer, 30, "Intensity: %lu.%lulux", (CurrentValues.green*192/1000),(CurrentValues.green*192/100)%10 );
 		      	  		  oled_writeText( &write_buffer[0], 4, 25 );
 
 		      	  		  //Calculation according to Application Guide of VEML3328
@@ -235,31 +290,24 @@ void StartOLEDTask(void *argument)
 		      	  		  CCT = CCT*pow(CCTi,-0.805); //math.h also uses a lot of memory
 		      	  		  snprintf( write_buffer, 30, "Color Temp.: %uK", (uint16_t)CCT);
 		      	  		  oled_writeText( &write_buffer[0], 4, 47 );
+		      	  		  if(measured != REQUEST_OK)
+		      	  		  {
+		      	  			  snprintf( write_buffer, 30, "No reply" );
+		      	  			  oled_writeText( &write_buffer[0], 4, 69 );
+		      	  		  }
 					}
 					else if(item == THIRD_ITEM)
 					{
 
 						  oled_drawItemMenu("GET Color","AGAIN","BACK");
 
-		      			  //Turn on RGB LED
-		      			  CurrentColors.red = 230; //Attempting to have "white LED"
-		      			  CurrentColors.green = 160;
-		      			  CurrentColors.blue = 90;
-		      			  osMessageQueuePut(ColorUpdateQueueHandle, &CurrentColors, 0, 0);
-		      			  osEventFlagsSet(colorUpdateEventHandle,NEW_COLOR);
-
-		      			  osDelay(200); //Integration time of sensor -> 100ms, so 200ms is enough time
-
-		      			  osEventFlagsSet(colorUpdateEventHandle, MEASUREMENT_NEEDED);
-		      			  osMessageQueueGet(MeasurementQueueHandle, &CurrentValues, 0, osWaitForever);
-
-		      			  //Turn off RGB LED
-		      	  		  CurrentColors.red = 0;
-		      	  		  CurrentColors.green=0;
-		      	  		  CurrentColors.blue=0;
-
-		      	  		  osMessageQueuePut(ColorUpdateQueueHandle, &CurrentColors, 0, 0);
-		      	  		  osEventFlagsSet(colorUpdateEventHandle,NEW_COLOR);
+		      			  //Sensor measures with LED off and with "white LED", replies the difference (one round trip)
+		      			  CurrentColors.red = 243; //same duty as 230,160,90 before gamma correction
+		      			  CurrentColors.green = 206;
+		      			  CurrentColors.blue = 159;
+		      			  measured = request_measure(LINK_MSG_REFLECTANCE, CurrentColors, REQUEST_REFLECTANCE_TIMEOUT_MS, &CurrentValues);
+		      			  if(measured != REQUEST_OK)
+		      				  memset(&CurrentValues, 0, sizeof(CurrentValues));
 
 		      	  		  if(CurrentValues.clear>0)
 		      	  		  {
@@ -295,6 +343,11 @@ void StartOLEDTask(void *argument)
 
 		      	  		  //Fill section of screen with measured color
 		      			  oled_FillArea(4, 22, 44, 62, (((CurrentColors.red>>3) << 11) | ((CurrentColors.green>>2) << 5) | CurrentColors.blue >> 3));
+		      			  if(measured != REQUEST_OK)
+		      			  {
+		      				  snprintf( write_buffer, 30, "No reply" );
+		      				  oled_writeText( &write_buffer[0], 4, 69 );
+		      			  }
 
 		      			  CurrentColors.red = 0;
 		      			  CurrentColors.green = 0;
@@ -324,6 +377,23 @@ void StartOLEDTask(void *argument)
 		      			  sub_state = SET_COLOR;
 
 					}
+					else if(item == FIFTH_ITEM)
+					{
+						  //Sensor node shows every sample on its LED, no link traffic while on
+						  mirrorOn = !mirrorOn;
+						  osEventFlagsSet(colorUpdateEventHandle, mirrorOn ? MIRROR_ON : MIRROR_OFF);
+
+						  oled_drawItemMenu("MIRROR LED","AGAIN","BACK");
+						  snprintf( write_buffer, 30, "Mirror mode:" );
+						  oled_writeText( &write_buffer[0], 4, 25 );
+						  snprintf( write_buffer, 30, mirrorOn ? "ON" : "OFF" );
+						  oled_writeText( &write_buffer[0], 4, 40 );
+					}
+					else if(item == SIXTH_ITEM)
+					{
+						  //RTT 50 %/99 %/max, the sensor node reports its own counters with "STA:"
+						  draw_linkStats(write_buffer);
+					}
 					osEventFlagsClear(ioUpdateEventHandle,CLICK);
 				}
 				else if(state == SUB)
@@ -332,7 +402,7 @@ void StartOLEDTask(void *argument)
 					{
 						state = MAIN;
 						oled_blankScreen();
-						oled_drawMainMenu("Measurement","LUX + CCT","Get Color","Set Color" );
+						oled_drawMainMenu("Measurement","LUX + CCT","Get Color","Set Color","Mirror LED","Link Stats" );
 						osEventFlagsClear(ioUpdateEventHandle,CLICK);
 					}
 					else if(sub_state == SET_COLOR)
@@ -384,6 +454,8 @@ void StartOLEDTask(void *argument)
 						CurrentValues.blue = 0;
 						CurrentValues.infrared = 0;
 						CurrentValues.clear = 0;
+						CurrentValues.time = 0;
+						CurrentValues.error = LINK_SAMPLE_UNSYNCED;
 
 						state = MAIN;
 						sub_4_state = RED;
@@ -402,22 +474,30 @@ void StartOLEDTask(void *argument)
 				}
 				if(state == MAIN)
 				{
-					if(ScrollValue.scaledValue<45)
+					if(ScrollValue.scaledValue<41)
 					{
 						item = FIRST_ITEM;
 					}
-					else if (ScrollValue.scaledValue>=45 && ScrollValue.scaledValue<65)
+					else if (ScrollValue.scaledValue>=41 && ScrollValue.scaledValue<52)
 					{
 						item = SECOND_ITEM;
 					}
-					else if(ScrollValue.scaledValue>=65 && ScrollValue.scaledValue<85)
+					else if(ScrollValue.scaledValue>=52 && ScrollValue.scaledValue<63)
 					{
 						item = THIRD_ITEM;
 					}
-					else if(ScrollValue.scaledValue>=85 && ScrollValue.scaledValue<95)
+					else if(ScrollValue.scaledValue>=63 && ScrollValue.scaledValue<74)
 					{
 						item = FOURTH_ITEM;
 					}
+					else if(ScrollValue.scaledValue>=74 && ScrollValue.scaledValue<85)
+					{
+						item = FIFTH_ITEM;
+					}
+					else
+					{
+						item = SIXTH_ITEM;
+					}
 					oled_highlightMainItem(item);
 					oled_FillArea(91, 14, 94, 96, 0xFFFF);
 					oled_FillArea(91, ScrollValue.scaledValue-15, 94, ScrollValue.scaledValue, 0x630C);
@@ -11,78 +11,570 @@
 #include "uart.h"
 #include "stdbool.h"
 #include "tasks.h"
+#include "printf.h"
+#include "log.h"
+#include "link_arq.h"
+#include "request.h"
+#include <string.h>
 
 /* Globals -------------------------------------------------------------------*/
-osMessageQueueId_t UartUpdateQueueHandle;
+osThreadId_t protocolTaskHandle;
 
-const osMessageQueueAttr_t UartUpdateQueue_attributes = {
-  .name = "UartUpdateQueue"
+const osThreadAttr_t protocolTask_attributes = {
+  .name = "protocolTask",
+  .stack_size = PROTOCOL_STACK_SIZE,
+  .priority = PROTOCOL_PRIORITY,
 };
 
-char RxData[RX_BUFFER_SIZE];
+static uint8_t rxRing[RX_RING_SIZE]; //written by the DMA in circular mode
+static uint16_t rxPosition = 0; //last DMA position seen by the callback
+static volatile uint32_t rxWritten = 0; //bytes received in total, only the callback writes
+static volatile uint32_t rxRestart = 0; //rxWritten at the last restart of the DMA
+static volatile uint32_t rxCleared = 0; //rxWritten at the last uart_resetStats
+static volatile _Bool rxIdle = false;
+static volatile uint32_t rxTime = 0; //µs (clock_micros) of the last callback, arrival of clock sync requests
+static volatile uint32_t rxTimeWritten = 0; //rxWritten at rxTime
+static uint32_t rxRead = 0; //only the protocol task reads and writes
+
+static LINK_RECEIVER_t receiver;
+static volatile UART_STATS_t stats;
+
+static LINK_ARQ_t arq[SENSOR_NODES]; //one link per sensor node (address - 1), guarded by linkMutex
+static osMutexId_t linkMutex;
+static const osMutexAttr_t linkMutex_attributes = {
+  .name = "linkMutex",
+};
+static LINK_SCHEDULER_t scheduler; //turns of the sensor nodes, guarded by linkMutex
+
+//clock sync requests wait for the start of the next turn, guarded by linkMutex
+static struct {
+	LINK_MESSAGE_t request;
+	uint32_t received;	//µs, arrival of the request
+	_Bool pending;
+}syncRequests[SENSOR_NODES];
+
 /* Private Functions ---------------------------------------------------------*/
-static _Bool check_for_buffer_overflow(UART_HandleTypeDef *huart)
+/*
+ * Output of link_arq: frames, retransmissions and acks go into the TX ring
+ */
+static void link_output(void* context, const LINK_MESSAGE_t* message)
+{
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length = link_encode(message, frame, sizeof(frame));
+	if(length > 0)
+		printf_write(frame, length);
+}
+/*
+ * µs the uart needs for bytes (start, 8 data and stop bit each)
+ */
+static uint32_t line_time(uint32_t bytes)
+{
+	return (uint32_t)((uint64_t)bytes * 10000000 / huart1.Init.BaudRate);
+}
+/*
+ * Acks are consumed, duplicates and frames out of order are dropped, true if
+ * the message has to be handled. Frames of unknown nodes are dropped too.
+ * Ticks are ms (configTICK_RATE_HZ 1000).
+ */
+static _Bool link_accept(const LINK_MESSAGE_t* message)
 {
-	return __HAL_UART_GET_FLAG(huart,UART_FLAG_ORE);
+	if(message->address < 1 || message->address > SENSOR_NODES)
+		return false;
+	osMutexAcquire(linkMutex, osWaitForever);
+	_Bool accepted = link_arqReceive(&arq[message->address - 1], message, osKernelGetTickCount());
+	osMutexRelease(linkMutex);
+	return accepted;
+}
+/*
+ * Retransmits timed out frames, returns the ticks until the next timeout
+ */
+static uint32_t link_poll(void)
+{
+	static uint32_t lost = 0;
+	uint32_t total = 0;
+	uint32_t timeout = LINK_ARQ_NEVER;
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+	{
+		link_arqPoll(&arq[i], osKernelGetTickCount());
+		uint32_t next = link_arqNextTimeout(&arq[i], osKernelGetTickCount());
+		if(next < timeout)
+			timeout = next;
+		total += arq[i].stats.lost;
+	}
+	if(total != lost)
+	{
+		LOG_WARN(LINK_LOST, total - lost, total);
+		lost = total;
+	}
+	osMutexRelease(linkMutex);
+	return (timeout == LINK_ARQ_NEVER) ? osWaitForever : timeout;
+}
+/*
+ * The display only transmits at the start of a turn, a clock sync request is
+ * answered then. Its node is known, link_accept checked the address.
+ */
+static void sync_defer(const LINK_MESSAGE_t* request, uint32_t received)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	syncRequests[request->address - 1].request = *request;
+	syncRequests[request->address - 1].received = received;
+	syncRequests[request->address - 1].pending = true;
+	osMutexRelease(linkMutex);
+}
+/*
+ * Logs nodes that started or stopped answering (linkMutex held)
+ */
+static void log_presence(void)
+{
+	static uint8_t present = 0;
+	uint8_t now = link_schedulerPresent(&scheduler);
+	uint8_t count = 0;
+
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+		count += (now >> i) & 1;
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+	{
+		if((now & ~present) & (1 << i))
+			LOG_INFO(NODE_JOINED, i + 1, count);
+		else if((present & ~now) & (1 << i))
+			LOG_WARN(NODE_ABSENT, i + 1, scheduler.misses[i]);
+	}
+	present = now;
+}
+/*
+ * Starts the turn of the next node when the last one ended or timed out:
+ * the deferred clock sync replies and everything queued since the last turn
+ * go out in front of the poll. Returns the ticks until the turn times out.
+ */
+static uint32_t schedule_poll(void)
+{
+	LINK_MESSAGE_t message;
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length;
+	LINK_MESSAGE_t poll;
+	uint32_t timeout;
+
+	osMutexAcquire(linkMutex, osWaitForever);
+	if(link_schedulerPoll(&scheduler, osKernelGetTickCount(), line_time(printf_getPending()) / 1000, &poll))
+	{
+		for(uint8_t i = 0; i < SENSOR_NODES; i++)
+		{
+			//stamped with the time it leaves the uart, after the bytes queued before it
+			if(syncRequests[i].pending && clock_syncReply(&syncRequests[i].request, syncRequests[i].received,
+					clock_micros() + line_time(printf_getPending()), &message))
+			{
+				message.address = i + 1;
+				link_output(NULL, &message);
+			}
+			syncRequests[i].pending = false;
+		}
+		length = link_encode(&poll, frame, sizeof(frame));
+		printf_writeLast(frame, length);
+	}
+	timeout = link_schedulerNextTimeout(&scheduler, osKernelGetTickCount());
+	log_presence();
+	osMutexRelease(linkMutex);
+	return timeout;
+}
+/*
+ * Any frame of the polled node extends its turn, the idle line after its poll
+ * reply ends it
+ */
+static void schedule_receive(const LINK_MESSAGE_t* message)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_schedulerReceive(&scheduler, message, osKernelGetTickCount());
+	osMutexRelease(linkMutex);
+}
+static void schedule_idle(void)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_schedulerIdle(&scheduler);
+	osMutexRelease(linkMutex);
+}
+/*
+ * Hands a reply to the request waiting for it (request.c)
+ */
+static void put_measurement(uint8_t type, uint8_t id, const uint32_t* channels, uint32_t time, uint16_t error)
+{
+	struct MEASUREMENT_S CurrentValues;
+	CurrentValues.red = channels[0];
+	CurrentValues.green = channels[1];
+	CurrentValues.blue = channels[2];
+	CurrentValues.infrared = channels[3];
+	CurrentValues.clear = channels[4];
+	CurrentValues.time = time;
+	CurrentValues.error = error;
+	LOG_DEBUG(SAMPLE_RECEIVED, channels[0], channels[1], channels[2], channels[4]);
+	request_complete(type, id, &CurrentValues);
+}
+/*
+ * Sample frames (MEA/RAW/REF replies) carry the id of their request and the
+ * time they were taken (clock of the display)
+ */
+static void handle_message(const LINK_MESSAGE_t* message)
+{
+	uint32_t channels[LINK_SAMPLE_CHANNELS];
+	uint32_t time;
+	uint16_t error;
+	if((message->type & LINK_MSG_REPLY) && link_unpackSample(message, channels, &time, &error))
+		put_measurement(message->type & ~LINK_MSG_REPLY, message->id, channels, time, error);
+}
+/*
+ * Newest sample of a node from its poll reply, empty if it has none since
+ * the last turn
+ */
+static void put_node_sample(const LINK_MESSAGE_t* message)
+{
+	uint32_t channels[LINK_SAMPLE_CHANNELS];
+	uint32_t time;
+	uint16_t error;
+	if(link_unpackSample(message, channels, &time, &error))
+		LOG_DEBUG(NODE_SAMPLE, message->address, channels[0], channels[1], channels[2]);
+}
+/*
+ * ASCII replies from a sensor (or terminal) without binary frames
+ */
+static void handle_command(const char* command)
+{
+	//REF: (LED off/on difference) has the same format as MEA:
+	if((command[0]=='M'&&command[1]=='E'&&command[2]=='A'&&command[3]==':') || (command[0]=='R'&&command[1]=='E'&&command[2]=='F'&&command[3]==':'))
+	{
+		unsigned long r = 0, g = 0, b = 0, c = 0, ir = 0;
+		sscanf(&command[4], "%lu,%lu,%lu,%lu,%lu", &r, &g, &b, &ir, &c);
+		uint32_t channels[LINK_SAMPLE_CHANNELS] = { r, g, b, ir, c };
+		//no time in ASCII replies, the arrival has to do
+		put_measurement((command[0]=='M') ? LINK_MSG_MEASURE : LINK_MSG_REFLECTANCE, LINK_ID_NONE, channels, clock_micros(), LINK_SAMPLE_UNSYNCED);
+	}
+}
+/*
+ * Hands the bytes the DMA wrote since the last call to the receiver, frames
+ * and replies are handled as soon as they are complete
+ */
+static void process_received(void)
+{
+	LINK_MESSAGE_t message;
+	LINK_RX_RESULT_t result;
+	LINK_STATUS_t status = LINK_OK;
+	uint32_t written = rxWritten;
+	uint32_t restart = rxRestart;
+	uint32_t received;
+	uint32_t receivedWritten;
+
+	//time and byte count of the same callback, read after written so it covers all of them
+	do {
+		received = rxTime;
+		receivedWritten = rxTimeWritten;
+	} while(received != rxTime);
+
+	//reception was restarted after an overrun, a lost reply times out its request
+	if((int32_t)(restart - rxRead) > 0)
+	{
+		stats.dropped += restart - rxRead;
+		LOG_WARN(RX_DROPPED, restart - rxRead, stats.dropped);
+		rxRead = restart;
+		link_resetReceiver(&receiver);
+	}
+	//the DMA overtook the task, the oldest bytes are gone
+	if((int32_t)(written - rxRead) > RX_RING_SIZE)
+	{
+		stats.dropped += written - rxRead - RX_RING_SIZE;
+		LOG_WARN(RX_DROPPED, written - rxRead - RX_RING_SIZE, stats.dropped);
+		rxRead = written - RX_RING_SIZE;
+		link_resetReceiver(&receiver);
+	}
+
+	while((int32_t)(written - rxRead) > 0)
+	{
+		result = link_receive(&receiver, rxRing[rxRead++ % RX_RING_SIZE]);
+		if(result == LINK_RX_NONE)
+			continue;
+		if(result == LINK_RX_FRAME && (status = link_decode((uint8_t*)receiver.data, receiver.length, &message)) == LINK_OK)
+		{
+			stats.frames++;
+			schedule_receive(&message);
+			if(!link_accept(&message))
+				continue;
+			//the callback came after the last byte of the frame and the ones behind it
+			if(message.type == LINK_MSG_SYNC)
+				sync_defer(&message, received - (((int32_t)(receivedWritten - rxRead) > 0) ? line_time(receivedWritten - rxRead) : 0));
+			else if(message.type == LINK_MSG_POLL_REPLY)
+				put_node_sample(&message);
+			else
+				handle_message(&message);
+		}
+		else if(result == LINK_RX_TEXT)
+		{
+			stats.commands++;
+			handle_command(receiver.data);
+		}
+		else
+		{
+			stats.rejected++;
+			if(result == LINK_RX_FRAME && status == LINK_ERR_CRC)
+				stats.crc++;
+			LOG_WARN(FRAME_REJECTED, stats.rejected);
+		}
+	}
+	//no CR/LF, the idle line ends the reply, after a poll reply the turn
+	if(rxIdle && written == rxWritten)
+	{
+		rxIdle = false;
+		if(link_receiveIdle(&receiver) == LINK_RX_TEXT)
+		{
+			stats.commands++;
+			handle_command(receiver.data);
+		}
+		schedule_idle();
+	}
 }
-static void clear_buffer_overflow(UART_HandleTypeDef *huart)
+/*
+ * Reception was aborted (overrun ends the DMA transfer), restart it at the
+ * beginning of the ring
+ */
+static void uart_errorCallback(UART_HandleTypeDef *huart)
 {
-	__HAL_UART_CLEAR_OREFLAG(huart);
-	//Discard Data
-	__HAL_UART_SEND_REQ(huart, UART_RXDATA_FLUSH_REQUEST);
+	stats.errors++;
+	if(huart->ErrorCode & HAL_UART_ERROR_ORE)
+		stats.overruns++;
+	LOG_WARN(UART_ERROR, huart->ErrorCode);
+	if(huart->RxState != HAL_UART_STATE_READY)
+		return; //noise or framing error, the DMA is still running
+	rxWritten += (RX_RING_SIZE - rxWritten % RX_RING_SIZE) % RX_RING_SIZE;
+	rxRestart = rxWritten;
+	rxPosition = 0;
+	HAL_UARTEx_ReceiveToIdle_DMA(huart, rxRing, RX_RING_SIZE);
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_RX_FLAG);
 }
 
 /* Functions -----------------------------------------------------------------*/
 /**
- *  @brief Initiates uart message queue + receive to idle
+ *  @brief Initiates the protocol task and the circular DMA reception with idle
+ *  	   line detection, gates the TX ring to the turns of the sensor nodes
  *  @param None
- *  @return UART_CREATION_t to make sure queue was created, check for UART_ERROR
+ *  @return UART_CREATION_t to make sure task was created, check for UART_ERROR
  */
 UART_CREATION_t init_uart(void)
 {
-	UartUpdateQueueHandle = osMessageQueueNew(2, sizeof(struct MEASUREMENT_S), &UartUpdateQueue_attributes);
-	if(UartUpdateQueueHandle == NULL)
-		 return UART_ERROR;
+	link_resetReceiver(&receiver);
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+		link_arqInit(&arq[i], LINK_ARQ_WINDOW, link_output, NULL);
+	link_schedulerInit(&scheduler, SENSOR_NODES, osKernelGetTickCount());
+	printf_setGated(true);
+	linkMutex = osMutexNew(&linkMutex_attributes);
+	if(linkMutex == NULL)
+		return UART_ERROR;
+	protocolTaskHandle = osThreadNew(StartProtocolTask, NULL, &protocolTask_attributes);
+	if(protocolTaskHandle == NULL)
+		return UART_ERROR;
 
 	//register own callback function (needs a setting in .ioc file to work)
 	HAL_UART_RegisterRxEventCallback(&huart1,uart_callback);
-	HAL_UARTEx_ReceiveToIdle_IT(&huart1, (uint8_t*)RxData, RX_BUFFER_SIZE);
+	HAL_UART_RegisterCallback(&huart1, HAL_UART_ERROR_CB_ID, uart_errorCallback);
+	HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rxRing, RX_RING_SIZE);
 	return UART_CREATED;
 }
-/* Functions -----------------------------------------------------------------*/
 /**
- *  @brief Callback of UART Rx Complete
+ *  @brief Parses everything the DMA received, woken up by the uart callback,
+ *  	   retransmits frames that were not acked in time and polls the sensor
+ *  	   nodes one after the other
+ *  @param None
+ *  @return None
+ */
+void StartProtocolTask(void *argument)
+{
+	uint32_t timeout = 0;
+	uint32_t scheduleTimeout;
+	for(;;)
+	{
+		osThreadFlagsWait(PROTOCOL_RX_FLAG | PROTOCOL_LINK_FLAG, osFlagsWaitAny, timeout);
+		process_received();
+		timeout = link_poll();
+		scheduleTimeout = schedule_poll();
+		if(scheduleTimeout < timeout)
+			timeout = scheduleTimeout;
+	}
+}
+/**
+ *  @brief Copy of the receive counters
+ *  @param UART_STATS_t* copy
+ *  @return None
+ */
+void uart_getStats(UART_STATS_t* copy)
+{
+	copy->frames = stats.frames;
+	copy->commands = stats.commands;
+	copy->dropped = stats.dropped;
+	copy->rejected = stats.rejected;
+	copy->crc = stats.crc;
+	copy->errors = stats.errors;
+	copy->overruns = stats.overruns;
+	copy->bytes = rxWritten - rxCleared;
+}
+/**
+ *  @brief Callback of UART Rx Event (idle line, half and complete transfer of
+ *  	   the ring), only counts the new bytes and wakes the protocol task
  *  @param UART_HandleTypeDef *huart, uint16_t size
  *  @return None
  */
 void uart_callback(UART_HandleTypeDef *huart, uint16_t size)
 {
-	if(RxData[0]=='M'&&RxData[1]=='E'&&RxData[2]=='A'&&RxData[3]==':')
-	{
-		struct MEASUREMENT_S CurrentValues;
-		CurrentValues.red = 0;
-		CurrentValues.green = 0;
-		CurrentValues.blue = 0;
-		CurrentValues.clear = 0;
-		CurrentValues.infrared = 0;
-		int r,g,b,c,ir;
-		sscanf(RxData, "MEA:%u,%u,%u,%u,%u\r\n", &r, &g, &b, &ir, &c);
-		CurrentValues.red = r;
-		CurrentValues.green = g;
-		CurrentValues.blue = b;
-		CurrentValues.clear = c;
-		CurrentValues.infrared = ir;
-		osMessageQueuePut(UartUpdateQueueHandle, &CurrentValues, 0, 0);
-		osEventFlagsSet(colorUpdateEventHandle,MEASUREMENT_DONE);
+	//size is the DMA position in the ring (RX_RING_SIZE at transfer complete)
+	uint16_t position = size % RX_RING_SIZE;
+	rxWritten += (position + RX_RING_SIZE - rxPosition) % RX_RING_SIZE;
+	rxPosition = position;
+	rxTime = clock_micros();
+	rxTimeWritten = rxWritten;
+	if(HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE)
+		rxIdle = true;
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_RX_FLAG);
+}
+/**
+ *  @brief Copy of the counters and round trip time of the link layer, summed
+ *  	   over all sensor nodes, the slowest round trip of them
+ *  @param LINK_ARQ_STATS_t* copy
+ *  @return None
+ */
+void uart_getLinkStats(LINK_ARQ_STATS_t* copy)
+{
+	LINK_ARQ_STATS_t node;
 
+	memset(copy, 0, sizeof(*copy));
+	osMutexAcquire(linkMutex, osWaitForever);
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+	{
+		link_arqGetStats(&arq[i], &node);
+		copy->sent += node.sent;
+		copy->retransmitted += node.retransmitted;
+		copy->acked += node.acked;
+		copy->lost += node.lost;
+		copy->timeouts += node.timeouts;
+		copy->resyncs += node.resyncs;
+		copy->delivered += node.delivered;
+		copy->duplicates += node.duplicates;
+		copy->acks += node.acks;
+		if(node.srtt > copy->srtt)
+		{
+			copy->srtt = node.srtt;
+			copy->rttvar = node.rttvar;
+		}
+		if(node.rto > copy->rto)
+			copy->rto = node.rto;
 	}
-	//Restart receive to idle
-	if(check_for_buffer_overflow(&huart1))
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Clears the receive counters, the counters of the link layer and the
+ *  	   round trip time histogram, e.g. after changing baud rate or window
+ *  @param None
+ *  @return None
+ */
+void uart_resetStats(void)
+{
+	stats.frames = 0;
+	stats.commands = 0;
+	stats.dropped = 0;
+	stats.rejected = 0;
+	stats.crc = 0;
+	stats.errors = 0;
+	stats.overruns = 0;
+	rxCleared = rxWritten; //rxWritten itself keeps counting, the receiver reads the ring with it
+	osMutexAcquire(linkMutex, osWaitForever);
+	for(uint8_t i = 0; i < SENSOR_NODES; i++)
+		link_arqResetStats(&arq[i]);
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Copy of the round trip time histogram of the link layer (ms), all
+ *  	   sensor nodes in one
+ *  @param HISTOGRAM_t* copy, about 200 bytes, better static than on the stack
+ *  @return None
+ */
+void uart_getLinkRtt(HISTOGRAM_t* copy)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	link_arqGetRtt(&arq[0], copy);
+	for(uint8_t i = 1; i < SENSOR_NODES; i++)
 	{
-		printf("MEA:\r\n");
-		clear_buffer_overflow(&huart1);
+		const HISTOGRAM_t* node = &arq[i].rtt;
+		if(node->count == 0)
+			continue;
+		for(uint8_t j = 0; j < HISTOGRAM_BUCKETS; j++)
+			copy->counts[j] += node->counts[j];
+		if(copy->count == 0 || node->min < copy->min)
+			copy->min = node->min;
+		if(node->max > copy->max)
+			copy->max = node->max;
+		copy->count += node->count;
+		copy->sum += node->sum;
 	}
-	HAL_UARTEx_ReceiveToIdle_IT(&huart1,(uint8_t*)RxData,RX_BUFFER_SIZE);
-
-
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Copy of the scheduler: nodes present, cycle time and the counters
+ *  	   of every node
+ *  @param LINK_SCHEDULER_t* copy
+ *  @return None
+ */
+void uart_getSchedule(LINK_SCHEDULER_t* copy)
+{
+	osMutexAcquire(linkMutex, osWaitForever);
+	*copy = scheduler;
+	osMutexRelease(linkMutex);
+}
+/**
+ *  @brief Sends one binary frame with sequence number to the sensor node of
+ *  	   its address, it is retransmitted until the node acks it. Waits while
+ *  	   LINK_ARQ_WINDOW frames are in flight, the protocol task itself drops
+ *  	   the frame instead.
+ *  @param const LINK_MESSAGE_t* message, address 1..SENSOR_NODES
+ *  @return None
+ */
+void uart_sendMessage(const LINK_MESSAGE_t* message)
+{
+	LINK_ARQ_STATUS_t status;
+	if(message->address < 1 || message->address > SENSOR_NODES)
+	{
+		LOG_WARN(LINK_DROPPED, message->type);
+		return;
+	}
+	for(;;)
+	{
+		osMutexAcquire(linkMutex, osWaitForever);
+		status = link_arqSend(&arq[message->address - 1], message, osKernelGetTickCount());
+		osMutexRelease(linkMutex);
+		if(status == LINK_ARQ_OK)
+			break;
+		//only the protocol task handles the acks that free the window
+		if(osThreadGetId() == protocolTaskHandle)
+		{
+			LOG_WARN(LINK_DROPPED, message->type);
+			return;
+		}
+		osDelay(LINK_SEND_RETRY_MS);
+	}
+	//starts the retransmission timer
+	osThreadFlagsSet(protocolTaskHandle, PROTOCOL_LINK_FLAG);
+}
+/**
+ *  @brief Sends a request with r,g,b payload (LINK_MSG_COLOR, LINK_MSG_REFLECTANCE)
+ *  	   to the first sensor node, LINK_MSG_MEASURE is sent without payload
+ *  @param uint8_t type
+ *  @param uint8_t id correlation id, LINK_ID_NONE if no reply is expected
+ *  @param uint8_t red, uint8_t green, uint8_t blue
+ *  @return None
+ */
+void uart_sendColor(uint8_t type, uint8_t id, uint8_t red, uint8_t green, uint8_t blue)
+{
+	LINK_MESSAGE_t message;
+	message.type = type;
+	message.address = LINK_NODE_DEFAULT;
+	message.id = id;
+	message.length = (type == LINK_MSG_MEASURE || type == LINK_MSG_MEASURE_RAW) ? 0 : 3;
+	message.payload[0] = red;
+	message.payload[1] = green;
+	message.payload[2] = blue;
+	uart_sendMessage(&message);
 }
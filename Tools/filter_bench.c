@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    filter_bench.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Host check of the streaming filter (filter_window.c): moving
+  * 		 average, median and EMA against a naive reference that keeps
+  * 		 every sample (sum, sort and floating point recursion of the whole
+  * 		 window per sample), window 1 to FILTER_MAX_WINDOW, random values
+  * 		 with steps and the 32 bit extremes, then the time per sample (all
+  * 		 5 channels) of every filter. Exit code is non-zero on any
+  * 		 difference.
+  *
+  * 		 gcc -O2 -IProject_LightSensor/Core/Inc -o filter_bench Tools/filter_bench.c Project_LightSensor/Core/Src/filter_window.c -lm
+  *
+  * 		 filter_bench [samples]
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L //clock_gettime with -std=c11
+#include "filter_window.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_SAMPLES 2000000
+#define BENCH_CHECK_SAMPLES 5000 //per filter and window
+#define BENCH_EMA_TOLERANCE 1 //counts, Q8 state truncates every step
+
+/* Globals -------------------------------------------------------------------*/
+static const FILTER_MODE_t modes[] = { FILTER_NONE, FILTER_AVERAGE, FILTER_MEDIAN, FILTER_EMA };
+static uint32_t seed = 12345;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+static uint32_t random_value(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+/*
+ * Sample n of channel c: noise around levels that step every few hundred
+ * samples, now and then 0 or UINT32_MAX (sums and medians must not overflow)
+ */
+static uint32_t sample_of(uint32_t n, uint8_t c)
+{
+	uint32_t r = random_value();
+	if(r % 97 == 0)
+		return (r & 0x100) ? UINT32_MAX : 0;
+	uint32_t level = ((n / 300) % 4) * 100000 + c * 1000;
+	return level + r % 4096;
+}
+static int compare_values(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+/*
+ * The filter written out: last samples kept in full, the result computed from
+ * scratch with the same rounding
+ */
+static uint32_t reference(FILTER_MODE_t mode, uint8_t window, const uint32_t* history, uint32_t n, double* ema)
+{
+	uint8_t length = (n + 1 < window) ? (uint8_t)(n + 1) : window;
+	const uint32_t* last = &history[n + 1 - length];
+	uint32_t sorted[FILTER_MAX_WINDOW];
+	uint64_t sum = 0;
+
+	if(mode == FILTER_AVERAGE)
+	{
+		for(uint8_t i = 0; i < length; i++)
+			sum += last[i];
+		return (uint32_t)((sum + length / 2) / length);
+	}
+	if(mode == FILTER_MEDIAN)
+	{
+		memcpy(sorted, last, length * sizeof(uint32_t));
+		qsort(sorted, length, sizeof(uint32_t), compare_values);
+		if(length & 1)
+			return sorted[length / 2];
+		return (uint32_t)(((uint64_t)sorted[length / 2 - 1] + sorted[length / 2] + 1) / 2);
+	}
+	if(mode == FILTER_EMA)
+	{
+		//alpha as the filter has it in Q8, 2/(n+1) rounded down
+		double alpha = (double)((2 << FILTER_EMA_BITS) / (window + 1)) / (1 << FILTER_EMA_BITS);
+		*ema = (n == 0) ? history[n] : *ema + (history[n] - *ema) * alpha;
+		return (uint32_t)llround(*ema);
+	}
+	return history[n];
+}
+/*
+ * Feeds the same samples to the filter and the reference, returns the samples
+ * that differ
+ */
+static uint32_t check_filter(FILTER_MODE_t mode, uint8_t window)
+{
+	static uint32_t history[FILTER_CHANNELS][BENCH_CHECK_SAMPLES];
+	static FILTER_WINDOW_t filter;
+	double ema[FILTER_CHANNELS];
+	uint32_t values[FILTER_CHANNELS];
+	uint32_t differences = 0;
+
+	filter_windowInit(&filter, mode, window);
+	for(uint32_t n = 0; n < BENCH_CHECK_SAMPLES; n++)
+	{
+		for(uint8_t c = 0; c < FILTER_CHANNELS; c++)
+			values[c] = history[c][n] = sample_of(n, c);
+		filter_windowAdd(&filter, values);
+		for(uint8_t c = 0; c < FILTER_CHANNELS; c++)
+		{
+			uint32_t expected = reference(mode, window, history[c], n, &ema[c]);
+			uint32_t error = (values[c] > expected) ? values[c] - expected : expected - values[c];
+			if(error <= ((mode == FILTER_EMA) ? BENCH_EMA_TOLERANCE : 0))
+				continue;
+			if(differences++ < 10)
+				printf("%c,%u sample %lu channel %u: filter %lu reference %lu\n", mode, window, (unsigned long)n, c,
+						(unsigned long)values[c], (unsigned long)expected);
+		}
+	}
+	return differences;
+}
+/*
+ * ns per sample (all channels) over samples
+ */
+static double time_filter(FILTER_MODE_t mode, uint8_t window, uint32_t samples)
+{
+	static FILTER_WINDOW_t filter;
+	static uint32_t inputs[1024][FILTER_CHANNELS];
+	uint32_t values[FILTER_CHANNELS];
+	volatile uint32_t sink = 0;
+
+	for(uint16_t n = 0; n < 1024; n++)
+		for(uint8_t c = 0; c < FILTER_CHANNELS; c++)
+			inputs[n][c] = sample_of(n, c);
+	filter_windowInit(&filter, mode, window);
+	uint64_t start = now_ns();
+	for(uint32_t n = 0; n < samples; n++)
+	{
+		memcpy(values, inputs[n % 1024], sizeof(values));
+		filter_windowAdd(&filter, values);
+		sink += values[n % FILTER_CHANNELS];
+	}
+	(void)sink;
+	return (double)(now_ns() - start) / samples;
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint32_t samples = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_SAMPLES;
+	const uint8_t windows[] = { 1, 4, 8, FILTER_MAX_WINDOW };
+	uint32_t differences = 0;
+
+	for(uint8_t m = 1; m < sizeof(modes) / sizeof(modes[0]); m++)
+		for(uint8_t window = 1; window <= FILTER_MAX_WINDOW; window++)
+			differences += check_filter(modes[m], window);
+	differences += check_filter(FILTER_NONE, 1);
+	printf("A, M, E with windows 1...%u against the reference: %lu differences\n", FILTER_MAX_WINDOW,
+			(unsigned long)differences);
+
+	printf("%-8s %6s %10s\n", "filter", "window", "ns/sample");
+	for(uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		for(uint8_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+		{
+			if(modes[m] == FILTER_NONE && w > 0)
+				break;
+			printf("%-8c %6u %10.2f\n", modes[m], windows[w], time_filter(modes[m], windows[w], samples));
+		}
+	return (differences == 0) ? 0 : 1;
+}
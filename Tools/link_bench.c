@@ -0,0 +1,216 @@
+/**
+  ******************************************************************************
+  * @file    link_bench.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   One end of the reliable link (Common/Src/link_arq.c) on a Linux
+  * 		 serial port or pty, for testing without boards. The sender sends
+  * 		 numbered frames as fast as the window allows, the receiver checks
+  * 		 that every one arrives once and in order. Both print one line of
+  * 		 results, link_bench.py runs them over link_impair.py.
+  *
+  * 		 gcc -O2 -ICommon/Inc -o link_bench Tools/link_bench.c Common/Src/link_arq.c Common/Src/link_codec.c Common/Src/histogram.c
+  *
+  * 		 link_bench send    /dev/pts/3 [frames] [window] [payload]
+  * 		 link_bench receive /dev/pts/4 [frames]
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#define _DEFAULT_SOURCE //cfmakeraw, cfsetspeed and clock_gettime with -std=c11
+#include "link_arq.h"
+#include "link_codec.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_FRAMES 500
+#define BENCH_IDLE_MS 5000 //receiver: no frame for this long ends the run
+#define BENCH_TIMEOUT_MS 600000 //sender: give up the whole run
+
+/* Globals -------------------------------------------------------------------*/
+static int port = -1;
+static LINK_ARQ_t arq;
+static LINK_RECEIVER_t receiver;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t now_ms(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint32_t)(time.tv_sec * 1000 + time.tv_nsec / 1000000);
+}
+static int open_port(const char* path)
+{
+	struct termios settings;
+	int fd = open(path, O_RDWR | O_NOCTTY);
+	if(fd < 0)
+		return -1;
+	if(tcgetattr(fd, &settings) == 0)
+	{
+		cfmakeraw(&settings);
+		cfsetspeed(&settings, B57600);
+		tcsetattr(fd, TCSANOW, &settings);
+	}
+	return fd;
+}
+/*
+ * Output of link_arq: the frame is written at once, like printf_write
+ */
+static void write_frame(void* context, const LINK_MESSAGE_t* message)
+{
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length = link_encode(message, frame, sizeof(frame));
+	uint16_t written = 0;
+
+	(void)context;
+
+	while(written < length)
+	{
+		ssize_t result = write(port, frame + written, length - written);
+		if(result < 0 && errno != EINTR && errno != EAGAIN)
+			return;
+		if(result > 0)
+			written += result;
+	}
+}
+/*
+ * Waits for bytes until the next retransmission is due, hands complete frames
+ * to link_arq and calls deliver for the data frames it passes on
+ */
+static void run_once(uint32_t limit, void (*deliver)(const LINK_MESSAGE_t* message))
+{
+	struct pollfd fds = { port, POLLIN, 0 };
+	uint8_t bytes[256];
+	LINK_MESSAGE_t message;
+	uint32_t timeout = link_arqNextTimeout(&arq, now_ms());
+
+	if(timeout > limit)
+		timeout = limit;
+	if(poll(&fds, 1, (int)timeout) > 0)
+	{
+		ssize_t count = read(port, bytes, sizeof(bytes));
+		for(ssize_t i = 0; i < count; i++)
+		{
+			if(link_receive(&receiver, bytes[i]) != LINK_RX_FRAME)
+				continue;
+			if(link_decode((uint8_t*)receiver.data, receiver.length, &message) != LINK_OK)
+				continue;
+			if(link_arqReceive(&arq, &message, now_ms()) && deliver != NULL)
+				deliver(&message);
+		}
+	}
+	link_arqPoll(&arq, now_ms());
+}
+static void print_stats(const char* role, uint32_t frames, uint32_t bytes, uint32_t elapsed, uint32_t errors)
+{
+	LINK_ARQ_STATS_t stats;
+	HISTOGRAM_t rtt;
+	link_arqGetStats(&arq, &stats);
+	link_arqGetRtt(&arq, &rtt);
+	printf("%s frames=%lu bytes=%lu ms=%lu goodput=%.1f errors=%lu sent=%lu retransmitted=%lu acked=%lu lost=%lu timeouts=%lu "
+			"resyncs=%lu delivered=%lu duplicates=%lu acks=%lu srtt=%lu rttvar=%lu rto=%lu rtt50=%lu rtt99=%lu rttmax=%lu\n",
+			role, (unsigned long)frames, (unsigned long)bytes, (unsigned long)elapsed,
+			elapsed ? bytes * 1000.0 / elapsed : 0.0, (unsigned long)errors,
+			(unsigned long)stats.sent, (unsigned long)stats.retransmitted, (unsigned long)stats.acked,
+			(unsigned long)stats.lost, (unsigned long)stats.timeouts, (unsigned long)stats.resyncs,
+			(unsigned long)stats.delivered, (unsigned long)stats.duplicates, (unsigned long)stats.acks,
+			(unsigned long)stats.srtt, (unsigned long)stats.rttvar, (unsigned long)stats.rto,
+			(unsigned long)histogram_percentile(&rtt, 50), (unsigned long)histogram_percentile(&rtt, 99), (unsigned long)rtt.max);
+	fflush(stdout);
+}
+
+static uint32_t received = 0;
+static uint32_t receivedBytes = 0;
+static uint32_t errors = 0;
+static uint32_t lastFrame = 0;
+//frames carry their number in the first four bytes
+static void check_frame(const LINK_MESSAGE_t* message)
+{
+	uint32_t number = 0;
+	if(message->length >= 4)
+		memcpy(&number, message->payload, 4);
+	if(message->length < 4 || number != received)
+		errors++;
+	received++;
+	receivedBytes += message->length;
+	lastFrame = now_ms();
+}
+
+static int bench_send(uint32_t frames, uint8_t window, uint8_t payload)
+{
+	LINK_MESSAGE_t message;
+	LINK_ARQ_STATS_t stats;
+	uint32_t next = 0;
+	uint32_t start = now_ms();
+
+	link_arqInit(&arq, window, write_frame, NULL);
+	memset(&message, 0, sizeof(message));
+	message.type = LINK_MSG_COLOR;
+	message.length = payload;
+	for(;;)
+	{
+		while(next < frames)
+		{
+			memcpy(message.payload, &next, 4);
+			if(link_arqSend(&arq, &message, now_ms()) != LINK_ARQ_OK)
+				break;
+			next++;
+		}
+		link_arqGetStats(&arq, &stats);
+		if(stats.acked + stats.lost >= frames || now_ms() - start > BENCH_TIMEOUT_MS)
+			break;
+		run_once(LINK_ARQ_RTO_MAX, NULL);
+	}
+	print_stats("send", stats.acked, stats.acked * payload, now_ms() - start, stats.lost);
+	return (stats.acked == frames) ? 0 : 1;
+}
+static int bench_receive(uint32_t frames)
+{
+	uint32_t start = 0;
+
+	link_arqInit(&arq, LINK_ARQ_WINDOW, write_frame, NULL);
+	lastFrame = now_ms();
+	//keeps acking after the last frame, the sender may have missed the ack
+	while(now_ms() - lastFrame < BENCH_IDLE_MS)
+	{
+		run_once(100, check_frame);
+		if(received == 1 && start == 0)
+			start = lastFrame;
+	}
+	print_stats("receive", received, receivedBytes, lastFrame - start, errors + (received < frames ? frames - received : 0));
+	return (errors == 0 && received >= frames) ? 0 : 1;
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint32_t frames = (argc > 3) ? strtoul(argv[3], NULL, 0) : BENCH_FRAMES;
+	uint8_t window = (argc > 4) ? strtoul(argv[4], NULL, 0) : LINK_ARQ_WINDOW;
+	uint8_t payload = (argc > 5) ? strtoul(argv[5], NULL, 0) : LINK_MAX_PAYLOAD;
+
+	if(argc < 3 || (strcmp(argv[1], "send") != 0 && strcmp(argv[1], "receive") != 0))
+	{
+		fprintf(stderr, "usage: %s send|receive <tty> [frames] [window] [payload]\n", argv[0]);
+		return 2;
+	}
+	if(payload < 4 || payload > LINK_MAX_PAYLOAD)
+		payload = LINK_MAX_PAYLOAD;
+	port = open_port(argv[2]);
+	if(port < 0)
+	{
+		perror(argv[2]);
+		return 2;
+	}
+	link_resetReceiver(&receiver);
+	if(strcmp(argv[1], "send") == 0)
+		return bench_send(frames, window, payload);
+	return bench_receive(frames);
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Goodput of the reliable link (Common/Src/link_arq.c) versus frame loss.
+
+For every loss rate a pty pair with link_impair.py is set up, link_bench
+receives on one end and sends on the other, the results of the sender are
+printed as one row. link_bench is built with gcc when it is missing.
+
+    python3 Tools/link_bench.py
+    python3 Tools/link_bench.py --loss 0 0.05 0.1 0.2 --frames 300 --window 1 4 8
+"""
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(TOOLS, "..")
+SOURCES = [os.path.join(TOOLS, "link_bench.c"),
+           os.path.join(ROOT, "Common", "Src", "link_arq.c"),
+           os.path.join(ROOT, "Common", "Src", "link_codec.c"),
+           os.path.join(ROOT, "Common", "Src", "histogram.c")]
+HEADERS = [os.path.join(ROOT, "Common", "Inc", "link_arq.h"),
+           os.path.join(ROOT, "Common", "Inc", "link_codec.h"),
+           os.path.join(ROOT, "Common", "Inc", "histogram.h")]
+
+
+def build(binary):
+    if os.path.exists(binary) and all(os.path.getmtime(binary) >= os.path.getmtime(s) for s in SOURCES + HEADERS):
+        return
+    subprocess.run(["gcc", "-O2", "-I" + os.path.join(ROOT, "Common", "Inc"), "-o", binary] + SOURCES, check=True)
+
+
+def parse(line):
+    """'send frames=.. bytes=..' -> dict of numbers"""
+    fields = line.split()
+    return {key: float(value) for key, value in (field.split("=") for field in fields[1:])}
+
+
+def measure(args, binary, loss, window):
+    impair = subprocess.Popen([sys.executable, os.path.join(TOOLS, "link_impair.py"), "--loss", str(loss),
+                               "--corrupt", str(args.corrupt), "--delay", str(args.delay), "--baud", str(args.baud),
+                               "--seed", str(args.seed)],
+                              stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+    try:
+        name_a, _, name_b = impair.stdout.readline().split()
+        receiver = subprocess.Popen([binary, "receive", name_b, str(args.frames)],
+                                    stdout=subprocess.PIPE, text=True)
+        time.sleep(0.2)
+        sender = subprocess.run([binary, "send", name_a, str(args.frames), str(window), str(args.payload)],
+                                stdout=subprocess.PIPE, text=True)
+        receiver.terminate()
+        received = receiver.communicate()[0].strip()
+        result = parse(sender.stdout.strip())
+        result["ok"] = sender.returncode == 0 and (not received or parse(received)["errors"] == 0)
+        return result
+    finally:
+        impair.terminate()
+        impair.wait()
+
+
+def main():
+    arguments = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    arguments.add_argument("--loss", type=float, nargs="+", default=[0, 0.01, 0.05, 0.1, 0.2, 0.3])
+    arguments.add_argument("--window", type=int, nargs="+", default=[4])
+    arguments.add_argument("--frames", type=int, default=200)
+    arguments.add_argument("--payload", type=int, default=24, help="bytes per frame, 4 to 24")
+    arguments.add_argument("--corrupt", type=float, default=0.0)
+    arguments.add_argument("--delay", type=float, default=20.0, help="ms per direction")
+    arguments.add_argument("--baud", type=float, default=57600)
+    arguments.add_argument("--seed", type=int, default=1)
+    arguments.add_argument("--binary", default=os.path.join("/tmp", "link_bench"))
+    args = arguments.parse_args()
+
+    build(args.binary)
+    print(f"{'window':>6} {'loss':>5} {'goodput B/s':>11} {'of line':>7} {'retx':>5} {'timeouts':>8} "
+          f"{'srtt ms':>7} {'rto ms':>6} {'rtt 50%':>7} {'rtt 99%':>7} {'ok':>3}")
+    line_rate = args.baud / 10 * args.payload / (args.payload + 11)  # header, CRC, COBS and delimiters
+    for window in args.window:
+        for loss in args.loss:
+            r = measure(args, args.binary, loss, window)
+            print(f"{window:>6} {loss:>5.2f} {r['goodput']:>11.0f} {r['goodput'] / line_rate:>7.0%} "
+                  f"{r['retransmitted']:>5.0f} {r['timeouts']:>8.0f} {r['srtt']:>7.0f} {r['rto']:>6.0f} "
+                  f"{r['rtt50']:>7.0f} {r['rtt99']:>7.0f} "
+                  f"{'yes' if r['ok'] else 'NO':>3}", flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Lossy virtual serial link between two ptys, a stand-in for the telemetry
+radio pair when testing the link layer (Common/Src/link_arq.c) on Linux.
+
+Bytes are passed on at the given baud rate and latency. Frames (0x00
+delimited, see Common/Src/link_codec.c) are dropped with the loss
+probability, single bytes are flipped with the corruption probability.
+Both directions are impaired the same way, independently. Bytes are held
+until the next delimiter, so ASCII commands do not pass.
+
+    python3 Tools/link_impair.py --loss 0.1 --delay 20
+    /dev/pts/3 <-> /dev/pts/4
+    ./link_bench receive /dev/pts/4 & ./link_bench send /dev/pts/3
+"""
+import argparse
+import os
+import random
+import select
+import signal
+import sys
+import time
+import tty
+
+LINK_DELIMITER = 0x00
+
+
+class Direction:
+    """One way of the link: frame loss, corruption, latency and line rate."""
+
+    def __init__(self, source, sink, args, rng):
+        self.source = source
+        self.sink = sink
+        self.args = args
+        self.rng = rng
+        self.frame = bytearray()
+        self.queue = []  # (due time, bytes)
+        self.line_free = 0.0
+        self.frames = 0
+        self.dropped = 0
+        self.corrupted = 0
+
+    def receive(self, data, now):
+        for byte in data:
+            self.frame.append(byte)
+            if byte == LINK_DELIMITER:
+                self.end_frame(now)
+
+    def end_frame(self, now):
+        frame, self.frame = bytes(self.frame), bytearray()
+        if len(frame) > 1:
+            self.frames += 1
+            if self.rng.random() < self.args.loss:
+                self.dropped += 1
+                return
+        if self.args.corrupt > 0:
+            frame = bytearray(frame)
+            for i in range(len(frame)):
+                if self.rng.random() < self.args.corrupt:
+                    frame[i] ^= 1 << self.rng.randrange(8)
+                    self.corrupted += 1
+            frame = bytes(frame)
+        # the line sends one byte after the other, the radio adds its latency
+        start = max(now, self.line_free)
+        self.line_free = start + len(frame) * 10 / self.args.baud
+        self.queue.append((self.line_free + self.args.delay / 1000, frame))
+
+    def flush(self, now):
+        while self.queue and self.queue[0][0] <= now:
+            os.write(self.sink, self.queue.pop(0)[1])
+
+    def next_due(self):
+        return self.queue[0][0] if self.queue else None
+
+
+def open_pty():
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    tty.setraw(master)
+    return master, slave, os.ttyname(slave)
+
+
+def run(args, ready=None):
+    """Shuttles bytes until killed, ready(name_a, name_b) is called once the ptys exist."""
+    rng = random.Random(args.seed)
+    master_a, slave_a, name_a = open_pty()
+    master_b, slave_b, name_b = open_pty()
+    directions = {master_a: Direction(master_a, master_b, args, rng),
+                  master_b: Direction(master_b, master_a, args, rng)}
+    signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
+    if ready is not None:
+        ready(name_a, name_b)
+    else:
+        print(f"{name_a} <-> {name_b}", flush=True)
+
+    try:
+        while True:
+            now = time.monotonic()
+            dues = [d.next_due() for d in directions.values() if d.next_due() is not None]
+            timeout = max(0.0, min(dues) - now) if dues else 0.5
+            readable, _, _ = select.select(list(directions), [], [], timeout)
+            now = time.monotonic()
+            for fd in readable:
+                try:
+                    data = os.read(fd, 512)
+                except OSError:
+                    continue  # no one has the slave open
+                directions[fd].receive(data, now)
+            for direction in directions.values():
+                direction.flush(now)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for name, direction in (("a->b", directions[master_a]), ("b->a", directions[master_b])):
+            print(f"{name}: frames {direction.frames} dropped {direction.dropped} "
+                  f"corrupted bytes {direction.corrupted}", file=sys.stderr)
+        for fd in (master_a, slave_a, master_b, slave_b):
+            os.close(fd)
+
+
+def parser():
+    arguments = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    arguments.add_argument("--loss", type=float, default=0.0, help="probability a frame is dropped")
+    arguments.add_argument("--corrupt", type=float, default=0.0, help="probability a byte is flipped")
+    arguments.add_argument("--delay", type=float, default=20.0, help="latency in ms per direction")
+    arguments.add_argument("--baud", type=float, default=57600, help="line rate, 10 bits per byte")
+    arguments.add_argument("--seed", type=int, default=None)
+    return arguments
+
+
+if __name__ == "__main__":
+    run(parser().parse_args())
@@ -0,0 +1,770 @@
+/**
+  ******************************************************************************
+  * @file    link_test.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Host test of the link codec (Common/Src/link_codec.c): round
+  * 		 trip of every payload length, CRC, rejection of corrupted,
+  * 		 truncated, wrong length and oversize frames, the receiver with
+  * 		 lost delimiters, overflow and idle line, and the packed sample.
+  * 		 The link layer (link_arq.c) recovers from a restart of the peer at
+  * 		 any sequence and ignores stale frames of an old session.
+  * 		 The transmit ring of printf.c (tx_ring.c) behind a simulated DMA:
+  * 		 wrap-around, overwrite of queued messages and messages larger than
+  * 		 the free space under every overflow policy.
+  * 		 Prints every failed check, the exit code is non-zero if any failed.
+  *
+  * 		 gcc -O2 -ICommon/Inc -o link_test Tools/link_test.c Common/Src/link_codec.c Common/Src/link_arq.c Common/Src/histogram.c Common/Src/tx_ring.c
+  *
+  * 		 link_test
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "link_codec.h"
+#include "link_arq.h"
+#include "tx_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define CHECK(condition) check((condition), #condition, __LINE__)
+#define TEST_GUARD 0xA5 //fills the bytes behind a decoded message, must stay untouched
+#define TEST_PIPE_SIZE 64 //frames on the way in one direction
+#define TEST_STEP_MS 10 //time per exchange of the ARQ pair
+#define TEST_WIRE_SIZE 65536 //bytes the simulated DMA sends in one ring test
+#define TEST_TX_MESSAGES 2000 //messages written in one ring test
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct GuardedMessage
+{
+	LINK_MESSAGE_t message;
+	uint8_t guard[16];
+}GUARDED_MESSAGE_t;
+
+//frames one side of the ARQ pair sent, in order
+typedef struct TestPipe
+{
+	LINK_MESSAGE_t frames[TEST_PIPE_SIZE];
+	uint8_t count;
+}TEST_PIPE_t;
+
+//DMA behind the transmit ring, sends into wire
+typedef struct TestDma
+{
+	const uint8_t* data; //running transfer, NULL if idle
+	uint16_t length;
+	uint8_t copy[TX_RING_SIZE]; //of the running transfer when it started
+	uint8_t wire[TEST_WIRE_SIZE];
+	uint32_t sent;
+	uint32_t transfers;
+	uint32_t wraps; //transfers that ended at the end of the ring
+}TEST_DMA_t;
+
+//messages written into the transmit ring, in order
+typedef struct TestMessages
+{
+	uint16_t lengths[TEST_TX_MESSAGES];
+	uint32_t count;
+}TEST_MESSAGES_t;
+
+/* Globals -------------------------------------------------------------------*/
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+static uint32_t seed = 12345;
+
+/* Private Functions ---------------------------------------------------------*/
+static void check(_Bool condition, const char* text, int line)
+{
+	checks++;
+	if(condition)
+		return;
+	failures++;
+	if(failures <= 20)
+		printf("line %d: %s failed\n", line, text);
+}
+static uint8_t random_byte(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (uint8_t)(seed >> 16);
+}
+/*
+ * Message with every header field set and a payload with zeros, 0xFF and
+ * random bytes, so COBS has something to replace
+ */
+static void make_message(LINK_MESSAGE_t* message, uint8_t length)
+{
+	memset(message, 0, sizeof(*message));
+	message->type = LINK_MSG_SAMPLE;
+	message->address = 3;
+	message->id = 0x5A;
+	message->session = 0x80;
+	message->sequence = length;
+	message->length = length;
+	for(uint8_t i = 0; i < length; i++)
+		message->payload[i] = (i % 5 == 0) ? 0x00 : (i % 7 == 0) ? 0xFF : random_byte();
+}
+static _Bool same_message(const LINK_MESSAGE_t* a, const LINK_MESSAGE_t* b)
+{
+	return a->type == b->type && a->address == b->address && a->id == b->id && a->session == b->session
+			&& a->sequence == b->sequence && a->length == b->length && memcmp(a->payload, b->payload, a->length) == 0;
+}
+/*
+ * Independent COBS encoder with delimiters, to build frames link_encode
+ * refuses to (wrong length byte, oversize payload)
+ */
+static uint16_t raw_frame(const uint8_t* plain, uint16_t length, uint8_t* frame)
+{
+	uint16_t code = 1;
+	uint16_t write = 2;
+
+	frame[0] = LINK_DELIMITER;
+	frame[code] = 1;
+	for(uint16_t i = 0; i < length; i++)
+	{
+		if(plain[i] == 0)
+		{
+			code = write++;
+			frame[code] = 1;
+			continue;
+		}
+		frame[write++] = plain[i];
+		if(++frame[code] == 0xFF)
+		{
+			code = write++;
+			frame[code] = 1;
+		}
+	}
+	frame[write++] = LINK_DELIMITER;
+	return write;
+}
+/*
+ * Header, payload and a valid CRC, the length byte is written as given
+ */
+static uint16_t crafted_frame(uint8_t lengthByte, uint16_t payload, uint8_t* frame)
+{
+	uint8_t plain[2 * LINK_MAX_FRAME];
+
+	memset(plain, 0, sizeof(plain));
+	plain[0] = LINK_MSG_COLOR;
+	plain[1] = 1;
+	plain[5] = lengthByte;
+	for(uint16_t i = 0; i < payload; i++)
+		plain[LINK_HEADER_SIZE + i] = (uint8_t)(i + 1);
+	uint16_t crc = link_crc16(plain, LINK_HEADER_SIZE + payload);
+	plain[LINK_HEADER_SIZE + payload] = crc >> 8;
+	plain[LINK_HEADER_SIZE + payload + 1] = crc & 0xFF;
+	return raw_frame(plain, LINK_HEADER_SIZE + payload + 2, frame);
+}
+/*
+ * Feeds bytes to the receiver, decodes every frame into messages
+ */
+static uint8_t feed(LINK_RECEIVER_t* receiver, const uint8_t* bytes, uint16_t length, LINK_MESSAGE_t* messages,
+		uint8_t size, uint8_t* texts)
+{
+	uint8_t count = 0;
+
+	for(uint16_t i = 0; i < length; i++)
+	{
+		LINK_RX_RESULT_t result = link_receive(receiver, bytes[i]);
+		if(result == LINK_RX_TEXT && texts != NULL)
+			(*texts)++;
+		if(result == LINK_RX_FRAME && count < size
+				&& link_decode((const uint8_t*)receiver->data, receiver->length, &messages[count]) == LINK_OK)
+			count++;
+	}
+	return count;
+}
+/*
+ * Output of the ARQ pair, the pipe is the context
+ */
+static void pipe_output(void* context, const LINK_MESSAGE_t* message)
+{
+	TEST_PIPE_t* pipe = (TEST_PIPE_t*)context;
+	if(pipe->count < TEST_PIPE_SIZE)
+		pipe->frames[pipe->count++] = *message;
+}
+/*
+ * Carries the frames of both directions until the line is quiet, returns the
+ * data frames the receiver passed on
+ */
+static uint32_t exchange(LINK_ARQ_t* sender, TEST_PIPE_t* toReceiver, LINK_ARQ_t* receiver, TEST_PIPE_t* toSender,
+		uint32_t now)
+{
+	uint32_t delivered = 0;
+	LINK_MESSAGE_t frames[TEST_PIPE_SIZE];
+
+	while(toReceiver->count > 0 || toSender->count > 0)
+	{
+		uint8_t count = toReceiver->count;
+		memcpy(frames, toReceiver->frames, count * sizeof(frames[0]));
+		toReceiver->count = 0;
+		for(uint8_t i = 0; i < count; i++)
+			delivered += link_arqReceive(receiver, &frames[i], now) ? 1 : 0;
+		count = toSender->count;
+		memcpy(frames, toSender->frames, count * sizeof(frames[0]));
+		toSender->count = 0;
+		for(uint8_t i = 0; i < count; i++)
+			link_arqReceive(sender, &frames[i], now);
+	}
+	return delivered;
+}
+/*
+ * Sends count frames from sender to receiver, with link_arqPoll until they are
+ * acked or given up, returns the ms it took
+ */
+static uint32_t transfer(LINK_ARQ_t* sender, TEST_PIPE_t* toReceiver, LINK_ARQ_t* receiver, TEST_PIPE_t* toSender,
+		uint8_t count, uint32_t* now, uint32_t* delivered)
+{
+	LINK_MESSAGE_t message;
+	uint32_t start = *now;
+
+	memset(&message, 0, sizeof(message));
+	message.type = LINK_MSG_COLOR;
+	message.address = 1;
+	message.length = 3;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		message.id = i;
+		CHECK(link_arqSend(sender, &message, *now) == LINK_ARQ_OK);
+	}
+	while(link_arqInFlight(sender) > 0 && *now - start < 60000)
+	{
+		*now += TEST_STEP_MS;
+		link_arqPoll(sender, *now);
+		*delivered += exchange(sender, toReceiver, receiver, toSender, *now);
+	}
+	return *now - start;
+}
+
+static void test_crc(void)
+{
+	CHECK(link_crc16((const uint8_t*)"123456789", 9) == 0x29B1);
+	CHECK(link_crc16(NULL, 0) == 0xFFFF);
+}
+static void test_round_trip(void)
+{
+	LINK_MESSAGE_t message;
+	GUARDED_MESSAGE_t decoded;
+	uint8_t frame[LINK_MAX_FRAME];
+
+	for(uint16_t length = 0; length <= LINK_MAX_PAYLOAD; length++)
+	{
+		make_message(&message, (uint8_t)length);
+		uint16_t size = link_encode(&message, frame, sizeof(frame));
+		CHECK(size == length + LINK_HEADER_SIZE + 5);
+		CHECK(frame[0] == LINK_DELIMITER && frame[size - 1] == LINK_DELIMITER);
+		CHECK(memchr(&frame[1], LINK_DELIMITER, size - 2) == NULL);
+
+		memset(&decoded, TEST_GUARD, sizeof(decoded));
+		CHECK(link_decode(frame, size, &decoded.message) == LINK_OK);
+		CHECK(same_message(&message, &decoded.message));
+		//without delimiters as well
+		CHECK(link_decode(&frame[1], size - 2, &decoded.message) == LINK_OK);
+		CHECK(same_message(&message, &decoded.message));
+		for(uint8_t i = 0; i < sizeof(decoded.guard); i++)
+			CHECK(decoded.guard[i] == TEST_GUARD);
+	}
+	//does not fit
+	make_message(&message, LINK_MAX_PAYLOAD);
+	CHECK(link_encode(&message, frame, LINK_MAX_FRAME - 1) == 0);
+	message.length = LINK_MAX_PAYLOAD + 1;
+	CHECK(link_encode(&message, frame, sizeof(frame)) == 0);
+}
+static void test_corruption(void)
+{
+	LINK_MESSAGE_t message;
+	LINK_MESSAGE_t decoded;
+	uint8_t frame[LINK_MAX_FRAME];
+	uint8_t copy[LINK_MAX_FRAME];
+	uint32_t accepted = 0;
+
+	for(uint16_t length = 0; length <= LINK_MAX_PAYLOAD; length += 3)
+	{
+		make_message(&message, (uint8_t)length);
+		uint16_t size = link_encode(&message, frame, sizeof(frame));
+		//every single bit between the delimiters
+		for(uint16_t byte = 1; byte < size - 1; byte++)
+			for(uint8_t bit = 0; bit < 8; bit++)
+			{
+				memcpy(copy, frame, size);
+				copy[byte] ^= 1 << bit;
+				if(link_decode(copy, size, &decoded) == LINK_OK)
+					accepted++;
+			}
+		//truncated: one byte to all bytes missing at the end
+		for(uint16_t cut = 1; cut < size - 1; cut++)
+		{
+			memcpy(copy, frame, size - 1 - cut);
+			CHECK(link_decode(copy, size - 1 - cut, &decoded) != LINK_OK);
+		}
+		//one byte lost inside the frame
+		for(uint16_t lost = 1; lost < size - 1; lost++)
+		{
+			memcpy(copy, frame, lost);
+			memcpy(&copy[lost], &frame[lost + 1], size - lost - 1);
+			CHECK(link_decode(copy, size - 1, &decoded) != LINK_OK);
+		}
+	}
+	CHECK(accepted == 0);
+	//CRC of the header counts as well
+	make_message(&message, 4);
+	uint16_t size = link_encode(&message, frame, sizeof(frame));
+	frame[size - 2] ^= 0x01;
+	CHECK(link_decode(frame, size, &decoded) == LINK_ERR_CRC);
+}
+static void test_malformed(void)
+{
+	GUARDED_MESSAGE_t decoded;
+	uint8_t frame[2 * LINK_MAX_FRAME];
+	uint16_t size;
+
+	//crafted frame decodes, so the cases below only differ in what they test
+	size = crafted_frame(4, 4, frame);
+	CHECK(link_decode(frame, size, &decoded.message) == LINK_OK && decoded.message.length == 4);
+
+	//length byte does not match the payload, CRC is valid
+	size = crafted_frame(5, 4, frame);
+	CHECK(link_decode(frame, size, &decoded.message) == LINK_ERR_LENGTH);
+	size = crafted_frame(3, 4, frame);
+	CHECK(link_decode(frame, size, &decoded.message) == LINK_ERR_LENGTH);
+	size = crafted_frame(0xFF, 4, frame);
+	CHECK(link_decode(frame, size, &decoded.message) == LINK_ERR_LENGTH);
+
+	//payload longer than LINK_MAX_PAYLOAD with a matching length byte and CRC
+	memset(&decoded, TEST_GUARD, sizeof(decoded));
+	size = crafted_frame(LINK_MAX_PAYLOAD + 1, LINK_MAX_PAYLOAD + 1, frame);
+	CHECK(link_decode(frame, size, &decoded.message) != LINK_OK);
+	size = crafted_frame(LINK_MAX_PAYLOAD + 40, LINK_MAX_PAYLOAD + 40, frame);
+	CHECK(link_decode(frame, size, &decoded.message) != LINK_OK);
+	for(uint8_t i = 0; i < sizeof(decoded.guard); i++)
+		CHECK(decoded.guard[i] == TEST_GUARD);
+
+	//empty, only delimiters, header without CRC
+	CHECK(link_decode(frame, 0, &decoded.message) == LINK_ERR_LENGTH);
+	const uint8_t delimiters[2] = { LINK_DELIMITER, LINK_DELIMITER };
+	CHECK(link_decode(delimiters, 2, &decoded.message) == LINK_ERR_LENGTH);
+	const uint8_t plain[LINK_HEADER_SIZE] = { LINK_MSG_COLOR, 1, 2, 3, 4, 0 };
+	size = raw_frame(plain, sizeof(plain), frame);
+	CHECK(link_decode(frame, size, &decoded.message) == LINK_ERR_LENGTH);
+
+	//COBS code pointing behind the frame, 0x00 inside
+	const uint8_t pointer[4] = { 0x09, 0x01, 0x02, 0x03 };
+	CHECK(link_decode(pointer, sizeof(pointer), &decoded.message) == LINK_ERR_COBS);
+	const uint8_t zero[5] = { 0x05, 0x01, 0x00, 0x02, 0x03 };
+	CHECK(link_decode(zero, sizeof(zero), &decoded.message) == LINK_ERR_COBS);
+}
+static void test_receiver(void)
+{
+	LINK_RECEIVER_t receiver;
+	LINK_MESSAGE_t messages[3];
+	LINK_MESSAGE_t received[4];
+	uint8_t stream[4 * LINK_MAX_FRAME + 16];
+	uint8_t frames[3][LINK_MAX_FRAME];
+	uint16_t sizes[3];
+	uint16_t length = 0;
+	uint8_t texts = 0;
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		make_message(&messages[i], (uint8_t)(5 + 4 * i));
+		messages[i].id = i + 1;
+		sizes[i] = link_encode(&messages[i], frames[i], sizeof(frames[i]));
+	}
+
+	//back to back with an ASCII command in between
+	link_resetReceiver(&receiver);
+	memcpy(&stream[length], frames[0], sizes[0]);
+	length += sizes[0];
+	memcpy(&stream[length], "MEA:\r\n", 6);
+	length += 6;
+	memcpy(&stream[length], frames[1], sizes[1]);
+	length += sizes[1];
+	memcpy(&stream[length], frames[2], sizes[2]);
+	length += sizes[2];
+	CHECK(feed(&receiver, stream, length, received, 4, &texts) == 3);
+	CHECK(texts == 1);
+	for(uint8_t i = 0; i < 3; i++)
+		CHECK(same_message(&messages[i], &received[i]));
+
+	//lost closing delimiter of the first frame: the second one is lost at most, the third arrives
+	for(uint8_t lost = 0; lost < 2; lost++)
+	{
+		link_resetReceiver(&receiver);
+		length = 0;
+		memcpy(&stream[length], frames[0], sizes[0] - 1);
+		length += sizes[0] - 1;
+		//closing delimiter of frame 0, then opening of frame 1 lost
+		memcpy(&stream[length], &frames[1][lost], sizes[1] - lost);
+		length += sizes[1] - lost;
+		memcpy(&stream[length], frames[2], sizes[2]);
+		length += sizes[2];
+		uint8_t count = feed(&receiver, stream, length, received, 4, NULL);
+		CHECK(count >= 1 && received[count - 1].id == 3 && same_message(&messages[2], &received[count - 1]));
+	}
+
+	//byte lost inside the first frame
+	link_resetReceiver(&receiver);
+	length = 0;
+	memcpy(&stream[length], frames[0], sizes[0] / 2);
+	length += sizes[0] / 2;
+	memcpy(&stream[length], &frames[0][sizes[0] / 2 + 1], sizes[0] - sizes[0] / 2 - 1);
+	length += sizes[0] - sizes[0] / 2 - 1;
+	memcpy(&stream[length], frames[1], sizes[1]);
+	length += sizes[1];
+	CHECK(feed(&receiver, stream, length, received, 4, NULL) == 1 && same_message(&messages[1], &received[0]));
+
+	//too long without delimiter: overflow, then the next frame arrives
+	link_resetReceiver(&receiver);
+	uint8_t overflow = 0;
+	CHECK(link_receive(&receiver, LINK_DELIMITER) == LINK_RX_NONE);
+	for(uint16_t i = 0; i < LINK_RX_SIZE + 10; i++)
+		CHECK(link_receive(&receiver, 0x33) == LINK_RX_NONE);
+	overflow = (link_receive(&receiver, LINK_DELIMITER) == LINK_RX_OVERFLOW);
+	CHECK(overflow);
+	CHECK(feed(&receiver, frames[0], sizes[0], received, 4, NULL) == 1 && same_message(&messages[0], &received[0]));
+
+	//idle line: ends a command without CR/LF, marks a frame it interrupts
+	link_resetReceiver(&receiver);
+	for(uint8_t i = 0; i < 4; i++)
+		link_receive(&receiver, (uint8_t)"MEA:"[i]);
+	CHECK(link_receiveIdle(&receiver) == LINK_RX_TEXT && strcmp(receiver.data, "MEA:") == 0);
+	CHECK(feed(&receiver, frames[0], sizes[0] - 4, received, 4, NULL) == 0);
+	CHECK(link_receiveIdle(&receiver) == LINK_RX_NONE && receiver.paused);
+	CHECK(feed(&receiver, &frames[0][sizes[0] - 4], 4, received, 4, NULL) == 1 && receiver.paused);
+	CHECK(feed(&receiver, frames[1], sizes[1], received, 4, NULL) == 1 && !receiver.paused);
+	CHECK(link_receiveIdle(&receiver) == LINK_RX_NONE && !receiver.paused);
+
+	//reset clears a pause, the next frame is not marked
+	CHECK(feed(&receiver, frames[0], sizes[0] - 4, received, 4, NULL) == 0);
+	link_receiveIdle(&receiver);
+	link_resetReceiver(&receiver);
+	CHECK(!receiver.paused);
+	CHECK(feed(&receiver, frames[1], sizes[1], received, 4, NULL) == 1 && !receiver.paused);
+}
+static void test_sample(void)
+{
+	const uint32_t values[][LINK_SAMPLE_CHANNELS] = {
+		{ 0, 0, 0, 0, 0 },
+		{ 1, 2, 3, 4, 5 },
+		{ LINK_SAMPLE_MAX, 0, LINK_SAMPLE_MAX, 0, LINK_SAMPLE_MAX },
+		{ 0x55555, 0x2AAAA, 0x7FFFE, 0x40000, 0x3FFFF },
+		{ 393000, 65535, 65536, 262143, 262144 }
+	};
+	const uint32_t times[] = { 0, 1, 0x80000000, 0xFFFFFFFF, 123456789 };
+	const uint32_t errors[] = { 0, 1, 0xFFFE, LINK_SAMPLE_UNSYNCED, 0x10000 };
+	LINK_MESSAGE_t message;
+	LINK_MESSAGE_t decoded;
+	uint8_t frame[LINK_MAX_FRAME];
+	uint32_t channels[LINK_SAMPLE_CHANNELS];
+	uint32_t time;
+	uint16_t error;
+
+	CHECK(LINK_SAMPLE_LENGTH <= LINK_MAX_PAYLOAD);
+	for(uint8_t v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+	{
+		memset(&message, 0, sizeof(message));
+		link_packSample(values[v], times[v], errors[v], &message, LINK_MSG_SAMPLE);
+		CHECK(message.type == LINK_MSG_SAMPLE && message.length == LINK_SAMPLE_LENGTH);
+		uint16_t size = link_encode(&message, frame, sizeof(frame));
+		CHECK(link_decode(frame, size, &decoded) == LINK_OK);
+		CHECK(link_unpackSample(&decoded, channels, &time, &error));
+		CHECK(memcmp(channels, values[v], sizeof(channels)) == 0);
+		CHECK(time == times[v]);
+		CHECK(error == ((errors[v] > LINK_SAMPLE_UNSYNCED) ? LINK_SAMPLE_UNSYNCED : errors[v]));
+	}
+	//random 19 bit values, every bit position of the packing
+	for(uint16_t n = 0; n < 1000; n++)
+	{
+		uint32_t random[LINK_SAMPLE_CHANNELS];
+		for(uint8_t c = 0; c < LINK_SAMPLE_CHANNELS; c++)
+			random[c] = ((uint32_t)random_byte() << 16 | (uint32_t)random_byte() << 8 | random_byte()) & LINK_SAMPLE_MAX;
+		link_packSample(random, n, n, &message, LINK_MSG_SAMPLE_RAW);
+		CHECK(link_unpackSample(&message, channels, &time, &error));
+		CHECK(memcmp(channels, random, sizeof(channels)) == 0 && time == n && error == n);
+	}
+	//values above 19 bit saturate
+	const uint32_t large[LINK_SAMPLE_CHANNELS] = { LINK_SAMPLE_MAX + 1, 0xFFFFFFFF, 1UL << 20, 0, LINK_SAMPLE_MAX };
+	link_packSample(large, 0, 0, &message, LINK_MSG_SAMPLE);
+	CHECK(link_unpackSample(&message, channels, &time, &error));
+	CHECK(channels[0] == LINK_SAMPLE_MAX && channels[1] == LINK_SAMPLE_MAX && channels[2] == LINK_SAMPLE_MAX
+			&& channels[3] == 0 && channels[4] == LINK_SAMPLE_MAX);
+	//wrong length
+	message.length = LINK_SAMPLE_LENGTH - 1;
+	CHECK(!link_unpackSample(&message, channels, &time, &error));
+	message.length = 0;
+	CHECK(!link_unpackSample(&message, channels, &time, &error));
+}
+static void test_arq_restart(void)
+{
+	//bases of the sender when the receiver restarts, 1..8 are just behind a window
+	const uint8_t bases[] = { 0, 1, 3, 5, 8, 9, 20, 100, 255 };
+	static LINK_ARQ_t sender;
+	static LINK_ARQ_t receiver;
+	static TEST_PIPE_t toReceiver;
+	static TEST_PIPE_t toSender;
+	LINK_ARQ_STATS_t stats;
+	uint32_t now = 1000;
+	uint32_t delivered;
+
+	for(uint8_t b = 0; b < sizeof(bases) / sizeof(bases[0]); b++)
+	{
+		link_arqInit(&sender, LINK_ARQ_WINDOW, pipe_output, &toReceiver);
+		link_arqInit(&receiver, LINK_ARQ_WINDOW, pipe_output, &toSender);
+		toReceiver.count = toSender.count = 0;
+		//bring the sender to the base in one session
+		delivered = 0;
+		for(uint16_t sent = 0; sent < bases[b]; sent++)
+			transfer(&sender, &toReceiver, &receiver, &toSender, 1, &now, &delivered);
+		CHECK(delivered == bases[b] && sender.base == bases[b]);
+
+		//receiver restarts, the next frames arrive without a timeout
+		link_arqInit(&receiver, LINK_ARQ_WINDOW, pipe_output, &toSender);
+		delivered = 0;
+		uint32_t took = transfer(&sender, &toReceiver, &receiver, &toSender, 3, &now, &delivered);
+		link_arqGetStats(&sender, &stats);
+		CHECK(delivered == 3);
+		CHECK(stats.lost == 0 && stats.timeouts == 0);
+		CHECK(took < LINK_ARQ_RTO_INITIAL);
+		if(stats.lost != 0 || stats.timeouts != 0)
+			printf("restart at base %u: %lu timeouts, %lu lost\n", bases[b], (unsigned long)stats.timeouts,
+					(unsigned long)stats.lost);
+
+		//stale frame of the session before: dropped, the receiver stays in step
+		LINK_MESSAGE_t stale = sender.frames[0];
+		stale.session = (sender.session == 1) ? 0xFF : (uint8_t)(sender.session - 1); //0 is unsequenced
+		stale.sequence = 2;
+		CHECK(!link_arqReceive(&receiver, &stale, now));
+		exchange(&sender, &toReceiver, &receiver, &toSender, now);
+		delivered = 0;
+		transfer(&sender, &toReceiver, &receiver, &toSender, 2, &now, &delivered);
+		link_arqGetStats(&sender, &stats);
+		CHECK(delivered == 2 && stats.lost == 0 && stats.timeouts == 0);
+	}
+}
+/*
+ * Content of a message of the ring test: number and length in the first
+ * bytes, so a cut or mixed message never matches
+ */
+static void tx_message(uint32_t number, uint16_t length, uint8_t* data)
+{
+	for(uint16_t i = 0; i < length; i++)
+		data[i] = (uint8_t)(number * 37 + i * 11 + length);
+	data[0] = (uint8_t)number;
+	if(length > 1)
+		data[1] = (uint8_t)(number >> 8);
+}
+/*
+ * Starts the next transfer like start_transfer of printf.c, the ring has to
+ * keep its bytes until dma_complete
+ */
+static void dma_start(TX_RING_t* ring, TEST_DMA_t* dma)
+{
+	const uint8_t* data;
+	uint16_t length;
+
+	if(dma->data != NULL || (length = tx_ringNext(ring, &data)) == 0)
+		return;
+	CHECK(data >= ring->data && data + length <= ring->data + TX_RING_SIZE);
+	dma->data = data;
+	dma->length = length;
+	memcpy(dma->copy, data, length);
+	tx_ringStarted(ring, length);
+}
+/*
+ * Transfer complete callback: the bytes go on the wire, the next transfer starts
+ */
+static void dma_complete(TX_RING_t* ring, TEST_DMA_t* dma)
+{
+	if(dma->data == NULL)
+		return;
+	CHECK(memcmp(dma->data, dma->copy, dma->length) == 0); //overwritten while sending
+	if(dma->sent + dma->length <= TEST_WIRE_SIZE)
+		memcpy(&dma->wire[dma->sent], dma->copy, dma->length);
+	dma->sent += dma->length;
+	dma->transfers++;
+	dma->wraps += (dma->data + dma->length == ring->data + TX_RING_SIZE) ? 1 : 0;
+	dma->data = NULL;
+	tx_ringSent(ring);
+	dma_start(ring, dma);
+}
+/*
+ * Writes the next message like queue of printf.c (without waiting), returns
+ * if it was taken
+ */
+static _Bool tx_write(TX_RING_t* ring, TEST_DMA_t* dma, TEST_MESSAGES_t* messages, uint16_t length)
+{
+	uint8_t data[TX_RING_SIZE];
+
+	if(!tx_ringReserve(ring, length))
+		return false;
+	tx_message(messages->count, length, data);
+	tx_ringPut(ring, data, length, false);
+	if(messages->count < TEST_TX_MESSAGES)
+		messages->lengths[messages->count++] = length;
+	dma_start(ring, dma);
+	return true;
+}
+/*
+ * The wire has to hold the written messages in order, each one whole or not
+ * at all, returns how many are missing
+ */
+static uint32_t tx_missing(const TEST_DMA_t* dma, const TEST_MESSAGES_t* messages)
+{
+	uint8_t data[TX_RING_SIZE];
+	uint32_t position = 0;
+	uint32_t missing = 0;
+
+	for(uint32_t n = 0; n < messages->count; n++)
+	{
+		uint16_t length = messages->lengths[n];
+		tx_message(n, length, data);
+		if(position + length <= dma->sent && memcmp(&dma->wire[position], data, length) == 0)
+			position += length;
+		else
+			missing++;
+	}
+	CHECK(position == dma->sent); //anything else on the wire is a cut or mixed message
+	return missing;
+}
+/*
+ * Empties the ring through the DMA
+ */
+static void dma_drain(TX_RING_t* ring, TEST_DMA_t* dma)
+{
+	while(dma->data != NULL)
+		dma_complete(ring, dma);
+}
+static void test_tx_wrap(void)
+{
+	static TX_RING_t ring;
+	static TEST_DMA_t dma;
+	static TEST_MESSAGES_t messages;
+
+	//DMA slower than the writer at times, the ring wraps many times
+	tx_ringInit(&ring, TX_OVERFLOW_BLOCK);
+	memset(&dma, 0, sizeof(dma));
+	messages.count = 0;
+	while(messages.count < TEST_TX_MESSAGES && dma.sent < TEST_WIRE_SIZE - 2 * TX_RING_SIZE)
+	{
+		uint16_t length = 2 + random_byte() % 120;
+		while(!tx_write(&ring, &dma, &messages, length))
+			dma_complete(&ring, &dma); //BLOCK: wait for the DMA
+		if(random_byte() < 100)
+			dma_complete(&ring, &dma);
+	}
+	dma_drain(&ring, &dma);
+	CHECK(tx_missing(&dma, &messages) == 0);
+	CHECK(ring.dropped == 0);
+	CHECK(dma.wraps > 10);
+	CHECK(ring.head == ring.tail && ring.sending == 0);
+}
+static void test_tx_overwrite(void)
+{
+	static TX_RING_t ring;
+	static TEST_DMA_t dma;
+	static TEST_MESSAGES_t messages;
+	uint32_t missing;
+
+	//several queued messages behind a running transfer make room for a large one
+	tx_ringInit(&ring, TX_OVERFLOW_OVERWRITE);
+	memset(&dma, 0, sizeof(dma));
+	messages.count = 0;
+	CHECK(tx_write(&ring, &dma, &messages, 100)); //running
+	for(uint8_t i = 0; i < 8; i++)
+		CHECK(tx_write(&ring, &dma, &messages, 40));
+	CHECK(tx_write(&ring, &dma, &messages, 300)); //412 - 320 + 40 * n >= 300
+	CHECK(ring.dropped == 6);
+	dma_drain(&ring, &dma);
+	CHECK(tx_missing(&dma, &messages) == 6);
+	CHECK(dma.sent == 100 + 2 * 40 + 300);
+
+	//the started rest of a message split at the end of the ring stays
+	tx_ringInit(&ring, TX_OVERFLOW_OVERWRITE);
+	memset(&dma, 0, sizeof(dma));
+	messages.count = 0;
+	CHECK(tx_write(&ring, &dma, &messages, 400));
+	dma_complete(&ring, &dma);
+	CHECK(tx_write(&ring, &dma, &messages, 200)); //112 to the end of the ring, 88 after
+	for(uint8_t i = 0; i < 4; i++)
+		CHECK(tx_write(&ring, &dma, &messages, 50));
+	CHECK(tx_write(&ring, &dma, &messages, 250));
+	dma_drain(&ring, &dma);
+	CHECK(tx_missing(&dma, &messages) == ring.dropped);
+	CHECK(ring.dropped >= 2);
+	CHECK(dma.wire[0] == 0 && dma.wire[400] == 1);
+
+	//random lengths, more than TX_MESSAGES queued at times (merged), random DMA
+	tx_ringInit(&ring, TX_OVERFLOW_OVERWRITE);
+	memset(&dma, 0, sizeof(dma));
+	messages.count = 0;
+	while(messages.count < TEST_TX_MESSAGES && dma.sent < TEST_WIRE_SIZE - 2 * TX_RING_SIZE)
+	{
+		uint16_t length = (random_byte() < 200) ? 2 + random_byte() % 8 : 2 + random_byte() % 250;
+		tx_write(&ring, &dma, &messages, length); //may not fit next to a large running transfer
+		if(random_byte() < 20)
+			dma_complete(&ring, &dma);
+	}
+	dma_drain(&ring, &dma);
+	missing = tx_missing(&dma, &messages);
+	CHECK(missing >= ring.dropped && ring.dropped > 100); //merged messages are counted once
+	CHECK(missing < messages.count / 2);
+	CHECK(dma.wraps > 10);
+}
+static void test_tx_oversize(void)
+{
+	const TX_OVERFLOW_t policies[3] = { TX_OVERFLOW_DROP, TX_OVERFLOW_BLOCK, TX_OVERFLOW_OVERWRITE };
+	static TX_RING_t ring;
+	static TEST_DMA_t dma;
+	static TEST_MESSAGES_t messages;
+
+	for(uint8_t p = 0; p < 3; p++)
+	{
+		//200 running, 3 x 80 queued: 72 free
+		tx_ringInit(&ring, policies[p]);
+		memset(&dma, 0, sizeof(dma));
+		messages.count = 0;
+		CHECK(tx_write(&ring, &dma, &messages, 200));
+		for(uint8_t i = 0; i < 3; i++)
+			CHECK(tx_write(&ring, &dma, &messages, 80));
+		CHECK(!tx_ringReserve(&ring, TX_RING_SIZE + 1));
+		CHECK(!tx_ringReserve(&ring, TX_RING_SIZE - 199)); //only the running transfer is left
+		CHECK(ring.head == 440 && ring.dropped == 0);
+
+		_Bool taken = tx_write(&ring, &dma, &messages, 150);
+		if(policies[p] == TX_OVERFLOW_OVERWRITE)
+		{
+			CHECK(taken && ring.dropped == 1); //the oldest queued one
+			CHECK(ring.head == 440 - 80 + 150);
+		}
+		else
+		{
+			//nothing changed, BLOCK fits once the DMA freed the running transfer
+			CHECK(!taken && ring.head == 440 && ring.dropped == 0);
+			dma_complete(&ring, &dma);
+			if(policies[p] == TX_OVERFLOW_BLOCK)
+				CHECK(tx_write(&ring, &dma, &messages, 150));
+		}
+		dma_drain(&ring, &dma);
+		CHECK(tx_missing(&dma, &messages) == ring.dropped);
+	}
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(void)
+{
+	link_Init();
+	test_crc();
+	test_round_trip();
+	test_corruption();
+	test_malformed();
+	test_receiver();
+	test_sample();
+	test_arq_restart();
+	test_tx_wrap();
+	test_tx_overwrite();
+	test_tx_oversize();
+	printf("link_test: %lu checks, %lu failed\n", (unsigned long)checks, (unsigned long)failures);
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Decodes the binary log of the ST-Link virtual COM port (USART2, 115200 Baud).
+
+The firmware only sends message index, level, time and raw arguments
+(Common/Src/log.c); names and formats are read from the X-macro table in
+Common/Inc/log_messages.h, so the decoder always matches the firmware built
+from the same checkout.
+
+    python3 Tools/log_decode.py /dev/ttyACM0
+    python3 Tools/log_decode.py capture.bin
+    cat /dev/ttyACM0 | python3 Tools/log_decode.py -
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+LINK_MSG_LOG = 0x40
+LEVELS = ["DEBUG", "INFO", "WARN", "ERROR"]
+TABLE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Common", "Inc", "log_messages.h")
+
+
+def load_table(path):
+    """Message names and formats in index order, C conversions made Python compatible."""
+    with open(path, encoding="utf-8") as header:
+        text = header.read()
+    entries = re.findall(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text)
+    return [(name, re.sub(r"%l([udx])", r"%\1", fmt)) for name, fmt in entries]
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as link_crc16"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(segment):
+    """type, payload of one frame (without delimiters) or None"""
+    plain = cobs_decode(segment)
+    if plain is None or len(plain) < 8 or plain[5] != len(plain) - 8:
+        return None
+    if crc16(plain[:-2]) != (plain[-2] << 8 | plain[-1]):
+        return None
+    return plain[0], plain[6:-2]
+
+
+def format_record(table, payload):
+    ident, level, time = struct.unpack_from("<HBI", payload)
+    args = list(struct.unpack_from("<%dI" % ((len(payload) - 7) // 4), payload, 7))
+    level = LEVELS[level] if level < len(LEVELS) else str(level)
+    if ident >= len(table):
+        return "%10.3f %-5s #%d %s" % (time / 1000, level, ident, args)
+    name, fmt = table[ident]
+    # %c and %d take the signed/character view of the 32 bit value
+    conversions = re.findall(r"%[-+ 0#]*\d*([a-zA-Z])", fmt)
+    values = []
+    for conversion, value in zip(conversions, args):
+        if conversion == "c":
+            values.append(chr(value & 0xFF))
+        elif conversion == "d":
+            values.append(value - (1 << 32) if value & 0x80000000 else value)
+        else:
+            values.append(value)
+    try:
+        text = fmt % tuple(values)
+    except (TypeError, ValueError):
+        text = "%s %s" % (fmt, args)
+    return "%10.3f %-5s %-16s %s" % (time / 1000, level, name, text)
+
+
+def open_input(source):
+    if source == "-":
+        return sys.stdin.buffer
+    if source.startswith("/dev/"):
+        try:
+            import serial
+            return serial.Serial(source, 115200, timeout=0.1)
+        except ImportError:
+            os.system("stty -F %s 115200 raw -echo" % source)
+    return open(source, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="serial port, capture file or - for stdin")
+    parser.add_argument("--table", default=TABLE, help="log_messages.h")
+    options = parser.parse_args()
+
+    table = load_table(options.table)
+    stream = open_input(options.source)
+    segment = bytearray()
+    while True:
+        chunk = stream.read(64)
+        if not chunk:
+            if options.source.startswith("/dev/"):
+                continue
+            break
+        for byte in chunk:
+            if byte != 0:
+                segment.append(byte)
+                continue
+            if segment:
+                frame = decode_frame(bytes(segment))
+                if frame and frame[0] == LINK_MSG_LOG:
+                    print(format_record(table, frame[1]), flush=True)
+                elif frame is None:
+                    print("(corrupted frame)", file=sys.stderr)
+            segment = bytearray()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,274 @@
+/**
+  ******************************************************************************
+  * @file    lut_bench.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Host check of the inverse LED table (lut_grid.c): the sweep of
+  * 		 colorlut.c is taken from a known affine LED model with crosstalk
+  * 		 between the channels, the table is built from it and every color
+  * 		 the model reaches on a 17x17x17 grid of drives (edges included) is
+  * 		 looked up again. The drive must come back within one 8 bit step.
+  * 		 Drives just outside of the LED range must be reported out of
+  * 		 gamut with that channel clamped. An affine model is interpolated
+  * 		 exactly by any path through the cell, so a second table from the
+  * 		 model with 20 % droop at full drive checks that every lookup stays
+  * 		 within the drives of the corners of its cell (the tetrahedron
+  * 		 weights are not negative). Then the time of one lookup is
+  * 		 printed. Exit code is non-zero on any failed check.
+  *
+  * 		 gcc -O2 -IProject_LightSensor/Core/Inc -o lut_bench Tools/lut_bench.c Project_LightSensor/Core/Src/lut_grid.c -lm
+  *
+  * 		 lut_bench [lookups]
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L //clock_gettime with -std=c11
+#include "lut_grid.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_LOOKUPS 10000000
+#define BENCH_STEPS 16 //grid of drives checked, 17 per channel
+#define BENCH_TOLERANCE (LUT_MAX_DUTY / 255) //one 8 bit step of the linear duty
+#define BENCH_OUTSIDE 2000 //drives outside of the range checked
+#define BENCH_DROOP 0.2 //efficiency lost at full drive, second table
+#define BENCH_CELL_CHECKS 100000
+
+/* Globals -------------------------------------------------------------------*/
+//counts of the sensor channel (row) at full drive of the LED channel (column)
+static const double model[3][3] = {
+	{ 30000, 2500, 800 },
+	{ 3000, 42000, 4000 },
+	{ 500, 3500, 25000 }
+};
+static double droop = 0; //of the model
+static int32_t sweep[LUT_SWEEP_POINTS][3];
+static LUT_GRID_t grid;
+static uint32_t seed = 12345;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+static double random_unit(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (double)(seed >> 8) / (1 << 24);
+}
+/*
+ * Sensor counts above ambient for a linear drive in Q8.8 (may be outside of
+ * the LED range)
+ */
+static void model_color(const double* duty, int64_t* color)
+{
+	for(int c=0; c<3; c++)
+	{
+		double counts = 0;
+		for(int k=0; k<3; k++)
+			counts += model[c][k] * duty[k] / LUT_MAX_DUTY * (1 - droop * duty[k] / LUT_MAX_DUTY);
+		color[c] = llround(counts);
+	}
+}
+/*
+ * Sweep of lut_characterize measured on the model
+ */
+static void build_sweep(void)
+{
+	for(uint32_t point=0; point<LUT_SWEEP_POINTS; point++)
+	{
+		const double duty[3] = {
+			(double)(point / (LUT_SWEEP_LEVELS * LUT_SWEEP_LEVELS)) * LUT_SWEEP_STEP,
+			(double)((point / LUT_SWEEP_LEVELS) % LUT_SWEEP_LEVELS) * LUT_SWEEP_STEP,
+			(double)(point % LUT_SWEEP_LEVELS) * LUT_SWEEP_STEP
+		};
+		int64_t color[3];
+		model_color(duty, color);
+		for(int c=0; c<3; c++)
+			sweep[point][c] = (int32_t)color[c];
+	}
+}
+/*
+ * Every reachable color of the drive grid, returns the failed lookups
+ */
+static uint32_t check_gamut(double* maxError)
+{
+	uint32_t failures = 0;
+
+	*maxError = 0;
+	for(uint32_t i=0; i<(BENCH_STEPS + 1) * (BENCH_STEPS + 1) * (BENCH_STEPS + 1); i++)
+	{
+		const uint32_t step[3] = { i / ((BENCH_STEPS + 1) * (BENCH_STEPS + 1)), (i / (BENCH_STEPS + 1)) % (BENCH_STEPS + 1), i % (BENCH_STEPS + 1) };
+		double duty[3];
+		int64_t color[3];
+		uint32_t found[3];
+		_Bool edge = false;
+
+		for(int c=0; c<3; c++)
+		{
+			duty[c] = (double)LUT_MAX_DUTY * step[c] / BENCH_STEPS;
+			edge |= (step[c] == 0 || step[c] == BENCH_STEPS);
+		}
+		model_color(duty, color);
+		_Bool reachable = lut_gridLookup(&grid, color, found);
+		double error = 0;
+		for(int c=0; c<3; c++)
+			error = fmax(error, fabs(found[c] - duty[c]));
+		if(error > *maxError)
+			*maxError = error;
+		//on the edge rounding may push a drive just outside, then it is clamped and flagged
+		if(error <= BENCH_TOLERANCE && (reachable || edge))
+			continue;
+		if(failures++ < 10)
+			printf("drive %.0f,%.0f,%.0f: found %lu,%lu,%lu%s\n", duty[0], duty[1], duty[2], (unsigned long)found[0],
+					(unsigned long)found[1], (unsigned long)found[2], reachable ? "" : " out of gamut");
+	}
+	return failures;
+}
+/*
+ * Drives with one channel up to 15 % below or above the LED range, as far as
+ * the color stays in the box the table covers: out of gamut, that channel
+ * clamped, the others still right
+ */
+static uint32_t check_outside(uint32_t* checked)
+{
+	uint32_t failures = 0;
+
+	*checked = 0;
+	for(uint32_t n=0; n<BENCH_OUTSIDE * 10 && *checked<BENCH_OUTSIDE; n++)
+	{
+		double duty[3];
+		int64_t color[3];
+		uint32_t found[3];
+		int outside = n % 3;
+		_Bool inBox = true;
+
+		for(int c=0; c<3; c++)
+			duty[c] = LUT_MAX_DUTY * (0.1 + 0.8 * random_unit());
+		duty[outside] = LUT_MAX_DUTY * ((random_unit() < 0.5) ? -0.01 - 0.14 * random_unit() : 1.01 + 0.14 * random_unit());
+		model_color(duty, color);
+		for(int c=0; c<3; c++)
+			inBox &= (color[c] >= 0 && color[c] <= (int64_t)grid.white[c]);
+		if(!inBox)
+			continue;
+		(*checked)++;
+
+		_Bool reachable = lut_gridLookup(&grid, color, found);
+		_Bool ok = !reachable && found[outside] == ((duty[outside] < 0) ? 0 : LUT_MAX_DUTY);
+		for(int c=0; c<3; c++)
+			ok &= (c == outside || fabs(found[c] - duty[c]) <= BENCH_TOLERANCE);
+		if(ok)
+			continue;
+		if(failures++ < 10)
+			printf("outside %.0f,%.0f,%.0f: found %lu,%lu,%lu%s\n", duty[0], duty[1], duty[2], (unsigned long)found[0],
+					(unsigned long)found[1], (unsigned long)found[2], reachable ? "" : " out of gamut");
+	}
+	return failures;
+}
+/*
+ * Random colors of the table box: the drive has to lie between the lowest and
+ * highest drive of the corners of the cell (clamped to the LED range like the
+ * lookup), returns the lookups outside
+ */
+static uint32_t check_cells(void)
+{
+	const uint32_t stride[3] = { LUT_GRID_SIZE * LUT_GRID_SIZE, LUT_GRID_SIZE, 1 };
+	uint32_t failures = 0;
+
+	for(uint32_t n=0; n<BENCH_CELL_CHECKS; n++)
+	{
+		int64_t color[3];
+		uint32_t found[3];
+		uint32_t cell = 0;
+
+		for(int c=0; c<3; c++)
+		{
+			color[c] = (int64_t)(grid.white[c] * random_unit());
+			uint32_t index = (uint32_t)(color[c] * (LUT_GRID_SIZE - 1) / grid.white[c]);
+			cell += ((index > LUT_GRID_SIZE - 2) ? LUT_GRID_SIZE - 2 : index) * stride[c];
+		}
+		lut_gridLookup(&grid, color, found);
+		for(int c=0; c<3; c++)
+		{
+			double low = INFINITY;
+			double high = -INFINITY;
+			for(uint8_t corner=0; corner<8; corner++)
+			{
+				uint32_t entry = cell + ((corner & 4) ? stride[0] : 0) + ((corner & 2) ? stride[1] : 0) + ((corner & 1) ? stride[2] : 0);
+				double drive = grid.drive[entry][c] * (double)(1 << LUT_DRIVE_SHIFT);
+				low = fmin(low, drive);
+				high = fmax(high, drive);
+			}
+			low = fmin(fmax(low, 0), LUT_MAX_DUTY);
+			high = fmin(fmax(high, 0), LUT_MAX_DUTY);
+			if(found[c] + 1.0 >= low && found[c] <= high + 1.0)
+				continue;
+			if(failures++ < 10)
+				printf("color %lld,%lld,%lld channel %d: found %lu, corners %.0f...%.0f\n", (long long)color[0],
+						(long long)color[1], (long long)color[2], c, (unsigned long)found[c], low, high);
+		}
+	}
+	return failures;
+}
+/*
+ * Builds the table from the model with the given droop
+ */
+static _Bool build_grid(double modelDroop)
+{
+	droop = modelDroop;
+	build_sweep();
+	return lut_gridBuild(&grid, (const int32_t (*)[3])sweep);
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint32_t lookups = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_LOOKUPS;
+	static int64_t targets[4096][3];
+	uint32_t duty[3];
+	volatile uint32_t sink = 0;
+	double maxError;
+	uint32_t checked;
+	uint32_t failures = 0;
+
+	if(!build_grid(0))
+	{
+		printf("table not built\n");
+		return 1;
+	}
+	uint32_t gamut = check_gamut(&maxError);
+	printf("%u drives in the gamut: %lu failed, max error %.1f (Q8.8, tolerance %u)\n",
+			(BENCH_STEPS + 1) * (BENCH_STEPS + 1) * (BENCH_STEPS + 1), (unsigned long)gamut, maxError, BENCH_TOLERANCE);
+	uint32_t outside = check_outside(&checked);
+	printf("%lu drives outside of the range: %lu failed\n", (unsigned long)checked, (unsigned long)outside);
+	failures = gamut + outside + (checked < BENCH_OUTSIDE / 2);
+	if(!build_grid(BENCH_DROOP))
+	{
+		printf("table with droop not built\n");
+		return 1;
+	}
+	uint32_t cells = check_cells();
+	printf("%u colors with %.0f %% droop: %lu outside of the corners of their cell\n", BENCH_CELL_CHECKS,
+			BENCH_DROOP * 100, (unsigned long)cells);
+	failures += cells;
+
+	for(uint32_t i=0; i<4096; i++)
+		for(int c=0; c<3; c++)
+			targets[i][c] = (int64_t)(grid.white[c] * random_unit());
+	uint64_t start = now_ns();
+	for(uint32_t i=0; i<lookups; i++)
+	{
+		lut_gridLookup(&grid, targets[i % 4096], duty);
+		sink += duty[i % 3];
+	}
+	(void)sink;
+	printf("lookup %.1f ns\n", (double)(now_ns() - start) / lookups);
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,410 @@
+/**
+  ******************************************************************************
+  * @file    node_sim.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Display and several sensor nodes on one simulated radio channel,
+  * 		 for testing the polling (Common/Src/link_schedule.c) without
+  * 		 boards. Every board runs the shared link code, sends its TX ring
+  * 		 byte by byte at the baud rate like printf.c (gated the same way)
+  * 		 and receives through link_receive. The radio delays every byte,
+  * 		 bytes of two boards that overlap on air are lost for everyone
+  * 		 (collision). Prints one row per number of nodes, polled and, for
+  * 		 comparison, with the nodes sending their samples freely.
+  *
+  * 		 gcc -O2 -ICommon/Inc -o node_sim Tools/node_sim.c Common/Src/link_schedule.c Common/Src/link_arq.c Common/Src/link_codec.c Common/Src/histogram.c
+  *
+  * 		 node_sim [seconds] [sample ms] [byte loss]
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "link_schedule.h"
+#include "link_arq.h"
+#include "link_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define SIM_BAUD 57600
+#define SIM_BYTE_US (10000000.0 / SIM_BAUD) //start, 8 data and stop bit
+#define SIM_LATENCY_US 20000 //radio, per direction (link_impair.py default)
+#define SIM_STEP_US 10
+#define SIM_SECONDS 60
+#define SIM_SAMPLE_MS 100 //integration time of the sensor
+#define SIM_REQUEST_MS 500 //display: MEA request to one node after the other
+#define SIM_TX_SIZE 512 //as TX_RING_SIZE
+#define SIM_AIR_SIZE 4096 //bytes on their way through the radio
+#define SIM_BOARDS (LINK_MAX_NODES + 1) //board 0 is the display, board n is node n
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct SimAirByte
+{
+	uint8_t sender;
+	uint8_t byte;
+	_Bool lost;			//collided or lost on the radio
+	double start;		//µs, on air from here
+	double end;
+}SIM_AIR_BYTE_t;
+
+typedef struct SimBoard
+{
+	uint8_t tx[SIM_TX_SIZE];
+	uint32_t txHead;
+	uint32_t txLimit;	//gated: sent up to here
+	uint32_t txTail;
+	_Bool gated;
+	double lineFree;	//µs, the uart finished the last byte
+	SIM_AIR_BYTE_t* sending;	//byte of this board on air
+	LINK_RECEIVER_t receiver;
+	double lastByte;	//µs, received
+	_Bool idle;			//the line was idle for a byte time since, as the idle event of the uart
+	LINK_ARQ_t arq[LINK_MAX_NODES];	//display: one per node, node: arq[0]
+	uint32_t dropped;	//TX ring full
+	uint32_t rejected;	//frames with wrong CRC or length
+	//node
+	LINK_NODE_t node;
+	uint32_t latest[LINK_SAMPLE_CHANNELS];
+	_Bool latestNew;
+	uint32_t nextSample;	//ms
+	//display
+	LINK_SCHEDULER_t scheduler;
+	uint32_t samples[LINK_MAX_NODES];
+	uint32_t nextRequest;	//ms
+	uint8_t target;			//node of the next request - 1
+	uint32_t requests;
+	uint32_t replies;
+}SIM_BOARD_t;
+
+typedef struct SimResult
+{
+	uint32_t cycle;			//ms, mean
+	double rateMin;			//samples per s and node
+	double rateMax;
+	uint32_t collisions;	//bytes lost because two boards sent at once
+	uint32_t rejected;		//frames all boards dropped
+	uint32_t requests;
+	uint32_t replies;
+	uint32_t retransmitted;
+	uint32_t dropped;
+}SIM_RESULT_t;
+
+/* Globals -------------------------------------------------------------------*/
+static SIM_BOARD_t boards[SIM_BOARDS];
+static uint8_t boardCount;
+static SIM_AIR_BYTE_t air[SIM_AIR_SIZE];
+static uint32_t airHead;
+static uint32_t airTail;
+static uint32_t collisions;
+static double simNow; //µs
+static uint32_t sampleMs = SIM_SAMPLE_MS;
+static double byteLoss;
+static _Bool polling;
+static uint32_t seed = 1;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint32_t now_ms(void)
+{
+	return (uint32_t)(simNow / 1000);
+}
+static double random_unit(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFF) / 65536.0;
+}
+/*
+ * As printf_write and printf_writeLast: copies into the ring, release moves
+ * the gate behind it
+ */
+static void board_write(SIM_BOARD_t* board, const uint8_t* data, uint16_t length, _Bool release)
+{
+	if(SIM_TX_SIZE - (board->txHead - board->txTail) >= length)
+	{
+		for(uint16_t i = 0; i < length; i++)
+			board->tx[(board->txHead + i) % SIM_TX_SIZE] = data[i];
+		board->txHead += length;
+	}
+	else
+		board->dropped += length;
+	if(release)
+		board->txLimit = board->txHead;
+}
+static void board_send(SIM_BOARD_t* board, const LINK_MESSAGE_t* message, _Bool release)
+{
+	uint8_t frame[LINK_MAX_FRAME];
+	uint16_t length = link_encode(message, frame, sizeof(frame));
+	board_write(board, frame, length, release);
+}
+static void arq_output(void* context, const LINK_MESSAGE_t* message)
+{
+	board_send((SIM_BOARD_t*)context, message, false);
+}
+static void board_setGated(SIM_BOARD_t* board, _Bool gated)
+{
+	if(gated && !board->gated)
+		board->txLimit = board->txHead;
+	board->gated = gated;
+}
+static uint32_t board_pending(const SIM_BOARD_t* board)
+{
+	return board->txHead - board->txTail + ((board->lineFree > simNow) ? 1 : 0);
+}
+
+/*
+ * Display: polls the next node when the turn ended, retransmits, asks one node
+ * after the other for a sample
+ */
+static void display_poll(SIM_BOARD_t* display)
+{
+	LINK_MESSAGE_t message;
+
+	for(uint8_t i = 0; i < display->scheduler.count; i++)
+		link_arqPoll(&display->arq[i], now_ms());
+	if((int32_t)(now_ms() - display->nextRequest) >= 0)
+	{
+		memset(&message, 0, sizeof(message));
+		message.type = LINK_MSG_MEASURE;
+		message.address = display->target + 1;
+		message.id = (uint8_t)(display->requests % 255 + 1);
+		if(link_arqSend(&display->arq[display->target], &message, now_ms()) == LINK_ARQ_OK)
+			display->requests++;
+		display->target = (display->target + 1) % (boardCount - 1);
+		display->nextRequest = now_ms() + SIM_REQUEST_MS;
+	}
+	if(!polling)
+		return;
+	if(link_schedulerPoll(&display->scheduler, now_ms(), (uint32_t)(board_pending(display) * SIM_BYTE_US / 1000), &message))
+		board_send(display, &message, true);
+}
+static void display_receive(SIM_BOARD_t* display, const LINK_MESSAGE_t* message)
+{
+	uint32_t channels[LINK_SAMPLE_CHANNELS];
+	uint32_t time;
+	uint16_t error;
+
+	if(polling)
+		link_schedulerReceive(&display->scheduler, message, now_ms());
+	if(message->address < 1 || message->address > display->scheduler.count)
+		return;
+	if(!link_arqReceive(&display->arq[message->address - 1], message, now_ms()))
+		return;
+	if(message->type == LINK_MSG_POLL_REPLY && link_unpackSample(message, channels, &time, &error))
+		display->samples[message->address - 1]++;
+	else if(message->type == (LINK_MSG_MEASURE | LINK_MSG_REPLY))
+		display->replies++;
+}
+
+/*
+ * Node: takes a sample every sampleMs (up to 5 % more), gated while polled. Without polls
+ * every sample is sent right away, as uart_sendSample does.
+ */
+static void node_poll(SIM_BOARD_t* board)
+{
+	LINK_MESSAGE_t message;
+
+	link_arqPoll(&board->arq[0], now_ms());
+	if((int32_t)(now_ms() - board->nextSample) >= 0)
+	{
+		for(uint8_t i = 0; i < LINK_SAMPLE_CHANNELS; i++)
+			board->latest[i] = board->nextSample + i;
+		board->latestNew = true;
+		//crystals and integration differ a little from board to board
+		board->nextSample += sampleMs + (uint32_t)(random_unit() * sampleMs / 20);
+	}
+	board_setGated(board, link_nodeIsPolled(&board->node, now_ms()));
+	if(!board->gated && board->latestNew)
+	{
+		memset(&message, 0, sizeof(message));
+		link_packSample(board->latest, (uint32_t)simNow, LINK_SAMPLE_UNSYNCED, &message, LINK_MSG_POLL_REPLY);
+		message.address = board->node.address;
+		board_send(board, &message, false);
+		board->latestNew = false;
+	}
+}
+static void node_idle(SIM_BOARD_t* board)
+{
+	LINK_MESSAGE_t reply;
+
+	if(!link_nodeIdle(&board->node, &reply))
+		return;
+	board_setGated(board, true);
+	if(board->latestNew)
+		link_packSample(board->latest, (uint32_t)simNow, LINK_SAMPLE_UNSYNCED, &reply, LINK_MSG_POLL_REPLY);
+	board_send(board, &reply, true);
+	board->latestNew = false;
+}
+static void node_receive(SIM_BOARD_t* board, const LINK_MESSAGE_t* message)
+{
+	LINK_MESSAGE_t reply;
+
+	if(!link_nodeReceive(&board->node, message, board->receiver.paused, now_ms()) || !link_arqReceive(&board->arq[0], message, now_ms()))
+		return;
+	if(message->type == LINK_MSG_MEASURE)
+	{
+		link_packSample(board->latest, (uint32_t)simNow, LINK_SAMPLE_UNSYNCED, &reply, LINK_MSG_MEASURE | LINK_MSG_REPLY);
+		reply.address = board->node.address;
+		reply.id = message->id;
+		link_arqSend(&board->arq[0], &reply, now_ms());
+	}
+}
+
+/*
+ * Uarts and radio: a board whose line is free puts its next byte on air,
+ * bytes of two boards on air at once collide, bytes through the radio are
+ * handed to every other board
+ */
+static void channel_step(void)
+{
+	LINK_MESSAGE_t message;
+
+	for(uint8_t b = 0; b < boardCount; b++)
+	{
+		SIM_BOARD_t* board = &boards[b];
+		uint32_t end = board->gated ? board->txLimit : board->txHead;
+		if(simNow < board->lineFree || (int32_t)(end - board->txTail) <= 0 || airHead - airTail >= SIM_AIR_SIZE)
+			continue;
+		SIM_AIR_BYTE_t* byte = &air[airHead++ % SIM_AIR_SIZE];
+		byte->sender = b;
+		byte->byte = board->tx[board->txTail++ % SIM_TX_SIZE];
+		byte->start = simNow + SIM_LATENCY_US / 2;
+		byte->end = byte->start + SIM_BYTE_US;
+		byte->lost = random_unit() < byteLoss;
+		board->lineFree = simNow + SIM_BYTE_US;
+		for(uint8_t other = 0; other < boardCount; other++)
+		{
+			SIM_AIR_BYTE_t* on = boards[other].sending;
+			if(other == b || on == NULL || on->end <= byte->start || on->start >= byte->end)
+				continue;
+			if(!on->lost || !byte->lost)
+				collisions++;
+			on->lost = true;
+			byte->lost = true;
+		}
+		board->sending = byte;
+	}
+	while(airTail != airHead && air[airTail % SIM_AIR_SIZE].end + SIM_LATENCY_US / 2 <= simNow)
+	{
+		SIM_AIR_BYTE_t* byte = &air[airTail++ % SIM_AIR_SIZE];
+		if(boards[byte->sender].sending == byte)
+			boards[byte->sender].sending = NULL;
+		if(byte->lost)
+			continue;
+		for(uint8_t b = 0; b < boardCount; b++)
+		{
+			if(b == byte->sender)
+				continue;
+			boards[b].lastByte = simNow;
+			boards[b].idle = false;
+			if(link_receive(&boards[b].receiver, byte->byte) != LINK_RX_FRAME)
+				continue;
+			if(link_decode((uint8_t*)boards[b].receiver.data, boards[b].receiver.length, &message) != LINK_OK)
+			{
+				boards[b].rejected++;
+				continue;
+			}
+			if(b == 0)
+				display_receive(&boards[0], &message);
+			else
+				node_receive(&boards[b], &message);
+		}
+	}
+	for(uint8_t b = 0; b < boardCount; b++)
+	{
+		if(boards[b].idle || simNow - boards[b].lastByte < SIM_BYTE_US)
+			continue;
+		boards[b].idle = true;
+		link_receiveIdle(&boards[b].receiver);
+		if(b == 0 && polling)
+			link_schedulerIdle(&boards[0].scheduler);
+		else if(b > 0)
+			node_idle(&boards[b]);
+	}
+}
+
+static void run(uint8_t nodes, uint8_t polled, uint32_t seconds, SIM_RESULT_t* result)
+{
+	memset(boards, 0, sizeof(boards));
+	memset(result, 0, sizeof(*result));
+	airHead = airTail = 0;
+	collisions = 0;
+	simNow = 0;
+	boardCount = nodes + 1;
+	for(uint8_t b = 0; b < boardCount; b++)
+	{
+		link_resetReceiver(&boards[b].receiver);
+		for(uint8_t i = 0; i < LINK_MAX_NODES; i++)
+			link_arqInit(&boards[b].arq[i], LINK_ARQ_WINDOW, arq_output, &boards[b]);
+		link_nodeInit(&boards[b].node, b, 0);
+		boards[b].nextSample = (uint32_t)(random_unit() * sampleMs);
+	}
+	link_schedulerInit(&boards[0].scheduler, polled, 0);
+	boards[0].gated = polling;
+
+	for(; simNow < seconds * 1e6; simNow += SIM_STEP_US)
+	{
+		display_poll(&boards[0]);
+		for(uint8_t b = 1; b < boardCount; b++)
+			node_poll(&boards[b]);
+		channel_step();
+	}
+
+	LINK_SCHEDULER_t* scheduler = &boards[0].scheduler;
+	result->cycle = scheduler->cycles ? now_ms() / scheduler->cycles : 0;
+	result->rateMin = 1e9;
+	for(uint8_t i = 0; i < nodes; i++)
+	{
+		double rate = (double)boards[0].samples[i] / seconds;
+		if(rate < result->rateMin)
+			result->rateMin = rate;
+		if(rate > result->rateMax)
+			result->rateMax = rate;
+	}
+	for(uint8_t b = 0; b < boardCount; b++)
+	{
+		result->rejected += boards[b].rejected;
+		result->dropped += boards[b].dropped;
+		for(uint8_t i = 0; i < LINK_MAX_NODES; i++)
+			result->retransmitted += boards[b].arq[i].stats.retransmitted;
+	}
+	result->collisions = collisions;
+	result->requests = boards[0].requests;
+	result->replies = boards[0].replies;
+}
+static void print_row(const char* mode, uint8_t nodes, uint8_t polled, const SIM_RESULT_t* r)
+{
+	printf("%-7s %5u %6u %8lu %6.1f..%-5.1f %10lu %8lu %5lu/%-5lu %5lu %7lu\n", mode, nodes, polled,
+			(unsigned long)r->cycle, r->rateMin, r->rateMax, (unsigned long)r->collisions, (unsigned long)r->rejected,
+			(unsigned long)r->replies, (unsigned long)r->requests, (unsigned long)r->retransmitted,
+			(unsigned long)r->dropped);
+	fflush(stdout);
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint32_t seconds = (argc > 1) ? strtoul(argv[1], NULL, 0) : SIM_SECONDS;
+	SIM_RESULT_t result;
+	int failed = 0;
+
+	if(argc > 2)
+		sampleMs = strtoul(argv[2], NULL, 0);
+	byteLoss = (argc > 3) ? strtod(argv[3], NULL) : 0.0;
+	printf("%-7s %5s %6s %8s %12s %10s %8s %11s %5s %7s\n", "mode", "nodes", "polled", "cycle ms", "samples/s",
+			"collisions", "rejected", "replies", "retx", "dropped");
+	polling = true;
+	for(uint8_t nodes = 1; nodes <= LINK_MAX_NODES; nodes++)
+	{
+		//as the display: all addresses polled, the missing nodes are absent
+		run(nodes, LINK_MAX_NODES, seconds, &result);
+		print_row("polled", nodes, LINK_MAX_NODES, &result);
+		failed |= result.collisions != 0;
+	}
+	polling = false;
+	for(uint8_t nodes = 1; nodes <= LINK_MAX_NODES; nodes++)
+	{
+		run(nodes, nodes, seconds, &result);
+		print_row("free", nodes, 0, &result);
+	}
+	return failed;
+}
@@ -0,0 +1,138 @@
+/**
+  ******************************************************************************
+  * @file    pwm_bench.c
+  * @author  Mathias Bohle
+  * @date 	 19.10.2026
+  * @brief   Host check of the WS2812 encoder of pwm_driver.c: the lookup table
+  * 		 (pwm_encode.h) against the bit loop it replaced. Every slot of all
+  * 		 256 bytes has to be the same compare value (the DMA widens the
+  * 		 table byte to the 32 bit word the loop wrote), then both encode
+  * 		 the same pixels and the time per pixel is printed. Exit code is
+  * 		 non-zero on any difference.
+  *
+  * 		 gcc -O2 -IProject_LightSensor/Core/Inc -o pwm_bench Tools/pwm_bench.c
+  *
+  * 		 pwm_bench [pixels]
+  *
+  ******************************************************************************
+  */
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L //clock_gettime with -std=c11
+#include "pwm_encode.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define BENCH_PIXELS 10000000
+#define BENCH_BITS_PER_LED 24
+
+/*Type Definitions -----------------------------------------------------------*/
+typedef struct BenchColor
+{
+	uint8_t red;
+	uint8_t green;
+	uint8_t blue;
+}BENCH_COLOR_t;
+
+/* Globals -------------------------------------------------------------------*/
+static const uint8_t encodeTable[256][8] __attribute__((aligned(4))) = PWM_ENCODE_TABLE;
+
+/* Private Functions ---------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+/*
+ * Encoder before the table: one branch per bit into 32 bit words
+ */
+static void encode_loop(uint32_t* data, BENCH_COLOR_t color)
+{
+	uint32_t bits = ((((uint8_t)color.green)<<16) | (((uint8_t)color.red)<<8) | (((uint8_t)color.blue)));
+	for(int i=23; i>=0; i--) //Format color values, GRB and MSB first
+	{
+		*data++ = (bits&(1<<i)) ? PWM_ONE : PWM_ZERO;
+	}
+}
+/*
+ * Encoder of pwm_driver.c: one lookup and an 8 byte copy per color byte
+ */
+static void encode_table(uint8_t* data, BENCH_COLOR_t color)
+{
+	memcpy(&data[0], encodeTable[color.green], 8);
+	memcpy(&data[8], encodeTable[color.red], 8);
+	memcpy(&data[16], encodeTable[color.blue], 8);
+}
+static BENCH_COLOR_t color_of(uint32_t i)
+{
+	BENCH_COLOR_t color = { (uint8_t)(i * 7), (uint8_t)(i * 13 + 5), (uint8_t)(i >> 3) };
+	return color;
+}
+/*
+ * Every byte in every position of the pixel, returns the slots that differ
+ */
+static uint32_t compare_all(void)
+{
+	uint32_t words[BENCH_BITS_PER_LED];
+	uint8_t bytes[BENCH_BITS_PER_LED];
+	uint32_t differences = 0;
+
+	for(uint32_t value = 0; value < 256; value++)
+	{
+		BENCH_COLOR_t colors[3] = { { value, 0, 0 }, { 0, value, 0 }, { 0, 0, value } };
+		for(uint8_t c = 0; c < 3; c++)
+		{
+			encode_loop(words, colors[c]);
+			encode_table(bytes, colors[c]);
+			for(uint8_t slot = 0; slot < BENCH_BITS_PER_LED; slot++)
+			{
+				if(words[slot] == bytes[slot])
+					continue;
+				if(differences++ < 10)
+					printf("byte %lu color %u slot %u: loop %lu table %u\n", (unsigned long)value, c, slot,
+							(unsigned long)words[slot], bytes[slot]);
+			}
+		}
+	}
+	return differences;
+}
+
+/* Functions -----------------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	uint32_t pixels = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_PIXELS;
+	static uint32_t words[BENCH_BITS_PER_LED];
+	static uint8_t bytes[BENCH_BITS_PER_LED];
+	volatile uint32_t sink = 0;
+	uint64_t start;
+	uint64_t loopNs;
+	uint64_t tableNs;
+
+	uint32_t differences = compare_all();
+	printf("256 bytes x 8 slots in all 3 colors: %lu differences\n", (unsigned long)differences);
+
+	start = now_ns();
+	for(uint32_t i = 0; i < pixels; i++)
+	{
+		encode_loop(words, color_of(i));
+		sink += words[i % BENCH_BITS_PER_LED];
+	}
+	loopNs = now_ns() - start;
+	start = now_ns();
+	for(uint32_t i = 0; i < pixels; i++)
+	{
+		encode_table(bytes, color_of(i));
+		sink += bytes[i % BENCH_BITS_PER_LED];
+	}
+	tableNs = now_ns() - start;
+	(void)sink;
+
+	printf("%-8s %10s\n", "encoder", "ns/pixel");
+	printf("%-8s %10.2f\n", "loop", (double)loopNs / pixels);
+	printf("%-8s %10.2f\n", "table", (double)tableNs / pixels);
+	return (differences == 0) ? 0 : 1;
+}